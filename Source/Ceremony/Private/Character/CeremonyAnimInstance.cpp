@@ -2,32 +2,86 @@
 
 #include "Character/CeremonyAnimInstance.h"
 
+#include "Core/Ceremony.h"
 #include "Character/CeremonyCharacter.h"
 #include "Character/CeremonyMovementComponent.h"
 #include "Character/InverseKinematicsComponent.h"
 
-void UCeremonyAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+DECLARE_CYCLE_STAT(TEXT("Anim Instance PreUpdate"), STAT_AnimInstancePreUpdate, STATGROUP_Ceremony);
+DECLARE_CYCLE_STAT(TEXT("Anim Instance Update"), STAT_AnimInstanceUpdate, STATGROUP_Ceremony);
+
+void FCeremonyAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, const float DeltaSeconds)
 {
-	const auto Owner = Cast<ACeremonyCharacter>(TryGetPawnOwner());
-	if(IsValid(Owner))
+	Super::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_AnimInstancePreUpdate);
+
+	CeremonyAnimInstance = Cast<UCeremonyAnimInstance>(InAnimInstance);
+	const ACeremonyCharacter* Owner = IsValid(CeremonyAnimInstance) ? CeremonyAnimInstance->OwnerCharacter : nullptr;
+	bHasOwner = IsValid(Owner);
+	if(!bHasOwner)
 	{
-		// Update character velocity to drive blend spaces.
-		Velocity = Owner->GetVelocity().Size();
+		return;
+	}
 
-		// Get the IK offsets.
-		Owner->InverseKinematicsComponent->GetOffsets(PelvisOffset, LeftFootOffsetLocation, RightFootOffsetLocation, LeftFootOffsetRotation,
-		                                              RightFootOffsetRotation);
+	OwnerVelocity = Owner->GetVelocity();
+	OwnerRotation = Owner->GetActorQuat();
+	bOwnerIsFalling = Owner->GetCharacterMovement()->IsFalling();
+	bOwnerIsLockedOn = Owner->GetIsLockedOn();
+	bOwnerMeleeLocomotion = Owner->IsMeleeLocomotion();
 
-		bMeleeLocomotion = Owner->IsMeleeLocomotion();
+	Owner->InverseKinematicsComponent->GetOffsets(OwnerPelvisOffset, OwnerLeftFootOffsetLocation, OwnerRightFootOffsetLocation,
+	                                              OwnerLeftFootOffsetRotation, OwnerRightFootOffsetRotation);
+}
 
-		bIsFalling = Owner->GetCharacterMovement()->IsFalling();
+void FCeremonyAnimInstanceProxy::Update(const float DeltaSeconds)
+{
+	Super::Update(DeltaSeconds);
 
-		bIsLockedOn = Owner->GetIsLockedOn();
+	SCOPE_CYCLE_COUNTER(STAT_AnimInstanceUpdate);
 
-		bIsNotFallingAndLockedOn = !bIsFalling && bIsLockedOn;
-		bIsNotFallingAndNotLockedOn = !bIsFalling && !bIsLockedOn;
-		
-		ForwardVelocity = FVector::DotProduct(Owner->GetVelocity(), Owner->GetActorForwardVector());
-		RightVelocity = FVector::DotProduct(Owner->GetVelocity(), Owner->GetActorRightVector());
+	if(!bHasOwner)
+	{
+		return;
 	}
+
+	UCeremonyAnimInstance* Instance = CeremonyAnimInstance;
+
+	// Update character velocity to drive blend spaces.
+	Instance->Velocity = OwnerVelocity.Size();
+	Instance->ForwardVelocity = FVector::DotProduct(OwnerVelocity, OwnerRotation.GetForwardVector());
+	Instance->RightVelocity = FVector::DotProduct(OwnerVelocity, OwnerRotation.GetRightVector());
+
+	// Set the IK offsets.
+	Instance->PelvisOffset = OwnerPelvisOffset;
+	Instance->LeftFootOffsetLocation = OwnerLeftFootOffsetLocation;
+	Instance->RightFootOffsetLocation = OwnerRightFootOffsetLocation;
+	Instance->LeftFootOffsetRotation = OwnerLeftFootOffsetRotation;
+	Instance->RightFootOffsetRotation = OwnerRightFootOffsetRotation;
+
+	Instance->bMeleeLocomotion = bOwnerMeleeLocomotion;
+
+	Instance->bIsFalling = bOwnerIsFalling;
+
+	Instance->bIsLockedOn = bOwnerIsLockedOn;
+
+	Instance->bIsNotFallingAndLockedOn = !bOwnerIsFalling && bOwnerIsLockedOn;
+	Instance->bIsNotFallingAndNotLockedOn = !bOwnerIsFalling && !bOwnerIsLockedOn;
+}
+
+FAnimInstanceProxy* UCeremonyAnimInstance::CreateAnimInstanceProxy()
+{
+	return new FCeremonyAnimInstanceProxy(this);
+}
+
+void UCeremonyAnimInstance::DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy)
+{
+	delete InProxy;
+}
+
+void UCeremonyAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	OwnerCharacter = Cast<ACeremonyCharacter>(TryGetPawnOwner());
 }
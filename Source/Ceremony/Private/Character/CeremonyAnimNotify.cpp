@@ -71,7 +71,17 @@ void UCeremonyAnimNotify::Notify(USkeletalMeshComponent* MeshComp, UAnimSequence
 		return;
 	}
 
-	// Only locally controlled characters receive notifies. These don't occur on a dedicated server or simulated clients.
+	// Footsteps are cosmetic, so every client plays its own from the animation, including for simulated characters.
+	if(NotifyType == ECeremonyAnimNotifyType::PlayFootstepSound)
+	{
+		if(OwnerCharacter->GetNetMode() != NM_DedicatedServer)
+		{
+			OwnerCharacter->PlayFootstepSound(bRightFoot);
+		}
+		return;
+	}
+	
+	// Only locally controlled characters receive the remaining notifies. These don't occur on a dedicated server or simulated clients.
 	if(!OwnerCharacter->IsLocallyControlled())
 	{
 		return;
@@ -92,8 +102,7 @@ void UCeremonyAnimNotify::Notify(USkeletalMeshComponent* MeshComp, UAnimSequence
 			OwnerCharacter->PlaySound(Sound);
 		}
 		break;
-	case ECeremonyAnimNotifyType::PlayFootstepSound:
-		OwnerCharacter->PlayFootstepSound(bRightFoot);
+	default:
 		break;
 	}
 }
@@ -3,42 +3,112 @@
 #include "Character/CeremonyCharacter.h"
 
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Character/CeremonyAnimInstance.h"
 #include "Components/AudioComponent.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Core/CeremonyCharacterPool.h"
+#include "Core/CeremonyCharacterRegistry.h"
+#include "Core/CeremonyCombatData.h"
+#include "Core/CeremonyEquipmentCatalog.h"
 #include "Core/CeremonyFunctionLibrary.h"
+#include "Core/CeremonyGameModeBase.h"
+#include "Core/CeremonyMontageRegistry.h"
 #include "Character/CeremonyMovementComponent.h"
 #include "Character/CeremonyOpponentUserWidget.h"
 #include "Core/CeremonyPlayerController.h"
+#include "Core/CeremonySignificanceSubsystem.h"
 #include "Character/CeremonyUserWidget.h"
+#include "Character/CombatStateComponent.h"
+#include "Core/Ceremony.h"
 #include "GameFramework/Controller.h"
 #include "Character/DebugComponent.h"
 #include "DrawDebugHelpers.h"
+#include "Engine/AssetManager.h"
 #include "Equipment/EquipmentActor.h"
 #include "Character/FootstepComponent.h"
+#include "Character/HitboxComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Components/InputComponent.h"
 #include "Character/InverseKinematicsComponent.h"
+#include "Character/LagCompensationComponent.h"
 #include "Character/LockOnComponent.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "Equipment/RangedWeaponActor.h"
 #include "Equipment/ShieldActor.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "Engine/StreamableManager.h"
 #include "Engine/World.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "Net/UnrealNetwork.h"
 #include "Components/WidgetComponent.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Properties Marked Dirty"), STAT_CharacterPropertiesMarkedDirty, STATGROUP_Ceremony);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cosmetic Components Stripped"), STAT_CosmeticComponentsStripped, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Rejected By Combat Data"), STAT_HitsRejectedByCombatData, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Montage RPCs Elided"), STAT_MontageRPCsElided, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Montage RPCs Sent"), STAT_MontageRPCsSent, STATGROUP_Ceremony);
+
+// Replicated properties are registered as push based. With an engine built with push model (WITH_PUSH_MODEL) and net.IsPushModelEnabled
+// set, they're only compared for replication after being marked dirty here; otherwise marking does nothing and they're compared as usual.
+// The compare cost itself shows in stat net and the network profiler, not in this module's stats.
+#define MARK_CHARACTER_PROPERTY_DIRTY(Character, PropertyName) \
+	do \
+	{ \
+		MARK_PROPERTY_DIRTY_FROM_NAME(ACeremonyCharacter, PropertyName, Character); \
+		INC_DWORD_STAT(STAT_CharacterPropertiesMarkedDirty); \
+	} while(0)
+
+bool FCosmeticAnimMontage::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 PackedMontageId = MontageId;
+	Ar.SerializeIntPacked(PackedMontageId);
+	MontageId = static_cast<uint16>(PackedMontageId);
+
+	if(MontageId != 0)
+	{
+		Ar << QuantizedPosition;
+		Ar << ServerStartTime;
+	}
+	else if(Ar.IsLoading())
+	{
+		QuantizedPosition = 0;
+		ServerStartTime = 0.0f;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+// Leaves the components that only present the character to a player out of the dedicated server build.
+static const FObjectInitializer& SkipCosmeticSubobjects(const FObjectInitializer& ObjectInitializer)
+{
+	return UE_SERVER ? ObjectInitializer
+		.DoNotCreateDefaultSubobject(TEXT("SpringArmComponent"))
+		.DoNotCreateDefaultSubobject(TEXT("CameraComponent"))
+		.DoNotCreateDefaultSubobject(TEXT("DebugComponent"))
+		.DoNotCreateDefaultSubobject(TEXT("FootstepComponent"))
+		.DoNotCreateDefaultSubobject(TEXT("OpponentWidget"))
+		.DoNotCreateDefaultSubobject(TEXT("LockOnWidget")) : ObjectInitializer;
+}
+
 ACeremonyCharacter::ACeremonyCharacter(const class FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCeremonyMovementComponent>(ACharacter::CharacterMovementComponentName))
+	: Super(SkipCosmeticSubobjects(ObjectInitializer).SetDefaultSubobjectClass<UCeremonyMovementComponent>(
+		ACharacter::CharacterMovementComponentName))
 {
-	// Fully functioning character need to tick (update endurance).
+	// Locally controlled characters tick to apply forced movement, see SetAnimMovement().
 	PrimaryActorTick.bCanEverTick = true;
 
-	// Only fully functioning characters need to tick.
+	// Only tick while movement is forced; endurance, stun and stagger are updated from timers.
 	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	// Disable collision on the character mesh.
 	GetMesh()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// Let the animation update rate follow the character significance.
+	GetMesh()->bEnableUpdateRateOptimizations = true;
 	
 	// Disable the character from rotating due to controller rotation; this is used for the camera movement.
 	bUseControllerRotationPitch = false;
@@ -52,58 +122,94 @@ ACeremonyCharacter::ACeremonyCharacter(const class FObjectInitializer& ObjectIni
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 720.0f, 0.0f);
 	
 	// Create a spring arm to attack the third person camera.
-	SpringArmComponent = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArmComponent"));
-	SpringArmComponent->bUsePawnControlRotation = true;
-	SpringArmComponent->SetupAttachment(GetRootComponent());
-	SpringArmComponent->bEnableCameraLag = true;
-	SpringArmComponent->bEnableCameraRotationLag = true;
-	SpringArmComponent->bUsePawnControlRotation = true;
-	SpringArmComponent->TargetArmLength = 250.0f;
-	SpringArmComponent->CameraLagSpeed = 5.0f;
-	SpringArmComponent->CameraRotationLagSpeed = 5.0f;
+	SpringArmComponent = CreateOptionalDefaultSubobject<USpringArmComponent>(TEXT("SpringArmComponent"));
+	if(SpringArmComponent)
+	{
+		SpringArmComponent->bUsePawnControlRotation = true;
+		SpringArmComponent->SetupAttachment(GetRootComponent());
+		SpringArmComponent->bEnableCameraLag = true;
+		SpringArmComponent->bEnableCameraRotationLag = true;
+		SpringArmComponent->bUsePawnControlRotation = true;
+		SpringArmComponent->TargetArmLength = 250.0f;
+		SpringArmComponent->CameraLagSpeed = 5.0f;
+		SpringArmComponent->CameraRotationLagSpeed = 5.0f;
+	}
 
 	// Create a third person camera.
-	CameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("CameraComponent"));
-	CameraComponent->bUsePawnControlRotation = false;
-	CameraComponent->SetupAttachment(SpringArmComponent);
-	CameraComponent->SetRelativeLocation(FVector(0.0f, 0.0f, 50.0f));
+	CameraComponent = CreateOptionalDefaultSubobject<UCameraComponent>(TEXT("CameraComponent"));
+	if(CameraComponent)
+	{
+		CameraComponent->bUsePawnControlRotation = false;
+		CameraComponent->SetupAttachment(SpringArmComponent);
+		CameraComponent->SetRelativeLocation(FVector(0.0f, 0.0f, 50.0f));
+	}
 
 	// Create the IK component.
 	InverseKinematicsComponent = CreateDefaultSubobject<UInverseKinematicsComponent>(TEXT("InverseKinematicsComponent"));
 
 	// Create a kick capsule collision component.
-	KickCapsuleComponent = CreateDefaultSubobject<UCapsuleComponent>(TEXT("KickCapsuleComponent"));
+	KickCapsuleComponent = CreateDefaultSubobject<UHitboxComponent>(TEXT("KickCapsuleComponent"));
 	KickCapsuleComponent->SetupAttachment(GetMesh(), TEXT("ball_r"));
-	KickCapsuleComponent->SetCollisionProfileName(TEXT("OverlapOnlyPawn"));
-	KickCapsuleComponent->SetGenerateOverlapEvents(false);
 	KickCapsuleComponent->SetCapsuleRadius(10.0f);
 	KickCapsuleComponent->SetCapsuleHalfHeight(20.0f);
 	
-	// Create debug component for debug functionality.
-	DebugComponent = CreateDefaultSubobject<UDebugComponent>(TEXT("DebugComponent"));
-
+	// Create the capsule history used to verify hits on the server.
+	LagCompensationComponent = CreateDefaultSubobject<ULagCompensationComponent>(TEXT("LagCompensationComponent"));
+	
+	// Create the combat state stream to the server.
+	CombatStateComponent = CreateDefaultSubobject<UCombatStateComponent>(TEXT("CombatStateComponent"));
+	
 	// Create lock on component to allow locking on.
 	LockOnComponent = CreateDefaultSubobject<ULockOnComponent>(TEXT("LockOnComponent"));
-		
+
+	// Components below only present the character to a player, and are skipped in the dedicated server build.
+	// Create debug component for debug functionality.
+	DebugComponent = CreateOptionalDefaultSubobject<UDebugComponent>(TEXT("DebugComponent"));
+	
 	// Footstep audio component.
-	FootstepComponent = CreateDefaultSubobject<UFootstepComponent>(TEXT("FootstepComponent"));
+	FootstepComponent = CreateOptionalDefaultSubobject<UFootstepComponent>(TEXT("FootstepComponent"));
 
 	// Create a widget for displaying the character health and damage when hit by an opponent (display on the opponent's screen).
-	OpponentWidget = CreateDefaultSubobject<UWidgetComponent>(TEXT("OpponentWidget"));
-	OpponentWidget->SetGenerateOverlapEvents(false);
-	OpponentWidget->SetCollisionProfileName(TEXT("NoCollision"));
-	OpponentWidget->SetWidgetSpace(EWidgetSpace::Screen);
-	OpponentWidget->SetDrawSize(FVector2D(200.0f, 25.0f));
-	OpponentWidget->SetupAttachment(GetRootComponent());
+	OpponentWidget = CreateOptionalDefaultSubobject<UWidgetComponent>(TEXT("OpponentWidget"));
+	if(OpponentWidget)
+	{
+		OpponentWidget->SetGenerateOverlapEvents(false);
+		OpponentWidget->SetCollisionProfileName(TEXT("NoCollision"));
+		OpponentWidget->SetWidgetSpace(EWidgetSpace::Screen);
+		OpponentWidget->SetDrawSize(FVector2D(200.0f, 25.0f));
+		OpponentWidget->SetupAttachment(GetRootComponent());
+	}
 
 	// Create a widget for displaying lock on status.
-	LockOnWidget = CreateDefaultSubobject<UWidgetComponent>(TEXT("LockOnWidget"));
-	LockOnWidget->SetGenerateOverlapEvents(false);
-	LockOnWidget->SetCollisionProfileName(TEXT("NoCollision"));
-	LockOnWidget->SetWidgetSpace(EWidgetSpace::Screen);
-	LockOnWidget->SetDrawSize(FVector2D(20.0f));
-	LockOnWidget->SetVisibility(false);
-	LockOnWidget->SetupAttachment(GetRootComponent());
+	LockOnWidget = CreateOptionalDefaultSubobject<UWidgetComponent>(TEXT("LockOnWidget"));
+	if(LockOnWidget)
+	{
+		LockOnWidget->SetGenerateOverlapEvents(false);
+		LockOnWidget->SetCollisionProfileName(TEXT("NoCollision"));
+		LockOnWidget->SetWidgetSpace(EWidgetSpace::Screen);
+		LockOnWidget->SetDrawSize(FVector2D(20.0f));
+		LockOnWidget->SetVisibility(false);
+		LockOnWidget->SetupAttachment(GetRootComponent());
+	}
+
+	// Replicated hit records are handed to this character.
+	HitLog.OwnerCharacter = this;
+}
+
+void ACeremonyCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// The server build skips the cosmetic subobjects; other builds running as a dedicated server remove them here.
+	if(GetNetMode() == NM_DedicatedServer)
+	{
+		StripCosmeticComponents();
+	}
+	else
+	{
+		// The update rate parameters were created when the mesh registered.
+		ApplyAnimUpdateRate(GetMesh()->AnimUpdateRateParams);
+	}
 }
 
 void ACeremonyCharacter::BeginPlay()
@@ -111,91 +217,88 @@ void ACeremonyCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	UCeremonyFunctionLibrary::LogRoleAndMode(this, FString::Printf(TEXT("BEGIN PLAY %s"), *GetNameSafe(this)));
+
+	// A character that becomes relevant while pooled stays out of the subsystems until it's reused.
+	if(!bIsPooled)
+	{
+		RegisterWithSubsystems();
+	}
 	
 	if(GetLocalRole() == ROLE_Authority)
 	{
-		Health = HealthMaximum;
-
-		UWorld* World = GetWorld();
-		check(IsValid(World));
+		SetHealth(HealthMaximum);
 
-		FActorSpawnParameters SpawnParameters;
-		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		SpawnParameters.Owner = this;
-		SpawnParameters.Instigator = this;
-		const FTransform Transform = FTransform::Identity;
-		
-		// Spawn default equipment on the server.
-		if(!IsValid(RightHandEquipmentDefaultClass))
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Cannot spawn null right hand equipment class for %s."), *GetNameSafe(this));
-		}
-		else
+		// Hits are checked without combat data until it has streamed in.
+		if(!ServerCombatData.IsNull())
 		{
-			RightHandEquipment = World->SpawnActor<AEquipmentActor>(RightHandEquipmentDefaultClass, Transform, SpawnParameters);
-			if(IsValid(RightHandEquipment))
-			{
-				RightHandEquipment->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, RightHandSocketName);
-				if(RightHandEquipment->GetEquipmentState() != EEquipmentStates::EquippedTwoHand)
-				{
-					RightHandEquipment->ServerSetEquipmentState(EEquipmentStates::EquippedRightHand);	
-				}
-				else
-				{
-					bMeleeLocomotion = RightHandEquipment->bMeleeLocomotion;
-				}
-			}
+			ServerCombatDataHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ServerCombatData.ToSoftObjectPath());
 		}
 
-		if(!IsValid(LeftHandEquipmentDefaultClass))
+		// Hold the default equipment; every machine spawns its own from the loadout.
+		UCeremonyEquipmentCatalog* EquipmentCatalog = UCeremonyEquipmentCatalog::Get(this);
+		if(IsValid(EquipmentCatalog))
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Cannot spawn null left hand equipment class for %s."), *GetNameSafe(this));
-		}
-		else
-		{
-			LeftHandEquipment = World->SpawnActor<AEquipmentActor>(LeftHandEquipmentDefaultClass, Transform, SpawnParameters);
-			if(IsValid(LeftHandEquipment))
-			{
-				LeftHandEquipment->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, LeftHandSocketName);
-
-				if(LeftHandEquipment->GetEquipmentState() != EEquipmentStates::EquippedTwoHand)
-				{
-					LeftHandEquipment->ServerSetEquipmentState(EEquipmentStates::EquippedLeftHand);	
-				}
-				else
-				{
-					bMeleeLocomotion = LeftHandEquipment->bMeleeLocomotion;	
-				}
-			}	
+			FCeremonyLoadout DefaultLoadout;
+			DefaultLoadout.RightHandEquipmentId = EquipmentCatalog->GetEquipmentId(RightHandEquipmentDefaultClass);
+			DefaultLoadout.LeftHandEquipmentId = EquipmentCatalog->GetEquipmentId(LeftHandEquipmentDefaultClass);
+			SetLoadout(DefaultLoadout);
 		}
 	}
+	else
+	{
+		// The loadout can replicate before the game state the equipment catalog is built from; spawn anything that was missed.
+		OnRep_Loadout();
+	}
 
-	// On locally controlled characters, tick, set endurance, and allow kick.
+	// On locally controlled characters, set endurance, and allow kick.
 	if(IsLocallyControlled())
 	{
 		Endurance = EnduranceMaximum;
-		SetActorTickEnabled(true);
+		EnduranceTimestamp = GetWorld()->GetTimeSeconds();
 
-		KickCapsuleComponent->OnComponentBeginOverlap.AddDynamic(this, &ACeremonyCharacter::OnKickComponentOverlap);
+		KickCapsuleComponent->OnHitboxHit.BindUObject(this, &ACeremonyCharacter::OnKickHit);
+	}
+}
+
+void ACeremonyCharacter::FellOutOfWorld(const UDamageType& DamageType)
+{
+	// The character is destroyed, so respawn the player without waiting for a dead body.
+	ACeremonyGameModeBase* GameMode = HasAuthority() ? GetWorld()->GetAuthGameMode<ACeremonyGameModeBase>() : nullptr;
+	if(IsValid(GameMode))
+	{
+		GameMode->QueueRespawn(GetController());
 	}
+	
+	Super::FellOutOfWorld(DamageType);
 }
 
 void ACeremonyCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	// Destroy the equipment that was spawned on the server.
-	if(HasAuthority())
+	// Destroy the equipment spawned locally from the loadout.
+	if(IsValid(LeftHandEquipment))
 	{
-		if(IsValid(LeftHandEquipment))
-		{
-			LeftHandEquipment->Destroy();
-		}
+		LeftHandEquipment->Destroy();
+	}
 
-		if(IsValid(RightHandEquipment))
-		{
-			RightHandEquipment->Destroy();
-		}
+	if(IsValid(RightHandEquipment))
+	{
+		RightHandEquipment->Destroy();
+	}
+
+	if(LoadoutHandle.IsValid())
+	{
+		LoadoutHandle->CancelHandle();
+		LoadoutHandle.Reset();
+	}
+
+	if(FlushCosmeticAnimMontageHandle.IsValid())
+	{
+		FWorldDelegates::OnWorldPostActorTick.Remove(FlushCosmeticAnimMontageHandle);
+		FlushCosmeticAnimMontageHandle.Reset();
 	}
 
+	UnregisterFromSubsystems();
+	
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -203,22 +306,34 @@ void ACeremonyCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, CosmeticAnimMontage, COND_SkipOwner);
+	FDoRepLifetimeParams SkipOwnerParams;
+	SkipOwnerParams.Condition = COND_SkipOwner;
+	SkipOwnerParams.bIsPushBased = true;
+
+	FDoRepLifetimeParams OwnerOnlyParams;
+	OwnerOnlyParams.Condition = COND_OwnerOnly;
+	OwnerOnlyParams.bIsPushBased = true;
 
-	DOREPLIFETIME(ACeremonyCharacter, Health);
+	FDoRepLifetimeParams AllParams;
+	AllParams.bIsPushBased = true;
+	
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, CosmeticAnimMontage, SkipOwnerParams);
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, Health, AllParams);
 
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, bIsLockedOn, COND_SkipOwner);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, HitLog, AllParams);
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, bIsLockedOn, SkipOwnerParams);
 	
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, bIsRunning, COND_SkipOwner);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, bIsRunning, SkipOwnerParams);
 
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, bIsStaggered, COND_SkipOwner);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, bIsStaggered, SkipOwnerParams);
 	
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, LeftHandEquipment, COND_OwnerOnly);
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, RightHandEquipment, COND_OwnerOnly);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, Loadout, AllParams);
 
-	DOREPLIFETIME(ACeremonyCharacter, ClientPlayerNumber);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, ClientPlayerNumber, AllParams);
 
-	DOREPLIFETIME_CONDITION(ACeremonyCharacter, bMeleeLocomotion, COND_SkipOwner);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACeremonyCharacter, bIsPooled, AllParams);
 }
 
 void ACeremonyCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -251,176 +366,25 @@ void ACeremonyCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputC
 	PlayerInputComponent->BindAction("Run", IE_Released, this, &ACeremonyCharacter::RunRelease);
 	
 	// Set up the debug service.
-	DebugComponent->BindActions(PlayerInputComponent);
+	if(IsValid(DebugComponent))
+	{
+		DebugComponent->BindActions(PlayerInputComponent);
+	}
 }
 
 void ACeremonyCharacter::Tick(const float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	// Check for endurance recovery over time.
-	if(bIsRunning && (!FMath::IsNearlyZero(MoveForwardLastValue) || !FMath::IsNearlyZero(MoveRightLastValue)))
-	{
-		float EnduranceDelta = RunEnduranceCostPerSecond * DeltaTime;
-		if(Endurance - EnduranceDelta < 0.0f)
-		{
-			EnduranceDelta = Endurance - RunToZeroEndurancePenalty;
-			bIsRunning = false;
-			DebugComponent->UpdateCharacterStateText();
-		}
-
-		DepleteEndurance(EnduranceDelta);
-	}
-	else if(bAllowEnduranceRecovery && Endurance < EnduranceMaximum)
-	{
-		float EnduranceDelta = EnduranceRecoveryPerSecond * DeltaTime;
-		if(bIsBlocking)
-		{
-			EnduranceDelta = BlockingEnduranceRecoveryPerSecond * DeltaTime;
-		}
-		else if(bIsAiming)
-		{
-			EnduranceDelta = AimingEnduranceRecoveryPerSecond * DeltaTime;
-		}
-
-		if(Endurance + EnduranceDelta > EnduranceMaximum)
-		{
-			EnduranceDelta = EnduranceMaximum - Endurance;
-		}
-		
-		DepleteEndurance(EnduranceDelta * -1.0f);
-	}
-	
 	// Check for forced movement with no control, see SetAnimMovement().
 	if(bForcedMovement && !bAllowMovement)
 	{
 		AddMovementInput(ForcedMovementDirection, ForcedMovementRate);
 	}
-
-	// Check for stunned count down.
-	if(StunTimer > 0.0f)
-	{
-		StunTimer -= DeltaTime;
-		if(StunTimer <= 0.0f)
-		{
-			StunCount = 0;
-			StunTimer = 0.0f;
-			SetIsStunned(false);
-			SetAllowMovement(true);
-			StopMontageGlobally();	
-		}
-	}
-
-	// Check for staggered count down.
-	if(StaggerTimer > 0.0f)
-	{
-		StaggerTimer -= DeltaTime;
-		if(StaggerTimer <= 0.0f)
-		{
-			// Stop stagger on the server, so it can replicate it to all clients.
-			Server_SetIsStaggered(false);
-
-			SetIsStaggered(false);
-			SetAllowMovement(true);
-			StopMontageGlobally();
-		}
-	}
 }
 
 #pragma region Client
 
-void ACeremonyCharacter::Client_BackStabbed_Implementation()
-{
-	CancelActions();
-	SetAllowMovement(false);
-	SetIsInvincible(true);
-	SetAllowEnduranceRecovery(false);
-	PlayMontageGlobally(BackStabMontage);
-	SetOnMontageEndedDelegate(this, "OnBackStabOrRiposteMontageEnded", BackStabMontage);
-}
-
-void ACeremonyCharacter::Client_DepleteEnduranceCanStagger_Implementation(const float EnduranceToDeplete)
-{
-	DepleteEndurance(EnduranceToDeplete);
-
-	if(bIsBlocking)
-	{
-		AShieldActor* ShieldActor;
-		if(bIsShieldLeftHanded)
-		{
-			ShieldActor = Cast<AShieldActor>(LeftHandEquipment);
-		}
-		else
-		{
-			ShieldActor = Cast<AShieldActor>(RightHandEquipment);
-		}
-
-		if(IsValid(ShieldActor) && Endurance > 0.0f)
-		{
-			ShieldActor->ShowBlockImpact();
-		}
-	}
-
-	if(Endurance < 0.0f)
-	{
-		Client_Staggered();
-	}
-}
-
-void ACeremonyCharacter::Client_Riposted_Implementation()
-{
-	CancelActions();
-	SetIsStaggered(false);
-	SetAllowMovement(false);
-	SetIsInvincible(true);
-	SetAllowEnduranceRecovery(false);
-	PlayMontageGlobally(RiposteMontage);
-	SetOnMontageEndedDelegate(this, "OnBackStabOrRiposteMontageEnded", RiposteMontage);
-}
-
-void ACeremonyCharacter::Client_Staggered_Implementation()
-{
-	LeftHandEquipment->CancelActions();
-	RightHandEquipment->CancelActions();
-	SetAllowMovement(false);
-	SetIsStaggered(true);
-	PlayMontageGlobally(StaggerMontage);
-}
-
-void ACeremonyCharacter::Client_Stunned_Implementation(const float InStunTime)
-{
-	if(GetIsStaggered())
-	{
-		// Stop stagger and become stunned.
-		SetIsStaggered(false);
-	}
-
-	StunCount++;
-	if(StunCount > StunCountMaximum)
-	{
-		SetIsStunned(false);
-		StunCount = 0;
-		SetAllowMovement(true);
-		StopMontageGlobally();
-	}
-	else
-	{
-		StunTimer = InStunTime;
-
-		// If already stunned, just continue to wait for client tick to stop the stun.
-		if(bIsStunned)
-		{
-			return;
-		}
-
-		// Otherwise, play the stunned montage and set the flag.
-		CancelActions();
-		SetAllowMovement(false);
-		SetIsStunned(true);
-		PlayMontageGlobally(StunMontage);
-	}
-}
-
 void ACeremonyCharacter::OnRep_ClientPlayerNumber() const
 {
 	// Set player color
@@ -447,6 +411,63 @@ void ACeremonyCharacter::OnRep_ClientPlayerNumber() const
 	}
 }
 
+void ACeremonyCharacter::SetClientPlayerNumber(const int32 PlayerNumber)
+{
+	ClientPlayerNumber = PlayerNumber;
+	MARK_CHARACTER_PROPERTY_DIRTY(this, ClientPlayerNumber);
+
+	// On the server, call OnRep directly to force the server to set colors.
+	if(GetNetMode() == NM_ListenServer)
+	{
+		OnRep_ClientPlayerNumber();	
+	}
+}
+
+#pragma endregion
+
+#pragma region Components
+
+UCeremonyOpponentUserWidget* ACeremonyCharacter::GetOpponentUserWidget() const
+{
+	if(!IsValid(OpponentWidget))
+	{
+		return nullptr;
+	}
+	
+	return Cast<UCeremonyOpponentUserWidget>(OpponentWidget->GetUserWidgetObject());
+}
+
+void ACeremonyCharacter::StripCosmeticComponents()
+{
+	for(UActorComponent* Component : TArray<UActorComponent*>({SpringArmComponent, CameraComponent, DebugComponent, FootstepComponent,
+		OpponentWidget, LockOnWidget}))
+	{
+		if(IsValid(Component))
+		{
+			Component->DestroyComponent();
+			INC_DWORD_STAT(STAT_CosmeticComponentsStripped);
+		}
+	}
+
+	SpringArmComponent = nullptr;
+	CameraComponent = nullptr;
+	DebugComponent = nullptr;
+	FootstepComponent = nullptr;
+	OpponentWidget = nullptr;
+	LockOnWidget = nullptr;
+
+	// Without a viewer the engine would skip animation frames as if the mesh was off screen.
+	GetMesh()->bEnableUpdateRateOptimizations = false;
+}
+
+void ACeremonyCharacter::UpdateDebugStateText() const
+{
+	if(IsValid(DebugComponent))
+	{
+		DebugComponent->UpdateCharacterStateText();
+	}
+}
+
 #pragma endregion
 
 #pragma region Equipment
@@ -485,29 +506,64 @@ void ACeremonyCharacter::CheckForAttackTransition(const bool bIsRightHanded) con
 
 bool ACeremonyCharacter::GetCanAttack() const
 {
-	return (Endurance > 0.0f) && !bIsKicking && !bIsParrying && !bIsStunned && !bIsStaggered && !bIsRolling && !GetCharacterMovement()->IsFalling();
+	return (GetEndurance() > 0.0f) && !bIsKicking && !bIsParrying && !bIsStunned && !bIsStaggered && !bIsRolling && !GetCharacterMovement()->IsFalling();
 }
 
-bool ACeremonyCharacter::GetCanBlock() const
+AEquipmentActor* ACeremonyCharacter::GetEquipment(const EEquipmentHand Hand) const
 {
-	return Endurance > 0.0f && !bIsAttacking && !bIsKicking && !bIsStunned && !bIsParrying && !bIsStaggered && !bIsRolling;
+	switch(Hand)
+	{
+	case EEquipmentHand::Right:
+		return RightHandEquipment;
+	case EEquipmentHand::Left:
+		return LeftHandEquipment;
+	default:
+		return nullptr;
+	}
 }
 
-void ACeremonyCharacter::LeftHandPress1()
+void ACeremonyCharacter::GetEquipmentClasses(TArray<TSoftClassPtr<AEquipmentActor>>& OutEquipmentClasses) const
 {
-	if(IsValid(LeftHandEquipment))
+	OutEquipmentClasses.Add(RightHandEquipmentDefaultClass);
+	OutEquipmentClasses.Add(LeftHandEquipmentDefaultClass);
+	OutEquipmentClasses.Append(AdditionalEquipmentClasses);
+}
+
+EEquipmentHand ACeremonyCharacter::GetEquipmentHand(const AEquipmentActor* Equipment) const
+{
+	if(Equipment == nullptr)
 	{
-		LeftHandEquipment->Press1();
+		return EEquipmentHand::None;
 	}
-	else if(IsValid(RightHandEquipment) && RightHandEquipment->GetEquipmentState() == EEquipmentStates::EquippedTwoHand)
+
+	if(Equipment == RightHandEquipment)
 	{
-		RightHandEquipment->TwoHandPress1();
+		return EEquipmentHand::Right;
 	}
-	
-	bLeftHandPress1HeldDown = true;
+
+	return Equipment == LeftHandEquipment ? EEquipmentHand::Left : EEquipmentHand::None;
 }
 
-void ACeremonyCharacter::LeftHandPress2()
+bool ACeremonyCharacter::GetCanBlock() const
+{
+	return GetEndurance() > 0.0f && !bIsAttacking && !bIsKicking && !bIsStunned && !bIsParrying && !bIsStaggered && !bIsRolling;
+}
+
+void ACeremonyCharacter::LeftHandPress1()
+{
+	if(IsValid(LeftHandEquipment))
+	{
+		LeftHandEquipment->Press1();
+	}
+	else if(IsValid(RightHandEquipment) && RightHandEquipment->GetEquipmentState() == EEquipmentStates::EquippedTwoHand)
+	{
+		RightHandEquipment->TwoHandPress1();
+	}
+	
+	bLeftHandPress1HeldDown = true;
+}
+
+void ACeremonyCharacter::LeftHandPress2()
 {
 	if(IsValid(LeftHandEquipment))
 	{
@@ -549,6 +605,95 @@ void ACeremonyCharacter::LeftHandRelease2()
 	bLeftHandPress2HeldDown = false;
 }
 
+void ACeremonyCharacter::OnLoadoutLoaded()
+{
+	UCeremonyEquipmentCatalog* EquipmentCatalog = UCeremonyEquipmentCatalog::Get(this);
+	if(!IsValid(EquipmentCatalog))
+	{
+		return;
+	}
+
+	ReplaceEquipment(EEquipmentHand::Right, EquipmentCatalog->GetEquipmentClass(Loadout.RightHandEquipmentId));
+	ReplaceEquipment(EEquipmentHand::Left, EquipmentCatalog->GetEquipmentClass(Loadout.LeftHandEquipmentId));
+
+	// Two hand equipment chooses the locomotion.
+	bMeleeLocomotion = true;
+	for(const AEquipmentActor* Equipment : {RightHandEquipment, LeftHandEquipment})
+	{
+		if(IsValid(Equipment) && Equipment->GetEquipmentState() == EEquipmentStates::EquippedTwoHand)
+		{
+			bMeleeLocomotion = Equipment->bMeleeLocomotion;
+			break;
+		}
+	}
+
+	UpdateEquipmentAnimLayers();
+}
+
+void ACeremonyCharacter::OnRep_Loadout()
+{
+	UCeremonyEquipmentCatalog* EquipmentCatalog = UCeremonyEquipmentCatalog::Get(this);
+	if(!IsValid(EquipmentCatalog))
+	{
+		return;
+	}
+
+	// A loadout still streaming in has been replaced.
+	if(LoadoutHandle.IsValid())
+	{
+		LoadoutHandle->CancelHandle();
+		LoadoutHandle.Reset();
+	}
+
+	if(EquipmentCatalog->IsLoadoutLoaded(Loadout))
+	{
+		OnLoadoutLoaded();
+		return;
+	}
+
+	// Nothing is loaded synchronously; the hands stay as they are until the equipment has streamed in.
+	LoadoutHandle = EquipmentCatalog->LoadLoadout(Loadout, FStreamableDelegate::CreateUObject(this, &ACeremonyCharacter::OnLoadoutLoaded));
+}
+
+void ACeremonyCharacter::ReplaceEquipment(const EEquipmentHand Hand, const TSubclassOf<AEquipmentActor> EquipmentClass)
+{
+	AEquipmentActor*& Equipment = Hand == EEquipmentHand::Left ? LeftHandEquipment : RightHandEquipment;
+	if(IsValid(Equipment) && Equipment->GetClass() == EquipmentClass)
+	{
+		return;
+	}
+
+	if(IsValid(Equipment))
+	{
+		Equipment->Destroy();
+	}
+
+	Equipment = nullptr;
+	if(EquipmentClass == nullptr)
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.Owner = this;
+	SpawnParameters.Instigator = this;
+
+	Equipment = GetWorld()->SpawnActor<AEquipmentActor>(EquipmentClass, FTransform::Identity, SpawnParameters);
+	if(!IsValid(Equipment))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Cannot spawn equipment %s for %s."), *GetNameSafe(EquipmentClass), *GetNameSafe(this));
+		return;
+	}
+
+	const bool bIsLeftHand = Hand == EEquipmentHand::Left;
+	Equipment->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, bIsLeftHand ? LeftHandSocketName : RightHandSocketName);
+	if(Equipment->GetEquipmentState() != EEquipmentStates::EquippedTwoHand)
+	{
+		Equipment->SetEquipmentState(bIsLeftHand ? EEquipmentStates::EquippedLeftHand : EEquipmentStates::EquippedRightHand);
+	}
+}
+
 void ACeremonyCharacter::RightHandPress1()
 {
 	if(IsValid(RightHandEquipment))
@@ -634,56 +779,136 @@ void ACeremonyCharacter::SetAttackCanDamage(const bool bRightHand, const bool bI
 		}
 	}
 	
-	DebugComponent->SetAttackCanDamageText(bIsActive);
+	if(IsValid(DebugComponent))
+	{
+		DebugComponent->SetAttackCanDamageText(bIsActive);
+	}
 }
 
 void ACeremonyCharacter::SetIsAiming(const bool bAiming)
 {
 	bIsAiming = bAiming;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
+	UpdateEnduranceRate();
 }
 
 void ACeremonyCharacter::SetIsAttacking(const bool bAttacking)
 {
 	bIsAttacking = bAttacking;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 }
 
 void ACeremonyCharacter::SetIsBlocking(const bool bBlocking, const bool bIsLeftHanded)
 {
 	bIsBlocking = bBlocking;
 	bIsShieldLeftHanded = bIsLeftHanded;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
+	UpdateEnduranceRate();
 
-	if(GetLocalRole() < ROLE_Authority)
-	{
-		// The server needs to know if the character is blocking for ServerVerifyOverlapForDamage.
-		Server_SetIsBlocking(bBlocking);
-	}
+	// The server needs to know if the character is blocking for ServerVerifyOverlapForDamage.
+	CombatStateComponent->OnCombatStateChanged();
 }
 
 void ACeremonyCharacter::SetIsParrying(const bool bParry)
 {
 	bIsParrying = bParry;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
+}
+
+void ACeremonyCharacter::SetLoadout(const FCeremonyLoadout& NewLoadout)
+{
+	if(NewLoadout == Loadout)
+	{
+		return;
+	}
+
+	Loadout = NewLoadout;
+	MARK_CHARACTER_PROPERTY_DIRTY(this, Loadout);
+
+	// The server holds equipment too, for the attack tables, but doesn't receive its own replication.
+	OnRep_Loadout();
 }
 
 void ACeremonyCharacter::SetParryCanStagger(const bool bCanStagger)
 {
 	bParryCanStagger = bCanStagger;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 
-	if(GetLocalRole() < ROLE_Authority)
+	// The server needs to know if the character is in active parry frames for ServerVerifyOverlapsForDamage.
+	CombatStateComponent->OnCombatStateChanged();
+}
+
+void ACeremonyCharacter::UpdateEquipmentAnimLayers()
+{
+	TSubclassOf<UCeremonyAnimInstance> LayerClass = nullptr;
+	for(const AEquipmentActor* Equipment : {RightHandEquipment, LeftHandEquipment})
+	{
+		if(IsValid(Equipment) && Equipment->GetLinkedAnimLayerClass() != nullptr)
+		{
+			LayerClass = Equipment->GetLinkedAnimLayerClass();
+			break;
+		}
+	}
+
+	if(LayerClass == LinkedAnimLayerClass)
+	{
+		return;
+	}
+
+	// Unlinking restores the default layers before the new ones are linked, and lets the old layer instances be freed.
+	if(LinkedAnimLayerClass != nullptr)
+	{
+		GetMesh()->UnlinkAnimClassLayers(LinkedAnimLayerClass);
+	}
+
+	if(LayerClass != nullptr)
 	{
-		// The server needs to know if the character is in active parry frames for ServerVerifyOverlapsForDamage.
-		Server_SetParryCanStagger(bCanStagger);
+		GetMesh()->LinkAnimClassLayers(LayerClass);
 	}
+
+	LinkedAnimLayerClass = LayerClass;
 }
 
 #pragma endregion 
 
 #pragma region Gameplay
 
+void ACeremonyCharacter::ApplyCombatStateFlags(const ECombatStateFlags Flags)
+{
+	// Set the state directly; the setters would report the change back to the combat state component.
+	bIsBlocking = EnumHasAnyFlags(Flags, ECombatStateFlags::Blocking);
+	bIsShieldLeftHanded = EnumHasAnyFlags(Flags, ECombatStateFlags::ShieldLeftHanded);
+	bIsInvincible = EnumHasAnyFlags(Flags, ECombatStateFlags::Invincible);
+	bParryCanStagger = EnumHasAnyFlags(Flags, ECombatStateFlags::ParryCanStagger);
+
+	const bool bStaggered = EnumHasAnyFlags(Flags, ECombatStateFlags::Staggered);
+	if(bIsStaggered != bStaggered)
+	{
+		bIsStaggered = bStaggered;
+		MARK_CHARACTER_PROPERTY_DIRTY(this, bIsStaggered);
+	}
+
+	const bool bLocked = EnumHasAnyFlags(Flags, ECombatStateFlags::LockedOn);
+	if(bIsLockedOn != bLocked)
+	{
+		bIsLockedOn = bLocked;
+		MARK_CHARACTER_PROPERTY_DIRTY(this, bIsLockedOn);
+		OnRep_IsLockedOn();
+
+		// The client sends the first yaw as soon as it locks on, so it's usually here before the flag.
+		UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+		if(bIsLockedOn && bHasReceivedLockOnYaw && IsValid(CeremonyMovement))
+		{
+			CeremonyMovement->SetLockOnYaw(FRotator::DecompressAxisFromShort(ReceivedLockOnYaw));
+		}
+
+		if(!bIsLockedOn)
+		{
+			bHasReceivedLockOnYaw = false;
+		}
+	}
+}
+
 void ACeremonyCharacter::CancelActions()
 {
 	if(IsValid(LeftHandEquipment))
@@ -740,36 +965,105 @@ void ACeremonyCharacter::CheckForResumingAction()
 
 bool ACeremonyCharacter::GetCanPerformStandardAction() const
 {
-	return (Endurance > 0.0f) && !bIsKicking && !bIsParrying && !bIsStunned && !bIsStaggered && !bIsRolling && !bIsAttacking && !GetCharacterMovement()->IsFalling();
+	return (GetEndurance() > 0.0f) && !bIsKicking && !bIsParrying && !bIsStunned && !bIsStaggered && !bIsRolling && !bIsAttacking && !GetCharacterMovement()->IsFalling();
+}
+
+ECombatStateFlags ACeremonyCharacter::GetCombatStateFlags() const
+{
+	ECombatStateFlags Flags = ECombatStateFlags::None;
+
+	if(bIsBlocking)
+	{
+		Flags |= ECombatStateFlags::Blocking;
+	}
+
+	if(bIsShieldLeftHanded)
+	{
+		Flags |= ECombatStateFlags::ShieldLeftHanded;
+	}
+
+	if(bIsInvincible)
+	{
+		Flags |= ECombatStateFlags::Invincible;
+	}
+
+	if(bParryCanStagger)
+	{
+		Flags |= ECombatStateFlags::ParryCanStagger;
+	}
+
+	if(bIsLockedOn)
+	{
+		Flags |= ECombatStateFlags::LockedOn;
+	}
+
+	if(bIsStaggered)
+	{
+		Flags |= ECombatStateFlags::Staggered;
+	}
+
+	return Flags;
 }
 
 void ACeremonyCharacter::DepleteEndurance(const float EnduranceChange)
 {
-	ACeremonyPlayerController* CeremonyController = Cast<ACeremonyPlayerController>(Controller);
-	if(IsValid(CeremonyController))
+	if(!IsLocallyControlled())
 	{
-		UCeremonyUserWidget* Widget = CeremonyController->CharacterWidget;
-		if(IsValid(Widget))
-		{
-			Endurance -= EnduranceChange;
-			Widget->OnEnduranceChanged(Endurance, EnduranceMaximum);	
-		}
+		return;
+	}
+
+	Endurance = GetEndurance() - EnduranceChange;
+	EnduranceTimestamp = GetWorld()->GetTimeSeconds();
+	UpdateEnduranceRate();
+}
+
+float ACeremonyCharacter::GetEndurance() const
+{
+	const UWorld* World = GetWorld();
+	if(FMath::IsNearlyZero(EnduranceRate) || !IsValid(World))
+	{
+		return Endurance;
+	}
+
+	const float Current = Endurance + EnduranceRate * (World->GetTimeSeconds() - EnduranceTimestamp);
+	return EnduranceRate > 0.0f ? FMath::Min(Current, EnduranceMaximum) : Current;
+}
+
+bool ACeremonyCharacter::HasLineOfSightTo(const ACeremonyCharacter* OtherCharacter) const
+{
+	const UWorld* World = GetWorld();
+	if(!IsValid(World) || !IsValid(OtherCharacter))
+	{
+		return false;
 	}
+
+	// Neither character, nor the equipment they hold, counts as blocking.
+	TArray<AActor*> IgnoredActors;
+	GetAttachedActors(IgnoredActors);
+	OtherCharacter->GetAttachedActors(IgnoredActors, false);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(CeremonyCharacterLineOfSight));
+	Params.AddIgnoredActor(this);
+	Params.AddIgnoredActor(OtherCharacter);
+	Params.AddIgnoredActors(IgnoredActors);
+
+	return !World->LineTraceTestByChannel(GetActorLocation(), OtherCharacter->GetActorLocation(), ECC_Visibility, Params);
 }
 
 bool ACeremonyCharacter::IsShowingDebugCollision() const
 {
-	return DebugComponent->bEnableCollisionDebug;
+	return IsValid(DebugComponent) && DebugComponent->bEnableCollisionDebug;
 }
 
 void ACeremonyCharacter::PlayFootstepSound(const bool bRightFoot)
 {
-	const FName FootBoneName = bRightFoot? InverseKinematicsComponent->GetRightFootBoneName() : InverseKinematicsComponent->GetLeftFootBoneName();
-	USoundBase* Sound = FootstepComponent->GetFootstepSound(FootBoneName);
-	if(Sound != nullptr)
+	if(!IsValid(FootstepComponent) || Significance == ECeremonySignificance::Low)
 	{
-		Server_PlaySound(Sound);
+		return;
 	}
+	
+	const FName FootBoneName = bRightFoot? InverseKinematicsComponent->GetRightFootBoneName() : InverseKinematicsComponent->GetLeftFootBoneName();
+	FootstepComponent->PlayFootstepSound(FootBoneName);
 }
 
 void ACeremonyCharacter::PlaySound(USoundBase* Sound) const
@@ -793,7 +1087,7 @@ void ACeremonyCharacter::OnRep_Health() const
 	}
 	else
 	{
-		UCeremonyOpponentUserWidget* OpWidget = Cast<UCeremonyOpponentUserWidget>(OpponentWidget->GetUserWidgetObject());
+		UCeremonyOpponentUserWidget* OpWidget = GetOpponentUserWidget();
 		if(IsValid(OpWidget))
 		{
 			OpWidget->OnHealthChanged(Health, HealthMaximum);
@@ -801,141 +1095,409 @@ void ACeremonyCharacter::OnRep_Health() const
 	}
 }
 
+void ACeremonyCharacter::OnEnduranceRanOut()
+{
+	Endurance = RunToZeroEndurancePenalty;
+	EnduranceTimestamp = GetWorld()->GetTimeSeconds();
+	EnduranceRate = 0.0f;
+	
+	// Stopping the run updates the rate and the widget.
+	SetIsRunning(false);
+}
+
+void ACeremonyCharacter::OnStaggerExpired()
+{
+	SetIsStaggered(false);
+	SetAllowMovement(true);
+	StopMontageGlobally();
+}
+
+void ACeremonyCharacter::OnStunExpired()
+{
+	StunCount = 0;
+	SetIsStunned(false);
+	SetAllowMovement(true);
+	StopMontageGlobally();
+}
+
 void ACeremonyCharacter::SetAllowEnduranceRecovery(const bool bAllowRecovery)
 {
 	bAllowEnduranceRecovery = bAllowRecovery;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
+	UpdateEnduranceRate();
 }
 
-void ACeremonyCharacter::SetIsInvincible(const bool bInvincible)
+void ACeremonyCharacter::SetHealth(const float NewHealth)
 {
-	bIsInvincible = bInvincible;
-	DebugComponent->UpdateCharacterStateText();
+	Health = FMath::Clamp(NewHealth, 0.0f, HealthMaximum);
+	MARK_CHARACTER_PROPERTY_DIRTY(this, Health);
 
-	if(GetLocalRole() < ROLE_Authority)
+	if(GetNetMode() == NM_ListenServer)
 	{
-		// The server needs to know if the character is invincible for ServerVerifyOverlapForDamage.
-		Server_SetIsInvincible(bInvincible);
+		// Listen server will need to force an update, because it will not call OnRep locally when health changes, so the bar won't update.
+		OnRep_Health();
 	}
 }
 
+void ACeremonyCharacter::SetIsInvincible(const bool bInvincible)
+{
+	bIsInvincible = bInvincible;
+	UpdateDebugStateText();
+
+	// The server needs to know if the character is invincible for ServerVerifyOverlapForDamage.
+	CombatStateComponent->OnCombatStateChanged();
+}
+
 void ACeremonyCharacter::SetIsStaggered(const bool bStaggered)
 {
-	if(bStaggered)
+	// Stagger is released by the locally controlled character.
+	FTimerManager& TimerManager = GetWorldTimerManager();
+	if(bStaggered && IsLocallyControlled())
 	{
-		StaggerTimer = StaggerTime;		
+		TimerManager.SetTimer(StaggerTimerHandle, this, &ACeremonyCharacter::OnStaggerExpired, StaggerTime);
 	}
 	else
 	{
-		StaggerTimer = 0.0f;
+		TimerManager.ClearTimer(StaggerTimerHandle);
 	}
 
 	bIsStaggered = bStaggered;
-	DebugComponent->UpdateCharacterStateText();
+	MARK_CHARACTER_PROPERTY_DIRTY(this, bIsStaggered);
+	UpdateDebugStateText();
+
+	// The server replicates stagger to all clients, so they know the character can be riposted.
+	CombatStateComponent->OnCombatStateChanged();
 }
 
 void ACeremonyCharacter::SetIsStunned(const bool bStunned)
 {
+	if(!bStunned)
+	{
+		GetWorldTimerManager().ClearTimer(StunTimerHandle);
+	}
+	
 	bIsStunned = bStunned;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 }
 
-void ACeremonyCharacter::SetOpponentHasLockedOn(const bool bHasLockedOn) const
+void ACeremonyCharacter::SetOpponentHasLockedOn(const bool bHasLockedOn)
 {
-	LockOnWidget->SetVisibility(bHasLockedOn);
+	bOpponentHasLockedOn = bHasLockedOn;
+	
+	if(IsValid(LockOnWidget))
+	{
+		LockOnWidget->SetVisibility(bHasLockedOn);
+	}
 
-	UCeremonyOpponentUserWidget* UserWidget = Cast<UCeremonyOpponentUserWidget>(OpponentWidget->GetUserWidgetObject());
+	UCeremonyOpponentUserWidget* UserWidget = GetOpponentUserWidget();
 	if(IsValid(UserWidget))
 	{
 		UserWidget->SetHealthBarStayVisible(bHasLockedOn);	
 	}
 }
 
-#pragma endregion
+void ACeremonyCharacter::UpdateEnduranceRate()
+{
+	// Endurance is only kept by the locally controlled character.
+	if(!IsLocallyControlled())
+	{
+		return;
+	}
 
-#pragma region Kick
+	// Continue from the current value at the new rate.
+	Endurance = GetEndurance();
+	EnduranceTimestamp = GetWorld()->GetTimeSeconds();
 
-void ACeremonyCharacter::Kick()
-{
-	if(GetCanPerformStandardAction())
+	FTimerManager& TimerManager = GetWorldTimerManager();
+	TimerManager.ClearTimer(EnduranceTimerHandle);
+	
+	if(bIsRunning && bHasMovementInput)
 	{
-		bKickOnResumeAction = false;
-		
-		if(bIsBlocking)
+		if(Endurance <= 0.0f)
 		{
-			CancelBlocking();
+			OnEnduranceRanOut();
+			return;
 		}
 
-		if(bIsRunning)
+		EnduranceRate = -RunEnduranceCostPerSecond;
+		if(RunEnduranceCostPerSecond > 0.0f)
 		{
-			SetIsRunning(false);
+			TimerManager.SetTimer(EnduranceTimerHandle, this, &ACeremonyCharacter::OnEnduranceRanOut, Endurance / RunEnduranceCostPerSecond);
+		}
+	}
+	else if(bAllowEnduranceRecovery && Endurance < EnduranceMaximum)
+	{
+		EnduranceRate = EnduranceRecoveryPerSecond;
+		if(bIsBlocking)
+		{
+			EnduranceRate = BlockingEnduranceRecoveryPerSecond;
+		}
+		else if(bIsAiming)
+		{
+			EnduranceRate = AimingEnduranceRecoveryPerSecond;
 		}
-
-		KickedActors.Empty();
-		
-		DepleteEndurance(KickEnduranceConsumption);
-		SetAllowEnduranceRecovery(false);
-		SetAllowMovement(false);
-		PlayMontageGlobally(KickMontage);
-		SetOnMontageEndedDelegate(this, "OnKickMontageComplete", KickMontage);
-
-		SetIsKicking(true);
 	}
 	else
 	{
-		bKickOnResumeAction = true;
+		EnduranceRate = 0.0f;
 	}
-}
 
-void ACeremonyCharacter::OnKickComponentOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
-{
-	const UWorld* World = GetWorld();
-	
-	// Prevent kicking a character more than once with the same kick.
-	if(KickedActors.Contains(OtherActor) || !IsValid(World))
+	// The widget follows the rate itself, so it only needs to be told when it changes.
+	ACeremonyPlayerController* CeremonyController = Cast<ACeremonyPlayerController>(Controller);
+	if(IsValid(CeremonyController))
 	{
-		return;
+		UCeremonyUserWidget* Widget = CeremonyController->CharacterWidget;
+		if(IsValid(Widget))
+		{
+			Widget->OnEnduranceChanged(Endurance, EnduranceMaximum, EnduranceRate);	
+		}
 	}
+}
 
-	// They have overlapped, we need to get the location of the overlap by sweeping a small distance.
-	TArray<FHitResult> OutHits;
+#pragma endregion
 
-	const FVector Start = KickCapsuleComponent->GetComponentLocation();
-	const FVector End = FVector(Start.X + 1.0f, Start.Y + 1.0f, Start.Z + 1.0f);
-	
-	FCollisionObjectQueryParams ObjectQueryParams;
-	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
+#pragma region HitLog
 
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(this);
-	Params.AddIgnoredActors(KickedActors);
-	
-	if(World->SweepMultiByObjectType(OutHits, Start, End, KickCapsuleComponent->GetComponentRotation().Quaternion(), ObjectQueryParams, KickCapsuleComponent->GetCollisionShape(), Params))
+void ACeremonyCharacter::ApplyBackStabbed()
+{
+	CancelActions();
+	SetAllowMovement(false);
+	SetIsInvincible(true);
+	SetAllowEnduranceRecovery(false);
+	PlayMontageGlobally(BackStabMontage);
+	SetOnMontageEndedDelegate(this, "OnBackStabOrRiposteMontageEnded", BackStabMontage);
+}
+
+void ACeremonyCharacter::ApplyDepleteEnduranceCanStagger(const float EnduranceToDeplete)
+{
+	DepleteEndurance(EnduranceToDeplete);
+
+	if(bIsBlocking)
 	{
-		for(auto OutHit : OutHits)
+		AShieldActor* ShieldActor;
+		if(bIsShieldLeftHanded)
 		{
-			if(OutHit.Actor == OtherActor && OutHit.GetComponent() == OtherComp)
-			{
-				if(IsShowingDebugCollision())
-				{
-					DrawDebugCapsule(World, Start, KickCapsuleComponent->GetScaledCapsuleHalfHeight(),
-					                 KickCapsuleComponent->GetScaledCapsuleRadius(),
-					                 KickCapsuleComponent->GetComponentRotation().Quaternion(), FColor::Red, false, 3.0f, 0, 0);
-					
-					DrawDebugSphere(World, OutHit.ImpactPoint, 3.0f, 8, FColor::Red, false, 3.0f, 0, 1);
-				}
+			ShieldActor = Cast<AShieldActor>(LeftHandEquipment);
+		}
+		else
+		{
+			ShieldActor = Cast<AShieldActor>(RightHandEquipment);
+		}
 
-				KickedActors.Add(OtherActor);
+		if(IsValid(ShieldActor) && GetEndurance() > 0.0f)
+		{
+			ShieldActor->ShowBlockImpact();
+		}
+	}
 
-				ACeremonyCharacter* CharacterHit = Cast<ACeremonyCharacter>(OutHit.GetActor());
-				
-				const FVector Packed = FVector(0.0f, KickEnduranceDamage, 0.0f);
-				Server_VerifyOverlapForDamage(CharacterHit, OutHit.ImpactPoint, Packed, static_cast<uint8>(EDamageTypes::Kick));
-				break;
-			}
+	if(GetEndurance() < 0.0f)
+	{
+		ApplyStaggered();
+	}
+}
+
+void ACeremonyCharacter::ApplyOpponentWidgetDamage(const float Damage) const
+{
+	UCeremonyOpponentUserWidget* OpWidget = GetOpponentUserWidget();
+	if(IsValid(OpWidget))
+	{
+		OpWidget->OnDamageChanged(Damage);
+	}
+}
+
+void ACeremonyCharacter::ApplyRiposted()
+{
+	CancelActions();
+	SetIsStaggered(false);
+	SetAllowMovement(false);
+	SetIsInvincible(true);
+	SetAllowEnduranceRecovery(false);
+	PlayMontageGlobally(RiposteMontage);
+	SetOnMontageEndedDelegate(this, "OnBackStabOrRiposteMontageEnded", RiposteMontage);
+}
+
+void ACeremonyCharacter::ApplyStaggered()
+{
+	LeftHandEquipment->CancelActions();
+	RightHandEquipment->CancelActions();
+	SetAllowMovement(false);
+	SetIsStaggered(true);
+	PlayMontageGlobally(StaggerMontage);
+}
+
+void ACeremonyCharacter::ApplyStunned(const float InStunTime)
+{
+	if(GetIsStaggered())
+	{
+		// Stop stagger and become stunned.
+		SetIsStaggered(false);
+	}
+
+	StunCount++;
+	if(StunCount > StunCountMaximum)
+	{
+		SetIsStunned(false);
+		StunCount = 0;
+		SetAllowMovement(true);
+		StopMontageGlobally();
+	}
+	else
+	{
+		// Stun is released by the locally controlled character; hits while stunned restart the timer.
+		if(IsLocallyControlled())
+		{
+			GetWorldTimerManager().SetTimer(StunTimerHandle, this, &ACeremonyCharacter::OnStunExpired, InStunTime);
+		}
+
+		// If already stunned, just continue to wait for the timer to stop the stun.
+		if(bIsStunned)
+		{
+			return;
+		}
+
+		// Otherwise, play the stunned montage and set the flag.
+		CancelActions();
+		SetAllowMovement(false);
+		SetIsStunned(true);
+		PlayMontageGlobally(StunMontage);
+	}
+}
+
+USoundBase* ACeremonyCharacter::GetHitSound(const EHitSound HitSound) const
+{
+	switch(HitSound)
+	{
+	case EHitSound::AttackHit:
+		return AttackHitSound;
+	case EHitSound::BlockAttack:
+		return BlockAttackSound;
+	case EHitSound::KickBlocked:
+		return KickBlockedSound;
+	case EHitSound::KickInterrupt:
+		return KickInterruptSound;
+	case EHitSound::Parry:
+		return ParrySound;
+	default:
+		return nullptr;
+	}
+}
+
+void ACeremonyCharacter::OnHitRecordReceived(const FHitRecord& Record)
+{
+	// Records that are too old to react to; the character just became relevant, or the record was delayed.
+	if(UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this) - Record.ServerTime > HitRecordLifetime)
+	{
+		return;
+	}
+
+	// The sound plays at the location of the character that caused the hit.
+	USoundBase* Sound = GetHitSound(Record.Sound);
+	if(Sound != nullptr)
+	{
+		if(IsValid(Record.Instigator))
+		{
+			Record.Instigator->PlaySound(Sound);
+		}
+		else
+		{
+			PlaySound(Sound);
+		}
+	}
+
+	// Opponents see the damage indicator; the locally controlled character plays the reaction.
+	if(!IsLocallyControlled())
+	{
+		if(Record.QuantizedDamage > 0)
+		{
+			ApplyOpponentWidgetDamage(Record.GetDamage());
+		}
+		return;
+	}
+
+	switch(Record.Reaction)
+	{
+	case EHitReaction::BackStabbed:
+		ApplyBackStabbed();
+		break;
+	case EHitReaction::DepleteEnduranceCanStagger:
+		ApplyDepleteEnduranceCanStagger(Record.ReactionValue);
+		break;
+	case EHitReaction::Riposted:
+		ApplyRiposted();
+		break;
+	case EHitReaction::Staggered:
+		ApplyStaggered();
+		break;
+	case EHitReaction::Stunned:
+		ApplyStunned(Record.ReactionValue);
+		break;
+	default:
+		break;
+	}
+}
+
+#pragma endregion
+
+#pragma region Kick
+
+float ACeremonyCharacter::GetKickReach() const
+{
+	// The capsule is offset from the socket and lies along its up axis.
+	return KickCapsuleComponent->GetRelativeLocation().Size() + KickCapsuleComponent->GetScaledCapsuleHalfHeight();
+}
+
+FName ACeremonyCharacter::GetKickSocketName() const
+{
+	return KickCapsuleComponent->GetAttachSocketName();
+}
+
+void ACeremonyCharacter::Kick()
+{
+	if(GetCanPerformStandardAction())
+	{
+		bKickOnResumeAction = false;
+		
+		if(bIsBlocking)
+		{
+			CancelBlocking();
+		}
+
+		if(bIsRunning)
+		{
+			SetIsRunning(false);
 		}
-	}	
+
+		DepleteEndurance(KickEnduranceConsumption);
+		SetAllowEnduranceRecovery(false);
+		SetAllowMovement(false);
+		PlayMontageGlobally(KickMontage);
+		SetOnMontageEndedDelegate(this, "OnKickMontageComplete", KickMontage);
+
+		SetIsKicking(true);
+	}
+	else
+	{
+		bKickOnResumeAction = true;
+	}
+}
+
+void ACeremonyCharacter::OnKickHit(const FHitResult& Hit)
+{
+	if(IsShowingDebugCollision())
+	{
+		const UWorld* World = GetWorld();
+		DrawDebugCapsule(World, Hit.Location, KickCapsuleComponent->GetScaledCapsuleHalfHeight(),
+		                 KickCapsuleComponent->GetScaledCapsuleRadius(),
+		                 KickCapsuleComponent->GetComponentRotation().Quaternion(), FColor::Red, false, 3.0f, 0, 0);
+		
+		DrawDebugSphere(World, Hit.ImpactPoint, 3.0f, 8, FColor::Red, false, 3.0f, 0, 1);
+	}
+
+	ACeremonyCharacter* CharacterHit = Cast<ACeremonyCharacter>(Hit.GetActor());
+	
+	// The kick has no weapon; the server uses the character's kick values. The kick montage may still be queued.
+	SendPendingCosmeticAnimMontage();
+	Server_VerifyOverlapForDamage(CharacterHit, Hit.ImpactPoint, EEquipmentHand::None, 0, 0, UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this));
 }
 
 void ACeremonyCharacter::OnKickMontageComplete(UAnimMontage* Montage, const bool bInterrupted)
@@ -946,25 +1508,28 @@ void ACeremonyCharacter::OnKickMontageComplete(UAnimMontage* Montage, const bool
 	SetIsKicking(false);
 	CheckForResumingAction();
 
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 }
 
 void ACeremonyCharacter::SetIsKicking(const bool bKick)
 {
 	bIsKicking = bKick;
 
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 }
 
 void ACeremonyCharacter::SetKickCanDamage(const bool bCanDamage) const
 {
-	KickCapsuleComponent->SetGenerateOverlapEvents(bCanDamage);
+	KickCapsuleComponent->SetCanHit(bCanDamage);
 
 	if(IsShowingDebugCollision())
 	{
 		KickCapsuleComponent->SetHiddenInGame(!bCanDamage);
 	}
-	DebugComponent->SetKickCanDamageText(bCanDamage);
+	if(IsValid(DebugComponent))
+	{
+		DebugComponent->SetKickCanDamageText(bCanDamage);
+	}
 }
 
 #pragma endregion 
@@ -985,6 +1550,31 @@ void ACeremonyCharacter::ClearOnMontageEndedDelegate() const
 	}
 }
 
+void ACeremonyCharacter::FlushCosmeticAnimMontage(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if(World != GetWorld())
+	{
+		return;
+	}
+
+	SendPendingCosmeticAnimMontage();
+}
+
+void ACeremonyCharacter::GetMontages(TArray<UAnimMontage*>& OutMontages) const
+{
+	OutMontages.Add(BackStabMontage);
+	OutMontages.Add(KickMontage);
+	OutMontages.Add(RiposteMontage);
+	OutMontages.Add(RollMontage);
+	OutMontages.Add(StaggerMontage);
+	OutMontages.Add(StunMontage);
+
+	if(IsValid(LockOnComponent))
+	{
+		OutMontages.Add(LockOnComponent->GetYawCorrectionMontage());
+	}
+}
+
 void ACeremonyCharacter::OnBackStabOrRiposteMontageEnded(UAnimMontage* Montage, const bool bInterrupted)
 {
 	SetAllowMovement(true);
@@ -1002,14 +1592,21 @@ void ACeremonyCharacter::OnRepCosmeticAnimMontage() const
 		UAnimInstance* AnimInstance = SkeletalMesh->GetAnimInstance();
 		if(IsValid(AnimInstance))
 		{
-			if(IsValid(CosmeticAnimMontage.Montage))
-			{
-				AnimInstance->Montage_Play(CosmeticAnimMontage.Montage, 1.0f, EMontagePlayReturnType::MontageLength, CosmeticAnimMontage.Position);
-			}
-			else
+			UCeremonyMontageRegistry* MontageRegistry = UCeremonyMontageRegistry::Get(this);
+			UAnimMontage* Montage = IsValid(MontageRegistry) ? MontageRegistry->GetMontage(CosmeticAnimMontage.MontageId, this) : nullptr;
+			if(IsValid(Montage))
 			{
-				AnimInstance->Montage_Stop(MontageBlendOutTime);
+				// Catch up with the time the montage has been playing on the owning client, so late receivers aren't behind.
+				const float Elapsed = FMath::Max(UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this) - CosmeticAnimMontage.ServerStartTime, 0.0f);
+				const float Position = CosmeticAnimMontage.GetPosition() + Elapsed;
+				if(Position < Montage->GetPlayLength())
+				{
+					AnimInstance->Montage_Play(Montage, 1.0f, EMontagePlayReturnType::MontageLength, Position);
+					return;
+				}
 			}
+
+			AnimInstance->Montage_Stop(MontageBlendOutTime);
 		}
 	}
 }
@@ -1039,7 +1636,55 @@ float ACeremonyCharacter::PlayMontage(UAnimMontage* MontageToPlay, const FName J
 void ACeremonyCharacter::PlayMontageGlobally(UAnimMontage* MontageToPlay, const FName JumpToSection)
 {
 	const float Position = PlayMontage(MontageToPlay, JumpToSection);
-	Server_PlayCosmeticAnimMontage(MontageToPlay, Position);
+
+	UCeremonyMontageRegistry* MontageRegistry = UCeremonyMontageRegistry::Get(this);
+	if(!IsValid(MontageRegistry))
+	{
+		return;
+	}
+	
+	FCosmeticAnimMontage NewCosmeticAnimMontage;
+	NewCosmeticAnimMontage.MontageId = MontageRegistry->GetMontageId(MontageToPlay, this);
+	NewCosmeticAnimMontage.QuantizedPosition = FCosmeticAnimMontage::QuantizePosition(Position);
+	NewCosmeticAnimMontage.ServerStartTime = UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this);
+	QueueCosmeticAnimMontage(NewCosmeticAnimMontage);
+}
+
+void ACeremonyCharacter::QueueCosmeticAnimMontage(const FCosmeticAnimMontage& NewCosmeticAnimMontage)
+{
+	PendingCosmeticAnimMontage = NewCosmeticAnimMontage;
+	
+	if(FlushCosmeticAnimMontageHandle.IsValid())
+	{
+		// Replaces a request made earlier in the frame.
+		INC_DWORD_STAT(STAT_MontageRPCsElided);
+		return;
+	}
+	
+	FlushCosmeticAnimMontageHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ACeremonyCharacter::FlushCosmeticAnimMontage);
+}
+
+void ACeremonyCharacter::SendPendingCosmeticAnimMontage()
+{
+	if(!FlushCosmeticAnimMontageHandle.IsValid())
+	{
+		return;
+	}
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(FlushCosmeticAnimMontageHandle);
+	FlushCosmeticAnimMontageHandle.Reset();
+
+	// Stopping when already stopped.
+	if(PendingCosmeticAnimMontage == LastSentCosmeticAnimMontage)
+	{
+		INC_DWORD_STAT(STAT_MontageRPCsElided);
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_MontageRPCsSent);
+	
+	LastSentCosmeticAnimMontage = PendingCosmeticAnimMontage;
+	Server_PlayCosmeticAnimMontage(PendingCosmeticAnimMontage);
 }
 
 void ACeremonyCharacter::SetOnMontageEndedDelegate(UObject* UserObject, FName FunctionName,
@@ -1066,7 +1711,7 @@ void ACeremonyCharacter::StopMontageGlobally()
 		if(IsValid(AnimInstance))
 		{
 			AnimInstance->Montage_Stop(MontageBlendOutTime);
-			Server_PlayCosmeticAnimMontage(nullptr, 0);
+			QueueCosmeticAnimMontage(FCosmeticAnimMontage());
 		}
 	}
 }
@@ -1121,7 +1766,7 @@ void ACeremonyCharacter::GetForcedMovement(bool& bOutForcedMovement, float& OutF
 
 void ACeremonyCharacter::Jump()
 {
-	if(!GetCharacterMovement()->IsFalling() && Endurance > 0.0f)
+	if(!GetCharacterMovement()->IsFalling() && GetEndurance() > 0.0f)
 	{
 		DepleteEndurance(JumpEnduranceConsumption);
 		Super::Jump();
@@ -1159,6 +1804,7 @@ void ACeremonyCharacter::MoveForward(float AxisValue)
 	}
 
 	MoveForwardLastValue = AxisValue;
+	UpdateHasMovementInput();
 }
 
 void ACeremonyCharacter::MoveRight(float AxisValue)
@@ -1187,11 +1833,24 @@ void ACeremonyCharacter::MoveRight(float AxisValue)
 	}
 
 	MoveRightLastValue = AxisValue;
+	UpdateHasMovementInput();
+}
+
+void ACeremonyCharacter::ResendLockOnYaw()
+{
+	UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+	if(!bIsLockedOn || !IsValid(CeremonyMovement) || !CeremonyMovement->HasLockOnYaw())
+	{
+		GetWorldTimerManager().ClearTimer(LockOnYawResendTimerHandle);
+		return;
+	}
+
+	Server_SetLockOnYaw(LastSentLockOnYaw);
 }
 
 void ACeremonyCharacter::RunPress()
 {
-	if(Endurance < 0.0f)
+	if(GetEndurance() < 0.0f)
 	{
 		return;
 	}
@@ -1227,12 +1886,21 @@ void ACeremonyCharacter::RunRelease()
 void ACeremonyCharacter::OnRep_IsLockedOn() const
 {
 	GetCharacterMovement()->bOrientRotationToMovement = !bIsLockedOn;
+
+	if(!bIsLockedOn)
+	{
+		UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+		if(IsValid(CeremonyMovement))
+		{
+			CeremonyMovement->ClearLockOnYaw();
+		}
+	}
 }
 
 void ACeremonyCharacter::SetAllowMovement(const bool bAllow)
 {
 	bAllowMovement = bAllow;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 }
 
 void ACeremonyCharacter::SetAnimMovement(const bool bInForcedMovement, const float InForcedMovementRate, const EMovementType UnlockedType,
@@ -1276,12 +1944,38 @@ void ACeremonyCharacter::SetAnimMovement(const bool bInForcedMovement, const flo
 		ForcedMovementDirection = FVector::ZeroVector;
 	}
 
-	DebugComponent->UpdateCharacterStateText();
+	// The forced movement input itself reaches the server as move acceleration; the flag travels with the saved moves.
+	UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+	if(IsValid(CeremonyMovement))
+	{
+		CeremonyMovement->SetWantsForcedMovement(bForcedMovement);
+	}
+
+	// Tick only while there's forced movement to apply.
+	SetActorTickEnabled(bForcedMovement && IsLocallyControlled());
+	
+	UpdateDebugStateText();
+}
+
+void ACeremonyCharacter::UpdateHasMovementInput()
+{
+	const bool bHasInput = !FMath::IsNearlyZero(MoveForwardLastValue) || !FMath::IsNearlyZero(MoveRightLastValue);
+	if(bHasMovementInput != bHasInput)
+	{
+		bHasMovementInput = bHasInput;
+
+		// Running only costs endurance while moving.
+		if(bIsRunning)
+		{
+			UpdateEnduranceRate();
+		}
+	}
 }
 
 void ACeremonyCharacter::SetIsLockedOn(const bool bLocked)
 {
 	bIsLockedOn = bLocked;
+	MARK_CHARACTER_PROPERTY_DIRTY(this, bIsLockedOn);
 	
 	if(bLocked)
 	{
@@ -1290,32 +1984,69 @@ void ACeremonyCharacter::SetIsLockedOn(const bool bLocked)
 	else
 	{
 		GetCharacterMovement()->bOrientRotationToMovement = true;
+
+		UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+		if(IsValid(CeremonyMovement))
+		{
+			CeremonyMovement->ClearLockOnYaw();
+		}
 	}
 
 	if(IsLocallyControlled())
 	{
-		DebugComponent->UpdateCharacterStateText();			
+		UpdateDebugStateText();			
 	}
 
-	if(GetLocalRole() < ROLE_Authority)
-	{
-		// Set the locked on value on the server; it must replicate to all clients, so when animating the character will play proper animations.
-		Server_SetIsLockedOn(bLocked);
-	}
+	// Set the locked on value on the server; it must replicate to all clients, so when animating the character will play proper animations.
+	CombatStateComponent->OnCombatStateChanged();
 }
 
-void ACeremonyCharacter::SetIsRunning(const bool bRun)
+void ACeremonyCharacter::SetLockOnYaw(const float Yaw)
 {
-	if(bIsRunning != bRun)
+	UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+	if(!IsValid(CeremonyMovement))
 	{
-		bIsRunning = bRun;
-		DebugComponent->UpdateCharacterStateText();
-
-		// Need to replicate if this character has started running to all clients.
-		if(GetLocalRole() < ROLE_Authority)
-		{
-			Server_SetIsRunning(bIsRunning);
-		}
+		return;
+	}
+
+	const bool bHadLockOnYaw = CeremonyMovement->HasLockOnYaw();
+	CeremonyMovement->SetLockOnYaw(Yaw);
+	
+	if(GetLocalRole() < ROLE_Authority)
+	{
+		// Only send when the yaw has moved far enough; the signed difference of the compressed values handles wrapping around.
+		const uint16 CompressedYaw = FRotator::CompressAxisToShort(Yaw);
+		const int32 CompressedThreshold = FMath::CeilToInt(LockOnYawSendThreshold * 65536.0f / 360.0f);
+		
+		if(!bHadLockOnYaw || FMath::Abs(static_cast<int16>(CompressedYaw - LastSentLockOnYaw)) >= CompressedThreshold)
+		{
+			LastSentLockOnYaw = CompressedYaw;
+			Server_SetLockOnYaw(CompressedYaw);
+		}
+
+		if(!GetWorldTimerManager().IsTimerActive(LockOnYawResendTimerHandle))
+		{
+			GetWorldTimerManager().SetTimer(LockOnYawResendTimerHandle, this, &ACeremonyCharacter::ResendLockOnYaw, LockOnYawResendInterval, true);
+		}
+	}
+}
+
+void ACeremonyCharacter::SetIsRunning(const bool bRun)
+{
+	if(bIsRunning != bRun)
+	{
+		bIsRunning = bRun;
+		MARK_CHARACTER_PROPERTY_DIRTY(this, bIsRunning);
+		UpdateDebugStateText();
+
+		// Run state reaches the server with each saved move, so the server replays moves at the same speed.
+		UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+		if(IsValid(CeremonyMovement))
+		{
+			CeremonyMovement->SetWantsToRun(bRun);
+		}
+
+		UpdateEnduranceRate();
 	}
 }
 
@@ -1332,26 +2063,169 @@ void ACeremonyCharacter::Multicast_KillCharacter_Implementation(ACeremonyCharact
 {
 	CharacterToKill->GetCharacterMovement()->StopMovementImmediately();
 	CharacterToKill->SetActorTickEnabled(false);
+	CharacterToKill->GetWorldTimerManager().ClearAllTimersForObject(CharacterToKill);
 	CharacterToKill->GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	CharacterToKill->GetMesh()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 	CharacterToKill->GetMesh()->SetSimulatePhysics(true);
+
+	// The equipment is kept for the character pool, so stop the dead character from using it.
+	CharacterToKill->DisableInput(nullptr);
 }
 
-void ACeremonyCharacter::Multicast_SetActorRotation_Implementation(const FRotator Rotation)
+void ACeremonyCharacter::Multicast_LaunchProjectile_Implementation(const EEquipmentHand Hand, const FVector_NetQuantize Location, const FRotator Rotation)
 {
-	SetActorRotation(Rotation);
+	// The firing client launched it already.
+	if(IsLocallyControlled())
+	{
+		return;
+	}
+
+	const ARangedWeaponActor* RangedWeapon = Cast<ARangedWeaponActor>(GetEquipment(Hand));
+	if(!IsValid(RangedWeapon))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Character %s tried to fire a projectile without a ranged weapon."), *GetNameSafe(this));
+		return;
+	}
+
+	RangedWeapon->LaunchProjectile(Location, Rotation);
 }
 
-void ACeremonyCharacter::Multicast_SetOpponentWidgetDamage_Implementation(const float Damage)
+#pragma endregion
+
+#pragma region Pool
+
+void ACeremonyCharacter::Client_ResetCharacterState_Implementation()
 {
+	ResetCharacterState();
+}
+
+void ACeremonyCharacter::EnterPool()
+{
+	// Reset the owning client while it still owns the character; the server keeps its own copy of the state.
+	Client_ResetCharacterState();
 	if(!IsLocallyControlled())
 	{
-		UCeremonyOpponentUserWidget* OpWidget = Cast<UCeremonyOpponentUserWidget>(OpponentWidget->GetUserWidgetObject());
-		if(IsValid(OpWidget))
+		ResetCharacterState();
+	}
+
+	if(IsValid(Controller))
+	{
+		Controller->UnPossess();
+	}
+
+	bIsPooled = true;
+	MARK_CHARACTER_PROPERTY_DIRTY(this, bIsPooled);
+
+	// The server doesn't get OnRep, so apply it directly.
+	OnRep_IsPooled();
+}
+
+void ACeremonyCharacter::LeavePool(const FTransform& Transform)
+{
+	SetActorLocationAndRotation(Transform.GetLocation(), Transform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+	SetHealth(HealthMaximum);
+
+	// The recorded capsules are where the corpse lay.
+	LagCompensationComponent->ResetHistory();
+
+	bIsPooled = false;
+	MARK_CHARACTER_PROPERTY_DIRTY(this, bIsPooled);
+	OnRep_IsPooled();
+}
+
+void ACeremonyCharacter::OnRep_IsPooled()
+{
+	USkeletalMeshComponent* SkeletalMesh = GetMesh();
+	if(bIsPooled)
+	{
+		UnregisterFromSubsystems();
+
+		// Stop the ragdoll and put the mesh back on the capsule; the equipment attached to it is hidden with it.
+		SkeletalMesh->SetSimulatePhysics(false);
+		SkeletalMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		SkeletalMesh->AttachToComponent(GetCapsuleComponent(), FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+		SkeletalMesh->SetRelativeLocationAndRotation(GetBaseTranslationOffset(), GetBaseRotationOffset());
+		SkeletalMesh->SetVisibility(false, true);
+
+		UAnimInstance* AnimInstance = SkeletalMesh->GetAnimInstance();
+		if(IsValid(AnimInstance))
 		{
-			OpWidget->OnDamageChanged(Damage);
+			AnimInstance->StopAllMontages(0.0f);
 		}
 	}
+	else
+	{
+		// Restore the capsule collision the character was created with.
+		const ACeremonyCharacter* DefaultCharacter = GetClass()->GetDefaultObject<ACeremonyCharacter>();
+		GetCapsuleComponent()->SetCollisionEnabled(DefaultCharacter->GetCapsuleComponent()->GetCollisionEnabled());
+		
+		SkeletalMesh->SetVisibility(true, true);
+		EnableInput(nullptr);
+
+		RegisterWithSubsystems();
+	}
+}
+
+void ACeremonyCharacter::RegisterWithSubsystems()
+{
+	// Make this character visible to target queries.
+	UCeremonyCharacterRegistry* CharacterRegistry = UCeremonyCharacterRegistry::Get(this);
+	if(IsValid(CharacterRegistry))
+	{
+		CharacterRegistry->RegisterCharacter(this);
+	}
+
+	// Scale the cosmetic cost to how much the character matters to local players.
+	UCeremonySignificanceSubsystem* SignificanceSubsystem = UCeremonySignificanceSubsystem::Get(this);
+	if(GetNetMode() != NM_DedicatedServer && IsValid(SignificanceSubsystem))
+	{
+		SignificanceSubsystem->RegisterCharacter(this);
+	}
+}
+
+void ACeremonyCharacter::ResetCharacterState()
+{
+	CancelActions();
+	ClearOnMontageEndedDelegate();
+
+	if(bForcedMovement)
+	{
+		SetAnimMovement(false);
+	}
+
+	SetAllowEnduranceRecovery(true);
+	SetAllowMovement(true);
+	SetIsAiming(false);
+	SetIsInvincible(false);
+
+	bKickOnResumeAction = false;
+	bRollOnResumeAction = false;
+	bRunHeldDown = false;
+	bLeftHandPress1HeldDown = false;
+	bLeftHandPress2HeldDown = false;
+	bRightHandPress1HeldDown = false;
+	bRightHandPress2HeldDown = false;
+	StunCount = 0;
+
+	Endurance = EnduranceMaximum;
+	EnduranceTimestamp = GetWorld()->GetTimeSeconds();
+	EnduranceRate = 0.0f;
+	UpdateEnduranceRate();
+}
+
+void ACeremonyCharacter::UnregisterFromSubsystems()
+{
+	UCeremonyCharacterRegistry* CharacterRegistry = UCeremonyCharacterRegistry::Get(this);
+	if(IsValid(CharacterRegistry))
+	{
+		CharacterRegistry->UnregisterCharacter(this);
+	}
+
+	UCeremonySignificanceSubsystem* SignificanceSubsystem = UCeremonySignificanceSubsystem::Get(this);
+	if(IsValid(SignificanceSubsystem))
+	{
+		SignificanceSubsystem->UnregisterCharacter(this);
+	}
 }
 
 #pragma endregion
@@ -1398,37 +2272,151 @@ void ACeremonyCharacter::Roll()
 void ACeremonyCharacter::SetIsRolling(const bool bRoll)
 {
 	bIsRolling = bRoll;
-	DebugComponent->UpdateCharacterStateText();
+	UpdateDebugStateText();
 }
 
 #pragma endregion
 
 #pragma region Server
 
-void ACeremonyCharacter::Server_SetActorRotation_Implementation(const FRotator NewRotation)
-{
-	Multicast_SetActorRotation(NewRotation);
-}
-
 void ACeremonyCharacter::Server_HelperKillCharacter(ACeremonyCharacter* Character)
 {
 	// Kill character on the server.
 	Character->GetCharacterMovement()->StopMovementImmediately();
 	Character->SetActorTickEnabled(false);
+	Character->GetWorldTimerManager().ClearAllTimersForObject(Character);
 	Character->GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	Character->GetMesh()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 	Character->GetMesh()->SetSimulatePhysics(true);
-	Character->RightHandEquipment->Destroy();
-	Character->LeftHandEquipment->Destroy();
-	Character->SetLifeSpan(5.0f);
+
+	// Respawn the player once the dead character has been let go.
+	ACeremonyGameModeBase* GameMode = GetWorld()->GetAuthGameMode<ACeremonyGameModeBase>();
+	if(IsValid(GameMode))
+	{
+		GameMode->QueueRespawn(Character->GetController(), Character->DeadBodyTime);
+	}
+	
+	// Keep the character and its equipment for the controller's next respawn, rather than destroying them.
+	UCeremonyCharacterPool* CharacterPool = UCeremonyCharacterPool::Get(this);
+	if(!IsValid(CharacterPool) || !CharacterPool->ReleaseCharacter(Character, Character->DeadBodyTime))
+	{
+		Character->SetLoadout(FCeremonyLoadout());
+		Character->SetLifeSpan(Character->DeadBodyTime);
+	}
 	
 	// Kill on all clients.
 	Multicast_KillCharacter(Character);
 }
 
-void ACeremonyCharacter::Server_PlayCosmeticAnimMontage_Implementation(UAnimMontage* MontageToPlay, const float Position)
+const FAttackDefinition* ACeremonyCharacter::Server_HelperGetAttackDefinition(const EEquipmentHand Hand, const uint8 AttackId, const ESpecialAttackType SpecialAttackType) const
+{
+	const AEquipmentActor* Weapon = GetEquipment(Hand);
+	if(!IsValid(Weapon))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Character %s tried to attack with an empty hand."), *GetNameSafe(this));
+		return nullptr;
+	}
+
+	const FAttackDefinition* Attack = Weapon->GetAttackDefinition(AttackId);
+	if(Attack == nullptr || Attack->SpecialAttackType != SpecialAttackType)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Character %s sent invalid attack %d for equipment %s."), *GetNameSafe(this), AttackId, *GetNameSafe(Weapon));
+		return nullptr;
+	}
+
+	return Attack;
+}
+
+bool ACeremonyCharacter::Server_HelperIsHitInCombatData(const FVector& ImpactPoint, const EEquipmentHand Hand, const float ClientServerTime) const
 {
-	CosmeticAnimMontage.Set(MontageToPlay, Position);
+	// A kick is sent without a hand; any other hit has to come from equipment in the hand.
+	const bool bIsKick = Hand == EEquipmentHand::None;
+	const AEquipmentActor* Weapon = GetEquipment(Hand);
+	if(!bIsKick && !IsValid(Weapon))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Character %s sent a hit from an empty hand."), *GetNameSafe(this));
+		return false;
+	}
+
+	const UCeremonyCombatData* CombatData = ServerCombatData.Get();
+	if(!IsValid(CombatData))
+	{
+		return true;
+	}
+
+	// A hit has to come from a montage; the one the client last told the server about is the one it was playing.
+	UCeremonyMontageRegistry* MontageRegistry = UCeremonyMontageRegistry::Get(this);
+	const UAnimMontage* Montage = IsValid(MontageRegistry) ? MontageRegistry->GetMontage(CosmeticAnimMontage.MontageId, this) : nullptr;
+	if(Montage == nullptr)
+	{
+		return false;
+	}
+
+	const float Position = CosmeticAnimMontage.GetPosition() + (ClientServerTime - CosmeticAnimMontage.ServerStartTime) * Montage->RateScale;
+
+	// Place the socket path where this character was when the client hit.
+	const FCapsuleSnapshot Snapshot = LagCompensationComponent->GetSnapshotAtTime(ClientServerTime);
+	const FTransform ActorTransform(Snapshot.Rotation, Snapshot.Location);
+
+	const ECeremonyAnimNotifyStateType NotifyStateType = bIsKick ? ECeremonyAnimNotifyStateType::Kick : ECeremonyAnimNotifyStateType::Attack;
+	const float Reach = bIsKick ? GetKickReach() : Weapon->GetReach();
+	
+	return CombatData->IsHitValid(Montage, Position, NotifyStateType, ActorTransform, ImpactPoint, Reach, ServerCombatDataTimeTolerance, ServerCombatDataReachTolerance);
+}
+
+void ACeremonyCharacter::Server_HelperRecordHit(ACeremonyCharacter* CharacterHit, const float Damage, const EHitReaction Reaction, const float ReactionValue, const EHitSound Sound)
+{
+	FHitRecord Record;
+	Record.Instigator = this;
+	Record.QuantizedDamage = FHitRecord::QuantizeDamage(Damage);
+	Record.Reaction = Reaction;
+	Record.ReactionValue = ReactionValue;
+	Record.Sound = Sound;
+	Record.ServerTime = UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this);
+
+	CharacterHit->HitLog.AddRecord(Record, HitRecordLifetime);
+	MARK_CHARACTER_PROPERTY_DIRTY(CharacterHit, HitLog);
+
+	// The server doesn't receive its own replication; a listen server or standalone game handles the record directly.
+	if(GetNetMode() != NM_DedicatedServer)
+	{
+		CharacterHit->OnHitRecordReceived(Record);
+	}
+}
+
+void ACeremonyCharacter::Server_LaunchProjectile_Implementation(const EEquipmentHand Hand, const FVector_NetQuantize Location, const FRotator Rotation)
+{
+	// Only a living character holding a ranged weapon fires; anything else is dropped rather than passed on to the other clients.
+	ARangedWeaponActor* RangedWeapon = Cast<ARangedWeaponActor>(GetEquipment(Hand));
+	if(!IsValid(RangedWeapon) || Health <= 0.0f)
+	{
+		return;
+	}
+
+	FVector VerifiedLocation = Location;
+	if(!RangedWeapon->VerifyLaunch(VerifiedLocation))
+	{
+		return;
+	}
+
+	Multicast_LaunchProjectile(Hand, VerifiedLocation, Rotation);
+}
+
+void ACeremonyCharacter::Server_PlayCosmeticAnimMontage_Implementation(const FCosmeticAnimMontage& NewCosmeticAnimMontage)
+{
+	// The montage may belong to equipment the server hasn't streamed in yet; drop it rather than replicate an ID nobody can play.
+	UCeremonyMontageRegistry* MontageRegistry = UCeremonyMontageRegistry::Get(this);
+	if(!IsValid(MontageRegistry) || !MontageRegistry->IsValidMontageId(NewCosmeticAnimMontage.MontageId, this))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ACeremonyCharacter::Server_PlayCosmeticAnimMontage: Unknown montage ID %d from %s dropped."), NewCosmeticAnimMontage.MontageId, *GetNameSafe(this));
+		return;
+	}
+
+	CosmeticAnimMontage = NewCosmeticAnimMontage;
+
+	// A client can't claim a montage started in the future.
+	CosmeticAnimMontage.ServerStartTime = FMath::Min(NewCosmeticAnimMontage.ServerStartTime, UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this));
+	MARK_CHARACTER_PROPERTY_DIRTY(this, CosmeticAnimMontage);
 
 	// On the listen server, force it to act like it replicated the client's animations, even though it didn't because it's the server.
 	if(GetNetMode() == NM_ListenServer)
@@ -1437,39 +2425,60 @@ void ACeremonyCharacter::Server_PlayCosmeticAnimMontage_Implementation(UAnimMont
 	}
 }
 
-void ACeremonyCharacter::Server_VerifyBackStab_Implementation(ACeremonyCharacter* CharacterHit, const float Damage)
+void ACeremonyCharacter::Server_SetLockOnYaw_Implementation(const uint16 CompressedYaw)
+{
+	// Keep the yaw until lock on arrives with the combat state, which is only sent at the end of the frame.
+	ReceivedLockOnYaw = CompressedYaw;
+	bHasReceivedLockOnYaw = true;
+	
+	if(!bIsLockedOn)
+	{
+		return;
+	}
+
+	UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(GetCharacterMovement());
+	if(IsValid(CeremonyMovement))
+	{
+		CeremonyMovement->SetLockOnYaw(FRotator::DecompressAxisFromShort(CompressedYaw));
+	}
+}
+
+void ACeremonyCharacter::Server_VerifyBackStab_Implementation(ACeremonyCharacter* CharacterHit, const EEquipmentHand Hand, const uint8 AttackId)
 {
-	if(!IsValid(CharacterHit) || CharacterHit->GetIsInvincible())
+	// Corpses stay hittable as ragdolls; a hit on one must not run the death path again.
+	if(!IsValid(CharacterHit) || CharacterHit->GetIsInvincible() || CharacterHit->Health <= 0.0f)
+	{
+		return;
+	}
+
+	const FAttackDefinition* Attack = Server_HelperGetAttackDefinition(Hand, AttackId, ESpecialAttackType::BackStab);
+	if(Attack == nullptr)
 	{
 		return;
 	}
 
+	const float Damage = Attack->GetDamage(0.0f);
+
 	const float DotProduct = FVector::DotProduct(GetActorForwardVector(), CharacterHit->GetActorForwardVector());
 	const float Distance = FVector::Distance(GetActorLocation(), CharacterHit->GetActorLocation());
 
-	if(Distance < ServerBackStabMaxDistance && DotProduct > ServerBackStabMinDotProduct)
+	if(Distance < ServerBackStabMaxDistance && DotProduct > ServerBackStabMinDotProduct && HasLineOfSightTo(CharacterHit))
 	{
-		CharacterHit->Multicast_SetOpponentWidgetDamage(Damage);
-		CharacterHit->Health = FMath::Clamp(CharacterHit->Health - Damage, 0.0f, CharacterHit->HealthMaximum);
-		
-		if(CharacterHit->GetNetMode() == NM_ListenServer)
-		{
-			// Listen server will need to force an update, because it will not call OnRep locally when things change.
-			CharacterHit->OnRep_Health();
-		}
+		CharacterHit->SetHealth(CharacterHit->Health - Damage);
 
 		if(CharacterHit->Health == 0.0f)
 		{
+			Server_HelperRecordHit(CharacterHit, Damage, EHitReaction::None, 0.0f, EHitSound::None);
 			Server_HelperKillCharacter(CharacterHit);
 		}
 		else
 		{
-			CharacterHit->Client_BackStabbed();
+			Server_HelperRecordHit(CharacterHit, Damage, EHitReaction::BackStabbed, 0.0f, EHitSound::None);
 		}
 	}
 }
 
-void ACeremonyCharacter::Server_VerifyOverlapForDamage_Implementation(ACeremonyCharacter* CharacterHit, const FVector_NetQuantize ImpactPoint, const FVector_NetQuantize DamageEnduranceDamageStunTime, const uint8 IntDamageType)
+void ACeremonyCharacter::Server_VerifyOverlapForDamage_Implementation(ACeremonyCharacter* CharacterHit, const FVector_NetQuantize ImpactPoint, const EEquipmentHand Hand, const uint8 AttackId, const uint8 QuantizedCharge, const float ClientServerTime)
 {
 	const UWorld* World = GetWorld();
 	if(!IsValid(World))
@@ -1478,185 +2487,213 @@ void ACeremonyCharacter::Server_VerifyOverlapForDamage_Implementation(ACeremonyC
 		return;
 	}
 
-	TArray<FOverlapResult> OutOverlaps;
+	// Corpses stay hittable as ragdolls; a hit on one must not run the death path again.
+	if(!IsValid(CharacterHit) || CharacterHit == this || CharacterHit->Health <= 0.0f)
+	{
+		return;
+	}
 
-	FCollisionObjectQueryParams ObjectQueryParams;
-	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
-	
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(this);
+	// Resolve the attack on the server; a kick has no hand.
+	float Damage = 0.0f;
+	float EnduranceDamage = KickEnduranceDamage;
+	float StunTime = KickStunTime;
+	EDamageTypes DamageType = EDamageTypes::Kick;
 
+	if(Hand != EEquipmentHand::None)
+	{
+		const FAttackDefinition* Attack = Server_HelperGetAttackDefinition(Hand, AttackId, ESpecialAttackType::None);
+		if(Attack == nullptr)
+		{
+			return;
+		}
+
+		const float ChargeFraction = FAttackDefinition::DequantizeCharge(QuantizedCharge);
+		Damage = Attack->GetDamage(ChargeFraction);
+		EnduranceDamage = Attack->GetEnduranceDamage(ChargeFraction);
+		StunTime = Attack->DamageParams.StunTime;
+		DamageType = Attack->DamageParams.DamageType;
+	}
+	
+	// Rewind the character hit to where the attacking client saw it, and test the impact against that capsule.
+	FCapsuleSnapshot Snapshot;
+	const bool bVerified = CharacterHit->LagCompensationComponent->DidSphereOverlapAtTime(ImpactPoint, ServerVerifyOverlapsSphereRadius, ClientServerTime, Snapshot);
+	
 	if(IsShowingDebugCollision())
 	{
 		DrawDebugSphere(World, ImpactPoint, ServerVerifyOverlapsSphereRadius, 8, FColor::Blue, false, 3.0f, 0, 0);
+		DrawDebugCapsule(World, Snapshot.Location, Snapshot.HalfHeight, Snapshot.Radius, Snapshot.Rotation, bVerified ? FColor::Blue : FColor::Orange, false, 3.0f, 0, 0);
+	}
 
-		if(IsValid(CharacterHit))
-		{
-			DrawDebugCapsule(World, CharacterHit->GetActorLocation(),
-			                 CharacterHit->GetCapsuleComponent()->GetScaledCapsuleHalfHeight(),
-			                 CharacterHit->GetCapsuleComponent()->GetScaledCapsuleRadius(),
-			                 CharacterHit->GetActorRotation().Quaternion(), FColor::Blue, false, 3.0f, 0, 0);
-		}
+	if(!bVerified)
+	{
+		return;
 	}
 
-	if(IsValid(World) && World->OverlapMultiByObjectType(OutOverlaps, ImpactPoint, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeSphere(ServerVerifyOverlapsSphereRadius), Params))
+	// Check the hit was made while the attack could hit, and within reach of where the weapon or foot was.
+	if(!Server_HelperIsHitInCombatData(ImpactPoint, Hand, ClientServerTime))
 	{
-		for(FOverlapResult& Overlap : OutOverlaps)
+		INC_DWORD_STAT(STAT_HitsRejectedByCombatData);
+
+		if(IsShowingDebugCollision())
 		{
-			if(Overlap.GetActor() == CharacterHit)
-			{
-				const float Damage = DamageEnduranceDamageStunTime.X;
-				const float EnduranceDamage = DamageEnduranceDamageStunTime.Y;
-				const float StunTime = DamageEnduranceDamageStunTime.Z;
-				const EDamageTypes DamageType = static_cast<EDamageTypes>(IntDamageType);
-				
-				// Check if the character is in invincibility frames, prevent damage.
-				if(CharacterHit->GetIsInvincible())
-				{
-					return;
-				}
+			UE_LOG(LogTemp, Warning, TEXT("ACeremonyCharacter::Server_VerifyOverlapForDamage: Hit by %s on %s is outside the baked combat data."), *GetNameSafe(this), *GetNameSafe(CharacterHit));
+		}
+		return;
+	}
 
-				if(CharacterHit->GetParryCanStagger())
-				{
-					if(DamageType == EDamageTypes::Kick)
-					{
-						// If the character is parrying and receives a kick, they just take endurance damage with no absorption.
-						CharacterHit->Client_DepleteEnduranceCanStagger(EnduranceDamage);						
-						Multicast_PlaySound(KickInterruptSound);
-						return;
-					}
+	// Use the combat state the character hit had at the same rewound time as the capsule.
+	const ECombatStateFlags HitCombatState = CharacterHit->CombatStateComponent->GetFlagsAtTime(Snapshot.ServerTime);
+	
+	// Check if the character is in invincibility frames, prevent damage.
+	if(EnumHasAnyFlags(HitCombatState, ECombatStateFlags::Invincible))
+	{
+		return;
+	}
 
-					// Set the character that is attacking to staggered, the target is parrying.
+	if(EnumHasAnyFlags(HitCombatState, ECombatStateFlags::ParryCanStagger))
+	{
+		if(DamageType == EDamageTypes::Kick)
+		{
+			// If the character is parrying and receives a kick, they just take endurance damage with no absorption.
+			Server_HelperRecordHit(CharacterHit, 0.0f, EHitReaction::DepleteEnduranceCanStagger, EnduranceDamage, EHitSound::KickInterrupt);
+			return;
+		}
 
-					// On the server, set stagger on the attacking client (to replicate to all clients).
-					bIsStaggered = true;
+		// Set the character that is attacking to staggered, the target is parrying.
 
-					// Trigger stagger on the attacking client
-					Client_Staggered();
+		// On the server, set stagger on the attacking client (to replicate to all clients). Recording it makes any older state from the client stale.
+		bIsStaggered = true;
+		MARK_CHARACTER_PROPERTY_DIRTY(this, bIsStaggered);
+		CombatStateComponent->OnCombatStateChanged();
 
-					// Play parry sound on all clients.
-					Multicast_PlaySound(ParrySound);
+		// Trigger stagger on the attacking client, and play the parry sound on all clients.
+		CharacterHit->Server_HelperRecordHit(this, 0.0f, EHitReaction::Staggered, 0.0f, EHitSound::Parry);
 
-					return;
-				}
-
-				if(CharacterHit->GetIsBlocking())
-				{
-					// Check if the character is blocking
-					AShieldActor* ShieldActor;
-					if(CharacterHit->GetIsBlocking() && CharacterHit->GetIsShieldLeftHanded())
-					{
-						ShieldActor = Cast<AShieldActor>(LeftHandEquipment);
-					}
-					else
-					{
-						ShieldActor = Cast<AShieldActor>(RightHandEquipment);
-					}
-										
-					if(IsValid(ShieldActor))
-					{
-						float OutDamage;
-						float OutEnduranceDamage;
-						ShieldActor->GetDamageAfterAbsorption(Damage, DamageType, EnduranceDamage, OutDamage, OutEnduranceDamage);
-
-						if(DamageType == EDamageTypes::Kick)
-						{
-							Multicast_PlaySound(KickBlockedSound);
-						}
-						else
-						{
-							Multicast_PlaySound(BlockAttackSound);
-						}
-
-						CharacterHit->Multicast_SetOpponentWidgetDamage(OutDamage);
-						CharacterHit->Health = FMath::Clamp(CharacterHit->Health - OutDamage, 0.0f, CharacterHit->HealthMaximum);
-						
-						if(GetNetMode() == NM_ListenServer)
-						{
-							// Listen server will need to force an update, because it will not call OnRep locally.
-							CharacterHit->OnRep_Health();
-						}
-						
-						CharacterHit->Client_DepleteEnduranceCanStagger(OutEnduranceDamage);
-					}
-				}
-				else if(DamageType == EDamageTypes::Kick)
-				{
-					// Interrupt the character that it connected with.
-					CharacterHit->Client_Stunned(KickStunTime);
-
-					Multicast_PlaySound(KickInterruptSound);
-				}
-				else
-				{
-					Multicast_PlaySound(AttackHitSound);
-
-					CharacterHit->Multicast_SetOpponentWidgetDamage(Damage);
-					CharacterHit->Health = FMath::Clamp(CharacterHit->Health - Damage, 0.0f, CharacterHit->HealthMaximum);
-
-					if(GetNetMode() == NM_ListenServer)
-					{
-						// Listen server will need to force an update, because it will not call OnRepHealth when health changes, so the bar won't update.
-						CharacterHit->OnRep_Health();
-					}
-					
-					if(CharacterHit->Health > 0.0f)
-					{
-						CharacterHit->Client_Stunned(StunTime);	
-					}
-				}
+		return;
+	}
 
-				if(CharacterHit->Health == 0.0f)
-				{
-					Server_HelperKillCharacter(CharacterHit);
-				}
-				break;
-			}
+	if(EnumHasAnyFlags(HitCombatState, ECombatStateFlags::Blocking))
+	{
+		// The character hit is blocking; absorb with their shield.
+		AShieldActor* ShieldActor;
+		if(EnumHasAnyFlags(HitCombatState, ECombatStateFlags::ShieldLeftHanded))
+		{
+			ShieldActor = Cast<AShieldActor>(CharacterHit->LeftHandEquipment);
+		}
+		else
+		{
+			ShieldActor = Cast<AShieldActor>(CharacterHit->RightHandEquipment);
+		}
+							
+		if(IsValid(ShieldActor))
+		{
+			float OutDamage;
+			float OutEnduranceDamage;
+			ShieldActor->GetDamageAfterAbsorption(Damage, DamageType, EnduranceDamage, OutDamage, OutEnduranceDamage);
+
+			CharacterHit->SetHealth(CharacterHit->Health - OutDamage);
+			
+			Server_HelperRecordHit(CharacterHit, OutDamage, EHitReaction::DepleteEnduranceCanStagger, OutEnduranceDamage,
+				DamageType == EDamageTypes::Kick ? EHitSound::KickBlocked : EHitSound::BlockAttack);
 		}
 	}
-}
-
-bool ACeremonyCharacter::Server_VerifyOverlapForDamage_Validate(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, const FVector_NetQuantize DamageEnduranceDamageStunTime, uint8 DamageType)
-{
-	const float DamageStandard = DamageEnduranceDamageStunTime.X;
-	const float EnduranceDamage = DamageEnduranceDamageStunTime.Y;
-
-	if(DamageStandard < 0.0f || EnduranceDamage < 0.0f)
+	else if(DamageType == EDamageTypes::Kick)
 	{
-		return false;
+		// Interrupt the character that it connected with.
+		Server_HelperRecordHit(CharacterHit, 0.0f, EHitReaction::Stunned, KickStunTime, EHitSound::KickInterrupt);
+	}
+	else
+	{
+		CharacterHit->SetHealth(CharacterHit->Health - Damage);
+		
+		Server_HelperRecordHit(CharacterHit, Damage, CharacterHit->Health > 0.0f ? EHitReaction::Stunned : EHitReaction::None, StunTime, EHitSound::AttackHit);
 	}
 
-	return true;
+	if(CharacterHit->Health == 0.0f)
+	{
+		Server_HelperKillCharacter(CharacterHit);
+	}
 }
 
-void ACeremonyCharacter::Server_VerifyRiposte_Implementation(ACeremonyCharacter* CharacterHit, const float Damage)
+void ACeremonyCharacter::Server_VerifyRiposte_Implementation(ACeremonyCharacter* CharacterHit, const EEquipmentHand Hand, const uint8 AttackId)
 {
-	if(!IsValid(CharacterHit) || CharacterHit->GetIsInvincible())
+	// Corpses stay hittable as ragdolls; a hit on one must not run the death path again.
+	if(!IsValid(CharacterHit) || CharacterHit->GetIsInvincible() || CharacterHit->Health <= 0.0f)
+	{
+		return;
+	}
+
+	const FAttackDefinition* Attack = Server_HelperGetAttackDefinition(Hand, AttackId, ESpecialAttackType::Riposte);
+	if(Attack == nullptr)
 	{
 		return;
 	}
 
+	const float Damage = Attack->GetDamage(0.0f);
+
 	const float DotProduct = FVector::DotProduct(GetActorForwardVector(), CharacterHit->GetActorForwardVector());
 	const float Distance = FVector::Distance(GetActorLocation(), CharacterHit->GetActorLocation());
 
-	if(Distance < ServerRiposteMaxDistance && DotProduct < ServerRiposteMaxDotProduct)
+	if(Distance < ServerRiposteMaxDistance && DotProduct < ServerRiposteMaxDotProduct && HasLineOfSightTo(CharacterHit))
 	{
-		CharacterHit->Multicast_SetOpponentWidgetDamage(Damage);
-		CharacterHit->Health = FMath::Clamp(CharacterHit->Health - Damage, 0.0f, CharacterHit->HealthMaximum);
-
-		if(CharacterHit->GetNetMode() == NM_ListenServer)
-		{
-			// Listen server will need to force an update, because it will not call OnRepHealth when health changes, so the bar won't update.
-			CharacterHit->OnRep_Health();
-		}
+		CharacterHit->SetHealth(CharacterHit->Health - Damage);
 
 		if(CharacterHit->Health == 0.0f)
 		{
+			Server_HelperRecordHit(CharacterHit, Damage, EHitReaction::None, 0.0f, EHitSound::None);
 			Server_HelperKillCharacter(CharacterHit);
 		}
 		else
 		{
-			CharacterHit->Client_Riposted();
+			Server_HelperRecordHit(CharacterHit, Damage, EHitReaction::Riposted, 0.0f, EHitSound::None);
+		}
+	}
+}
+
+#pragma endregion
+
+#pragma region Significance
+
+void ACeremonyCharacter::ApplyAnimUpdateRate(FAnimUpdateRateParameters* Parameters) const
+{
+	if(Parameters == nullptr)
+	{
+		return;
+	}
+
+	// Use the same frame skip at every LOD, so the significance decides the rate rather than the screen size.
+	const int32 FrameSkip = UCeremonySignificanceSubsystem::GetAnimationFrameSkip(Significance);
+	Parameters->bShouldUseLodMap = true;
+	Parameters->LODToFrameSkipMap.Reset();
+	for(int32 LODIndex = 0; LODIndex < MAX_SKELETAL_MESH_LODS; LODIndex++)
+	{
+		Parameters->LODToFrameSkipMap.Add(LODIndex, FrameSkip);
+	}
+}
+
+void ACeremonyCharacter::SetSignificance(const ECeremonySignificance NewSignificance)
+{
+	if(Significance == NewSignificance)
+	{
+		return;
+	}
+	
+	Significance = NewSignificance;
+
+	// IK stops tracing at low significance, and traces less often at medium; the feet still interpolate towards the last trace every frame.
+	InverseKinematicsComponent->SetTraceInterval(UCeremonySignificanceSubsystem::GetInverseKinematicsTraceInterval(Significance));
+
+	if(GetMesh()->bEnableUpdateRateOptimizations)
+	{
+		ApplyAnimUpdateRate(GetMesh()->AnimUpdateRateParams);
+	}
+
+	// Widgets of low significance characters are too far away or off screen to be read.
+	for(UWidgetComponent* Widget : {OpponentWidget, LockOnWidget})
+	{
+		if(IsValid(Widget))
+		{
+			Widget->SetComponentTickEnabled(Significance != ECeremonySignificance::Low);
 		}
 	}
 }
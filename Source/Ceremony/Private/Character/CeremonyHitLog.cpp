@@ -0,0 +1,31 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Character/CeremonyHitLog.h"
+
+#include "Character/CeremonyCharacter.h"
+
+void FHitRecord::PostReplicatedAdd(const FHitLog& InArraySerializer)
+{
+	if(IsValid(InArraySerializer.OwnerCharacter))
+	{
+		InArraySerializer.OwnerCharacter->OnHitRecordReceived(*this);
+	}
+}
+
+void FHitLog::AddRecord(const FHitRecord& Record, const float Lifetime)
+{
+	// Records are added in time order, so the expired ones are at the front.
+	int32 ExpiredCount = 0;
+	while(ExpiredCount < Records.Num() && Records[ExpiredCount].ServerTime < Record.ServerTime - Lifetime)
+	{
+		ExpiredCount++;
+	}
+
+	if(ExpiredCount > 0)
+	{
+		Records.RemoveAt(0, ExpiredCount);
+		MarkArrayDirty();
+	}
+
+	MarkItemDirty(Records.Add_GetRef(Record));
+}
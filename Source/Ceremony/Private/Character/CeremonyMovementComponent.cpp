@@ -1,8 +1,87 @@
 // Copyright 2020 Stephen Maloney
 
 #include "Character/CeremonyMovementComponent.h"
+
+#include "Core/Ceremony.h"
 #include "Character/CeremonyCharacter.h"
 
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Client Movement Corrections"), STAT_CeremonyMovementCorrections, STATGROUP_Ceremony);
+
+#pragma region SavedMove
+
+bool FSavedMove_Ceremony::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, const float MaxDelta) const
+{
+	const FSavedMove_Ceremony* NewCeremonyMove = static_cast<const FSavedMove_Ceremony*>(NewMove.Get());
+	
+	if(bSavedWantsToRun != NewCeremonyMove->bSavedWantsToRun || bSavedWantsForcedMovement != NewCeremonyMove->bSavedWantsForcedMovement)
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_Ceremony::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToRun = false;
+	bSavedWantsForcedMovement = false;
+}
+
+uint8 FSavedMove_Ceremony::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+
+	if(bSavedWantsToRun)
+	{
+		Result |= FLAG_Custom_0;
+	}
+
+	if(bSavedWantsForcedMovement)
+	{
+		Result |= FLAG_Custom_1;
+	}
+
+	return Result;
+}
+
+void FSavedMove_Ceremony::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(C->GetCharacterMovement());
+	if(IsValid(CeremonyMovement))
+	{
+		CeremonyMovement->bWantsToRun = bSavedWantsToRun;
+		CeremonyMovement->bWantsForcedMovement = bSavedWantsForcedMovement;
+	}
+}
+
+void FSavedMove_Ceremony::SetMoveFor(ACharacter* C, const float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const UCeremonyMovementComponent* CeremonyMovement = Cast<UCeremonyMovementComponent>(C->GetCharacterMovement());
+	if(IsValid(CeremonyMovement))
+	{
+		bSavedWantsToRun = CeremonyMovement->bWantsToRun;
+		bSavedWantsForcedMovement = CeremonyMovement->bWantsForcedMovement;
+	}
+}
+
+FNetworkPredictionData_Client_Ceremony::FNetworkPredictionData_Client_Ceremony(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Ceremony::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Ceremony());
+}
+
+#pragma endregion
+
 void UCeremonyMovementComponent::BeginPlay()
 {
 	Super::BeginPlay();
@@ -16,7 +95,7 @@ float UCeremonyMovementComponent::GetMaxSpeed() const
 
 	if(IsValid(OwnerCharacter))
 	{
-		if(OwnerCharacter->GetIsRunning())
+		if(bWantsToRun && !bWantsForcedMovement)
 		{
 			MaxSpeed = OwnerCharacter->GetRunSpeed();
 		}
@@ -28,3 +107,84 @@ float UCeremonyMovementComponent::GetMaxSpeed() const
 
 	return MaxSpeed;
 }
+
+#pragma region LockOn
+
+void UCeremonyMovementComponent::ClearLockOnYaw()
+{
+	bHasLockOnYaw = false;
+}
+
+void UCeremonyMovementComponent::PhysicsRotation(const float DeltaTime)
+{
+	if(!bHasLockOnYaw || bOrientRotationToMovement || !HasValidData() || (!CharacterOwner->Controller && !bRunPhysicsWithNoController))
+	{
+		Super::PhysicsRotation(DeltaTime);
+		return;
+	}
+
+	const FRotator CurrentRotation = UpdatedComponent->GetComponentRotation();
+	const float NewYaw = FMath::FixedTurn(CurrentRotation.Yaw, LockOnYaw, GetDeltaRotation(DeltaTime).Yaw);
+
+	if(FMath::IsNearlyZero(FRotator::NormalizeAxis(NewYaw - CurrentRotation.Yaw)))
+	{
+		return;
+	}
+
+	MoveUpdatedComponent(FVector::ZeroVector, FRotator(CurrentRotation.Pitch, NewYaw, CurrentRotation.Roll), false);
+}
+
+void UCeremonyMovementComponent::SetLockOnYaw(const float Yaw)
+{
+	bHasLockOnYaw = true;
+	LockOnYaw = FRotator::NormalizeAxis(Yaw);
+}
+
+#pragma endregion
+
+#pragma region Prediction
+
+FNetworkPredictionData_Client* UCeremonyMovementComponent::GetPredictionData_Client() const
+{
+	if(ClientPredictionData == nullptr)
+	{
+		UCeremonyMovementComponent* MutableThis = const_cast<UCeremonyMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Ceremony(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UCeremonyMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, const float TimeStamp, const FVector NewLocation, const FVector NewVelocity,
+	UPrimitiveComponent* NewBase, const FName NewBaseBoneName, const bool bHasBase, const bool bBaseRelativePosition, const uint8 ServerMovementMode)
+{
+	INC_DWORD_STAT(STAT_CeremonyMovementCorrections);
+	
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+}
+
+void UCeremonyMovementComponent::SetWantsForcedMovement(const bool bForcedMovement)
+{
+	bWantsForcedMovement = bForcedMovement;
+}
+
+void UCeremonyMovementComponent::SetWantsToRun(const bool bRun)
+{
+	bWantsToRun = bRun;
+}
+
+void UCeremonyMovementComponent::UpdateFromCompressedFlags(const uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToRun = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+	bWantsForcedMovement = (Flags & FSavedMove_Character::FLAG_Custom_1) != 0;
+
+	// The server is the source of the replicated run state that other clients animate with.
+	if(IsValid(OwnerCharacter) && OwnerCharacter->GetLocalRole() == ROLE_Authority)
+	{
+		OwnerCharacter->SetIsRunning(bWantsToRun);
+	}
+}
+
+#pragma endregion
@@ -40,13 +40,21 @@ void UCeremonyUserWidget::NativeTick(const FGeometry& MyGeometry, const float In
 {
 	Super::NativeTick(MyGeometry, InDeltaTime);
 
+	if(IsEnduranceChanging())
+	{
+		const float ElapsedTime = GetWorld()->GetTimeSeconds() - EnduranceChangeTime;
+		EnduranceTargetValue = FMath::Min(EnduranceChangeValue + EnduranceRate * ElapsedTime, EnduranceMaximumValue);
+		EnduranceDynamicMaterial->SetScalarParameterValue("TargetValue", EnduranceTargetValue);
+	}
+	
 	EnduranceCurrentValue = InterpolateBar(EnduranceCurrentValue, EnduranceTargetValue, InDeltaTime, InterpolationSpeed);
 	EnduranceDynamicMaterial->SetScalarParameterValue("CurrentValue", EnduranceCurrentValue);
 	
 	HealthCurrentValue = InterpolateBar(HealthCurrentValue, HealthTargetValue, InDeltaTime, InterpolationSpeed);
 	HealthDynamicMaterial->SetScalarParameterValue("CurrentValue", HealthCurrentValue);
 	
-	if(FMath::IsNearlyEqual(HealthCurrentValue, HealthTargetValue) && FMath::IsNearlyEqual(EnduranceCurrentValue, EnduranceTargetValue))
+	if(FMath::IsNearlyEqual(HealthCurrentValue, HealthTargetValue) && FMath::IsNearlyEqual(EnduranceCurrentValue, EnduranceTargetValue) &&
+		!IsEnduranceChanging())
 	{
 		TSharedPtr<SObjectWidget> SafeGCWidget = MyGCWidget.Pin();
 		if(SafeGCWidget.IsValid())
@@ -56,14 +64,23 @@ void UCeremonyUserWidget::NativeTick(const FGeometry& MyGeometry, const float In
 	}
 }
 
-void UCeremonyUserWidget::OnEnduranceChanged(const float Current, const float Max)
+bool UCeremonyUserWidget::IsEnduranceChanging() const
+{
+	return EnduranceRate < 0.0f || (EnduranceRate > 0.0f && EnduranceTargetValue < EnduranceMaximumValue);
+}
+
+void UCeremonyUserWidget::OnEnduranceChanged(const float Current, const float Max, const float RatePerSecond)
 {
+	EnduranceChangeTime = GetWorld()->GetTimeSeconds();
+	EnduranceChangeValue = Current;
+	EnduranceMaximumValue = Max;
+	EnduranceRate = RatePerSecond;
 	EnduranceTargetValue = Current;
 
 	EnduranceDynamicMaterial->SetScalarParameterValue("MaximumValue", Max);
 	EnduranceDynamicMaterial->SetScalarParameterValue("TargetValue", Current);
 
-	if(!FMath::IsNearlyEqual(EnduranceCurrentValue, EnduranceTargetValue))
+	if(!FMath::IsNearlyEqual(EnduranceCurrentValue, EnduranceTargetValue) || IsEnduranceChanging())
 	{
 		TSharedPtr<SObjectWidget> SafeGCWidget = MyGCWidget.Pin();
 		if(SafeGCWidget.IsValid())
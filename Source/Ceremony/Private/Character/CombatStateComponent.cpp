@@ -0,0 +1,190 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Character/CombatStateComponent.h"
+
+#include "Core/Ceremony.h"
+#include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyFunctionLibrary.h"
+#include "Engine/World.h"
+#include "Character/LagCompensationComponent.h"
+#include "GameFramework/PlayerState.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat State Commands Applied"), STAT_CombatStateCommandsApplied, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat State Commands Stale"), STAT_CombatStateCommandsStale, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat State Sends"), STAT_CombatStateSends, STATGROUP_Ceremony);
+
+// The least time between the stamps of two commands from the owning client; coarse enough to survive float precision late in a match.
+static constexpr float MinCommandInterval = 0.01f;
+
+UCombatStateComponent::UCombatStateComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Send after animation notifies have fired for the frame, so changes made together go out together.
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	// Required for the server RPC.
+	SetIsReplicatedByDefault(true);
+}
+
+void UCombatStateComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	OwnerCharacter = Cast<ACeremonyCharacter>(GetOwner());
+	check(IsValid(OwnerCharacter));
+
+	// History is only needed where hits are verified.
+	if(OwnerCharacter->HasAuthority())
+	{
+		History.SetNum(HistorySize);
+		HistoryHead = 0;
+		HistoryCount = 0;
+	}
+}
+
+ECombatStateFlags UCombatStateComponent::GetFlagsAtTime(const float ServerTime) const
+{
+	// With no history (no change yet, or not the server) the present is all there is.
+	if(HistoryCount == 0)
+	{
+		return OwnerCharacter->GetCombatStateFlags();
+	}
+
+	// Walk back from the newest entry to find the state in effect at that time.
+	for(int32 Age = 0; Age < HistoryCount; Age++)
+	{
+		const FCombatStateCommand& Entry = GetHistoryEntry(Age);
+		if(Entry.ServerTime <= ServerTime)
+		{
+			return Entry.GetFlags();
+		}
+	}
+
+	// Older than the buffer covers; use the oldest.
+	return GetHistoryEntry(HistoryCount - 1).GetFlags();
+}
+
+void UCombatStateComponent::OnCombatStateChanged()
+{
+	FCombatStateCommand Command;
+	Command.Flags = static_cast<uint8>(OwnerCharacter->GetCombatStateFlags());
+	Command.ServerTime = UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this);
+
+	if(OwnerCharacter->HasAuthority())
+	{
+		// The server changed state itself; any command from the client stamped before now is stale.
+		Command.ServerTime = FMath::Max(Command.ServerTime, LastAppliedTime);
+		LastReceivedTime = FMath::Max(LastReceivedTime, Command.ServerTime);
+		RecordState(Command);
+		return;
+	}
+
+	if(!OwnerCharacter->IsLocallyControlled())
+	{
+		return;
+	}
+
+	if(PendingCommands.Num() > 0 && LastCommandFrame == GFrameCounter)
+	{
+		// Another change in the same frame; only the final state matters.
+		PendingCommands.Last().Flags = Command.Flags;
+	}
+	else
+	{
+		// The estimate of server time can step back when the clock is resynced; the server drops any stamp at or before the last it applied.
+		if(PendingCommands.Num() > 0)
+		{
+			Command.ServerTime = FMath::Max(Command.ServerTime, LastCommandTime + MinCommandInterval);
+		}
+
+		LastCommandFrame = GFrameCounter;
+		LastCommandTime = Command.ServerTime;
+
+		if(PendingCommands.Num() >= CommandRedundancy)
+		{
+			PendingCommands.RemoveAt(0, PendingCommands.Num() - CommandRedundancy + 1, false);
+		}
+
+		PendingCommands.Add(Command);
+	}
+
+	bHasUnsentCommand = true;
+	LastChangeTime = GetWorld()->GetTimeSeconds();
+	SetComponentTickEnabled(true);
+}
+
+void UCombatStateComponent::RecordState(const FCombatStateCommand& Command)
+{
+	History[HistoryHead] = Command;
+	HistoryHead = (HistoryHead + 1) % HistorySize;
+	HistoryCount = FMath::Min(HistoryCount + 1, HistorySize);
+
+	LastAppliedTime = Command.ServerTime;
+}
+
+void UCombatStateComponent::SendPendingCommands()
+{
+	INC_DWORD_STAT(STAT_CombatStateSends);
+
+	Server_ReceiveCombatState(PendingCommands);
+
+	bHasUnsentCommand = false;
+	LastSendTime = GetWorld()->GetTimeSeconds();
+}
+
+void UCombatStateComponent::Server_ReceiveCombatState_Implementation(const TArray<FCombatStateCommand>& Commands)
+{
+	const float CurrentTime = UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this);
+
+	// A change took effect on the client at most a round trip ago, and never before the furthest a hit can be rewound.
+	const APlayerState* PlayerState = OwnerCharacter->GetPlayerState();
+	const float MaxRewindTime = OwnerCharacter->GetLagCompensationComponent()->GetMaxRewindTime();
+	const float RoundTripTime = IsValid(PlayerState) ? PlayerState->ExactPing * 0.001f : MaxRewindTime;
+	const float EarliestTime = CurrentTime - FMath::Min(RoundTripTime, MaxRewindTime);
+
+	for(const FCombatStateCommand& Command : Commands)
+	{
+		// Already applied through an earlier send, or older than a change the server made.
+		if(Command.ServerTime <= LastReceivedTime)
+		{
+			INC_DWORD_STAT(STAT_CombatStateCommandsStale);
+			continue;
+		}
+
+		LastReceivedTime = Command.ServerTime;
+
+		// A client can't claim a state change in the future, or backdate one past the window; states stay in order in the history.
+		FCombatStateCommand AppliedCommand = Command;
+		AppliedCommand.ServerTime = FMath::Clamp(Command.ServerTime, FMath::Max(EarliestTime, LastAppliedTime), CurrentTime);
+
+		OwnerCharacter->ApplyCombatStateFlags(AppliedCommand.GetFlags());
+		RecordState(AppliedCommand);
+
+		INC_DWORD_STAT(STAT_CombatStateCommandsApplied);
+	}
+}
+
+bool UCombatStateComponent::Server_ReceiveCombatState_Validate(const TArray<FCombatStateCommand>& Commands)
+{
+	return Commands.Num() <= CommandRedundancy;
+}
+
+void UCombatStateComponent::TickComponent(const float DeltaTime, const ELevelTick TickType,
+                                          FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+
+	if(bHasUnsentCommand || CurrentTime - LastSendTime >= ResendInterval)
+	{
+		SendPendingCommands();
+	}
+
+	if(CurrentTime - LastChangeTime >= ResendWindow)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
@@ -3,6 +3,7 @@
 #include "Character/FootstepComponent.h"
 
 #include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyTraceSubsystem.h"
 #include "DrawDebugHelpers.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Components/SkeletalMeshComponent.h"
@@ -31,46 +32,58 @@ void UFootstepComponent::BeginPlay()
 	CollisionQueryParams.bReturnPhysicalMaterial = true;
 }
 
-USoundBase* UFootstepComponent::GetFootstepSound(const FName FootBoneName) const
+USoundBase* UFootstepComponent::GetFootstepSound(UPhysicalMaterial* PhysicalMaterial)
 {
-	UWorld* World = GetWorld();
-	if(!IsValid(World))
+	USoundBase** CachedSound = FootstepSounds.Find(PhysicalMaterial);
+	if(CachedSound != nullptr)
 	{
-		return nullptr;
+		return *CachedSound;
 	}
 
-	FHitResult OutHit;
-	const FVector StartLocation = OwnerMesh->GetBoneLocation(FootBoneName);
-	const FVector EndLocation = StartLocation - FVector(0.0f, 0.0f, FootTraceLength);
+	const FFootStepSound* Row = FootstepDataTable->FindRow<FFootStepSound>(PhysicalMaterial->GetFName(), "", false);
+	USoundBase* Sound = Row != nullptr ? Row->FootstepSound : nullptr;
+	FootstepSounds.Add(PhysicalMaterial, Sound);
 
-	if(OwnerCharacter->IsShowingDebugCollision())
+	return Sound;
+}
+
+void UFootstepComponent::OnFootTraceComplete(const bool bHit, const FHitResult& Hit)
+{
+	UPhysicalMaterial* PhysicalMaterial = Hit.PhysMaterial.Get();
+	if(!bHit || !IsValid(PhysicalMaterial))
+	{
+		return;
+	}
+
+	USoundBase* Sound = GetFootstepSound(PhysicalMaterial);
+
+	if(bShowDebug)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FootstepComponent: Line trace hit actor %s, physical material %s, sound is %s."), *GetNameSafe(Hit.GetActor()), *GetNameSafe(PhysicalMaterial), *GetNameSafe(Sound));	
+	}
+
+	if(Sound != nullptr)
 	{
-		DrawDebugLine(World, StartLocation, EndLocation, FColor::Red, false, 0.5f, 0, 0);
+		OwnerCharacter->PlaySound(Sound);
 	}
+}
 
-	if(World->LineTraceSingleByChannel(OutHit, StartLocation, EndLocation, ECC_Visibility, CollisionQueryParams))
+void UFootstepComponent::PlayFootstepSound(const FName FootBoneName)
+{
+	UCeremonyTraceSubsystem* TraceSubsystem = UCeremonyTraceSubsystem::Get(this);
+	if(!IsValid(TraceSubsystem))
+	{
+		return;
+	}
+
+	const FVector StartLocation = OwnerMesh->GetBoneLocation(FootBoneName);
+	const FVector EndLocation = StartLocation - FVector(0.0f, 0.0f, FootTraceLength);
+
+	if(OwnerCharacter->IsShowingDebugCollision())
 	{
-		UPhysicalMaterial* PhysicalMaterial = OutHit.PhysMaterial.Get();
-		const FName PhysicalMaterialName = FName(*PhysicalMaterial->GetName());
-		const FFootStepSound* Sound = FootstepDataTable->FindRow<FFootStepSound>(PhysicalMaterialName, "", false);
-
-		if(bShowDebug)
-		{
-			if(Sound != nullptr)
-			{
-				UE_LOG(LogTemp, Warning, TEXT("FootstepComponent: Line trace hit actor %s, physical material %s, sound is %s."), *GetNameSafe(OutHit.GetActor()), *PhysicalMaterialName.ToString(), *GetNameSafe(Sound->FootstepSound));	
-			}
-			else
-			{
-				UE_LOG(LogTemp, Warning, TEXT("FootstepComponent: Line trace hit actor %s, physical material %s, no sound found."), *GetNameSafe(OutHit.GetActor()), *PhysicalMaterialName.ToString());	
-			}
-		}
-		
-		if(Sound != nullptr)
-		{
-			OwnerCharacter->PlaySound(Sound->FootstepSound);
-		}
+		DrawDebugLine(GetWorld(), StartLocation, EndLocation, FColor::Red, false, 0.5f, 0, 0);
 	}
 
-	return nullptr;
+	TraceSubsystem->RequestLineTrace(StartLocation, EndLocation, ECC_Visibility, CollisionQueryParams,
+		FOnCeremonyLineTraceComplete::CreateUObject(this, &UFootstepComponent::OnFootTraceComplete));
 }
@@ -0,0 +1,112 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Character/HitboxComponent.h"
+
+#include "Core/Ceremony.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitbox Sweeps"), STAT_HitboxSweeps, STATGROUP_Ceremony);
+
+UHitboxComponent::UHitboxComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Sweep once animation has moved the bones the capsule is attached to for the frame.
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	// Hits are found by sweeping the shape; the capsule itself takes no part in collision.
+	SetCollisionProfileName(TEXT("NoCollision"));
+	SetGenerateOverlapEvents(false);
+}
+
+FVector UHitboxComponent::GetPivotLocation() const
+{
+	const USceneComponent* Parent = GetAttachParent();
+	return IsValid(Parent) ? Parent->GetSocketLocation(GetAttachSocketName()) : GetComponentLocation();
+}
+
+void UHitboxComponent::SetCanHit(const bool bCanHit)
+{
+	if(bCanHit)
+	{
+		HitActors.Empty();
+		StorePreviousTransform();
+	}
+
+	SetComponentTickEnabled(bCanHit);
+}
+
+void UHitboxComponent::StorePreviousTransform()
+{
+	PreviousPivotLocation = GetPivotLocation();
+	PreviousRotation = GetComponentQuat();
+	PivotOffset = PreviousRotation.UnrotateVector(GetComponentLocation() - PreviousPivotLocation);
+}
+
+bool UHitboxComponent::Sweep(const FVector& Start, const FVector& End, const FQuat& Rotation)
+{
+	UWorld* World = GetWorld();
+	if(!IsValid(World))
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_HitboxSweeps);
+
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
+
+	FCollisionQueryParams Params;
+	Params.AddIgnoredActor(GetOwner());
+	Params.AddIgnoredActor(GetOwner()->GetOwner());
+	Params.AddIgnoredActors(HitActors);
+
+	TArray<FHitResult> OutHits;
+	World->SweepMultiByObjectType(OutHits, Start, End, Rotation, ObjectQueryParams, GetCollisionShape(), Params);
+
+	// Hits are in order along the sweep; report the first contact with each actor.
+	for(const FHitResult& OutHit : OutHits)
+	{
+		AActor* HitActor = OutHit.GetActor();
+		if(!IsValid(HitActor) || HitActors.Contains(HitActor))
+		{
+			continue;
+		}
+
+		HitActors.Add(HitActor);
+		OnHitboxHit.ExecuteIfBound(OutHit);
+	}
+
+	return true;
+}
+
+void UHitboxComponent::TickComponent(const float DeltaTime, const ELevelTick TickType,
+                                     FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const FVector PivotLocation = GetPivotLocation();
+	const FQuat Rotation = GetComponentQuat();
+
+	const float AngleDegrees = FMath::RadiansToDegrees(PreviousRotation.AngularDistance(Rotation));
+	const int32 SubSteps = FMath::Clamp(FMath::CeilToInt(AngleDegrees / MaxSubStepAngle), 1, MaxSubSteps);
+
+	FVector StepStart = PreviousPivotLocation + PreviousRotation.RotateVector(PivotOffset);
+	for(int32 Step = 1; Step <= SubSteps; Step++)
+	{
+		const float Alpha = static_cast<float>(Step) / SubSteps;
+		const FQuat StepRotation = FQuat::Slerp(PreviousRotation, Rotation, Alpha);
+		const FVector StepEnd = FMath::Lerp(PreviousPivotLocation, PivotLocation, Alpha) + StepRotation.RotateVector(PivotOffset);
+
+		// The capsule can't turn during a sweep; use the rotation halfway through the step.
+		if(!Sweep(StepStart, StepEnd, FQuat::Slerp(PreviousRotation, Rotation, (Step - 0.5f) / SubSteps)))
+		{
+			return;
+		}
+
+		StepStart = StepEnd;
+	}
+
+	StorePreviousTransform();
+}
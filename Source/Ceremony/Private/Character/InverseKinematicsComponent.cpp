@@ -3,6 +3,7 @@
 #include "Character/InverseKinematicsComponent.h"
 
 #include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyTraceSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 
@@ -13,6 +14,9 @@ UInverseKinematicsComponent::UInverseKinematicsComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
 	PrimaryComponentTick.bStartWithTickEnabled = true;
+
+	// Foot placement is only seen by players.
+	PrimaryComponentTick.bAllowTickOnDedicatedServer = false;
 }
 
 void UInverseKinematicsComponent::GetOffsets(FVector& OutPelvisOffset, FVector& OutLeftFootOffsetLocation,
@@ -25,19 +29,75 @@ void UInverseKinematicsComponent::GetOffsets(FVector& OutPelvisOffset, FVector&
 	OutRightFootOffsetRotation = RightFootCurrentOffsetRotation;
 }
 
+bool UInverseKinematicsComponent::IsAtRest() const
+{
+	return PelvisOffset.IsNearlyZero(0.1f) && LeftFootCurrentOffsetLocation.IsNearlyZero(0.1f) && RightFootCurrentOffsetLocation.IsNearlyZero(0.1f) &&
+		LeftFootCurrentOffsetRotation.IsNearlyZero(0.1f) && RightFootCurrentOffsetRotation.IsNearlyZero(0.1f);
+}
+
 void UInverseKinematicsComponent::ResetOffsets(const float DeltaTime)
 {
+	LeftFootTargetOffsetLocation = FVector::ZeroVector;
+	RightFootTargetOffsetLocation = FVector::ZeroVector;
+	LeftFootTargetOffsetRotation = FRotator::ZeroRotator;
+	RightFootTargetOffsetRotation = FRotator::ZeroRotator;
+	
 	SetPelvisOffset(DeltaTime, FVector::ZeroVector, FVector::ZeroVector);
 
 	LeftFootCurrentOffsetLocation = FMath::VInterpTo(LeftFootCurrentOffsetLocation, FVector::ZeroVector, DeltaTime, InterpolationDownSpeed);
 	RightFootCurrentOffsetLocation = FMath::VInterpTo(RightFootCurrentOffsetLocation, FVector::ZeroVector, DeltaTime, InterpolationDownSpeed);
+	LeftFootCurrentOffsetRotation = FMath::RInterpTo(LeftFootCurrentOffsetRotation, FRotator::ZeroRotator, DeltaTime, InterpolationDownSpeed);
+	RightFootCurrentOffsetRotation = FMath::RInterpTo(RightFootCurrentOffsetRotation, FRotator::ZeroRotator, DeltaTime, InterpolationDownSpeed);
+}
+
+void UInverseKinematicsComponent::InterpolateFootOffset(const float DeltaTime, FVector& CurrentOffsetLocation, const FVector& TargetOffsetLocation,
+	FRotator& CurrentOffsetRotation, const FRotator& TargetOffsetRotation) const
+{
+	// Interpolate foot location.
+	const float InterpolationSpeed = CurrentOffsetLocation.Z > TargetOffsetLocation.Z? InterpolationDownSpeed : InterpolationUpSpeed;
+	CurrentOffsetLocation = FMath::VInterpTo(CurrentOffsetLocation, TargetOffsetLocation, DeltaTime, InterpolationSpeed);
+
+	// Interpolate foot rotation.
+	CurrentOffsetRotation = FMath::RInterpTo(CurrentOffsetRotation, TargetOffsetRotation, DeltaTime, InterpolationDownSpeed);
+}
+
+void UInverseKinematicsComponent::OnFootTraceComplete(const bool bHit, const FHitResult& Hit, const FVector FootFloorLocation, const bool bRightFoot)
+{
+	FVector& TargetOffsetLocation = bRightFoot ? RightFootTargetOffsetLocation : LeftFootTargetOffsetLocation;
+	FRotator& TargetOffsetRotation = bRightFoot ? RightFootTargetOffsetRotation : LeftFootTargetOffsetRotation;
+
+	if(!bHit)
+	{
+		TargetOffsetLocation = FVector::ZeroVector;
+		TargetOffsetRotation = FRotator::ZeroRotator;
+		return;
+	}
+	
+	// Find the target offset in world space - the difference between the impact point and where it would be normally with no offset.
+	TargetOffsetLocation = ((Hit.ImpactNormal * FootHeight) + Hit.ImpactPoint) - (FootFloorLocation + FVector(0.0f, 0.0f, FootHeight));
+	
+	// Find the target foot rotation offset in degrees.
+	TargetOffsetRotation = FRotator(-1.0f * FMath::RadiansToDegrees(FMath::Atan2(Hit.ImpactNormal.X, Hit.ImpactNormal.Z)),
+		0.0f, FMath::RadiansToDegrees(FMath::Atan2(Hit.ImpactNormal.Y, Hit.ImpactNormal.Z)));
+	
+	if(bShowDebugTraces)
+	{
+		const UWorld* World = GetWorld();
+		DrawDebugLine(World, Hit.TraceStart, Hit.TraceEnd, FColor::Red, false, -1, 1, 0);
+		DrawDebugBox(World, FootFloorLocation, FVector(1.0f), FQuat::Identity, FColor::Red, false, -1, 1, 0);
+		
+		DrawDebugBox(World, Hit.ImpactPoint, FVector(1.0f), FQuat::Identity, FColor::Green, false, -1, 1, 0);
+		DrawDebugLine(World, Hit.ImpactPoint, FootFloorLocation, FColor::Green, false, -1, 2, 1);
+
+		DrawDebugLine(World, Hit.ImpactPoint, Hit.ImpactPoint + Hit.ImpactNormal * FootHeight, FColor::Yellow, false, -1, 1, 0);
+	}
 }
 
-void UInverseKinematicsComponent::SetFootOffset(float DeltaTime, FName FootBoneName, FVector& CurrentOffsetLocation, FVector& TargetOffsetLocation, FRotator& CurrentOffsetRotation) const
+void UInverseKinematicsComponent::RequestFootTrace(const FName FootBoneName, const bool bRightFoot)
 {
 	const ACeremonyCharacter* Owner = Cast<ACeremonyCharacter>(GetOwner());
-	const UWorld* World = GetWorld();
-	if(!IsValid(Owner) || !IsValid(World))
+	UCeremonyTraceSubsystem* TraceSubsystem = UCeremonyTraceSubsystem::Get(this);
+	if(!IsValid(Owner) || !IsValid(TraceSubsystem))
 	{
 		return;
 	}
@@ -55,43 +115,11 @@ void UInverseKinematicsComponent::SetFootOffset(float DeltaTime, FName FootBoneN
 	const FVector AboveFootFloorLocation = FVector(FootFloorLocation.X, FootFloorLocation.Y, FootFloorLocation.Z + TraceDistanceAbove);
 	const FVector BelowFootFloorLocation = FVector(FootFloorLocation.X, FootFloorLocation.Y, FootFloorLocation.Z - TraceDistanceBelow);
 
-	FHitResult OutHit;
 	FCollisionQueryParams Params;
 	Params.AddIgnoredActor(Owner);
 
-	FRotator TargetOffsetRotation = FRotator::ZeroRotator;
-	
-	if(World->LineTraceSingleByChannel(OutHit, AboveFootFloorLocation, BelowFootFloorLocation, ECC_Visibility, Params))
-	{
-		// Find the target offset in world space - the difference between the impact point and where it would be normally with no offset.
-		TargetOffsetLocation = ((OutHit.ImpactNormal * FootHeight) + OutHit.ImpactPoint) - (FootFloorLocation + FVector(0.0f, 0.0f, FootHeight));
-		
-		// Find the target foot rotation offset in degrees.
-		TargetOffsetRotation = FRotator(-1.0f * FMath::RadiansToDegrees(FMath::Atan2(OutHit.ImpactNormal.X, OutHit.ImpactNormal.Z)),
-			0.0f, FMath::RadiansToDegrees(FMath::Atan2(OutHit.ImpactNormal.Y, OutHit.ImpactNormal.Z)));
-		
-		if(bShowDebugTraces)
-		{
-			DrawDebugLine(World, AboveFootFloorLocation, BelowFootFloorLocation, FColor::Red, false, -1, 1, 0);
-			DrawDebugBox(World, FootFloorLocation, FVector(1.0f), FQuat::Identity, FColor::Red, false, -1, 1, 0);
-			
-			DrawDebugBox(World, OutHit.ImpactPoint, FVector(1.0f), FQuat::Identity, FColor::Green, false, -1, 1, 0);
-			DrawDebugLine(World, OutHit.ImpactPoint, FootFloorLocation, FColor::Green, false, -1, 2, 1);
-
-			DrawDebugLine(World, OutHit.ImpactPoint, OutHit.ImpactPoint + OutHit.ImpactNormal * FootHeight, FColor::Yellow, false, -1, 1, 0);
-		}
-	}
-	else
-	{
-		TargetOffsetLocation = FVector::ZeroVector;
-	}
-	
-	// Interpolate foot location.
-	const float InterpolationSpeed = CurrentOffsetLocation.Z > TargetOffsetLocation.Z? InterpolationDownSpeed : InterpolationUpSpeed;
-	CurrentOffsetLocation = FMath::VInterpTo(CurrentOffsetLocation, TargetOffsetLocation, DeltaTime, InterpolationSpeed);
-
-	// Interpolate foot rotation.
-	CurrentOffsetRotation = FMath::RInterpTo(CurrentOffsetRotation, TargetOffsetRotation, DeltaTime, InterpolationDownSpeed);
+	TraceSubsystem->RequestLineTrace(AboveFootFloorLocation, BelowFootFloorLocation, ECC_Visibility, Params,
+		FOnCeremonyLineTraceComplete::CreateUObject(this, &UInverseKinematicsComponent::OnFootTraceComplete, FootFloorLocation, bRightFoot));
 }
 
 void UInverseKinematicsComponent::SetPelvisOffset(const float DeltaTime, const FVector InLeftFootTargetOffsetLocation,
@@ -128,15 +156,46 @@ void UInverseKinematicsComponent::TickComponent(const float DeltaTime, const ELe
 		return;
 	}
 
-	if(Owner->GetCharacterMovement()->IsFalling())
+	if(TraceInterval < 0.0f)
+	{
+		// Tracing is off; stop ticking once the feet are back at rest.
+		ResetOffsets(DeltaTime);
+		if(IsAtRest())
+		{
+			SetComponentTickEnabled(false);
+		}
+	}
+	else if(Owner->GetCharacterMovement()->IsFalling())
 	{
 		ResetOffsets(DeltaTime);
 	}
 	else
 	{
-		SetFootOffset(DeltaTime, LeftFootBoneName, LeftFootCurrentOffsetLocation, LeftFootTargetOffsetLocation, LeftFootCurrentOffsetRotation);
-		SetFootOffset(DeltaTime, RightFootBoneName, RightFootCurrentOffsetLocation, RightFootTargetOffsetLocation, LeftFootCurrentOffsetRotation);
+		// Move towards the targets from the last traces every frame, so a reduced trace rate stays smooth.
+		InterpolateFootOffset(DeltaTime, LeftFootCurrentOffsetLocation, LeftFootTargetOffsetLocation, LeftFootCurrentOffsetRotation, LeftFootTargetOffsetRotation);
+		InterpolateFootOffset(DeltaTime, RightFootCurrentOffsetLocation, RightFootTargetOffsetLocation, RightFootCurrentOffsetRotation, RightFootTargetOffsetRotation);
 		SetPelvisOffset(DeltaTime, LeftFootTargetOffsetLocation, RightFootTargetOffsetLocation);
+
+		// Trace for the next frame.
+		TimeSinceTrace += DeltaTime;
+		if(TimeSinceTrace >= TraceInterval)
+		{
+			TimeSinceTrace = 0.0f;
+			RequestFootTrace(LeftFootBoneName, false);
+			RequestFootTrace(RightFootBoneName, true);
+		}
+	}
+}
+
+void UInverseKinematicsComponent::SetTraceInterval(const float Interval)
+{
+	TraceInterval = Interval;
+
+	if(Interval >= 0.0f)
+	{
+		// Trace on the next tick, rather than waiting a full interval.
+		TimeSinceTrace = Interval;
+		SetComponentTickEnabled(true);
 	}
 }
 
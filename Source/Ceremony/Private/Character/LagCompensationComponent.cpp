@@ -0,0 +1,136 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Character/LagCompensationComponent.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Core/Ceremony.h"
+#include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyFunctionLibrary.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind"), STAT_LagCompensationRewind, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Compensation Rewinds"), STAT_LagCompensationRewinds, STATGROUP_Ceremony);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Lag Compensation Rewind Seconds"), STAT_LagCompensationRewindSeconds, STATGROUP_Ceremony);
+
+FCapsuleSnapshot FCapsuleSnapshot::Interpolate(const FCapsuleSnapshot& From, const FCapsuleSnapshot& To, const float Alpha)
+{
+	FCapsuleSnapshot Result;
+	Result.Location = FMath::Lerp(From.Location, To.Location, Alpha);
+	Result.Rotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha);
+	Result.HalfHeight = FMath::Lerp(From.HalfHeight, To.HalfHeight, Alpha);
+	Result.Radius = FMath::Lerp(From.Radius, To.Radius, Alpha);
+	Result.ServerTime = FMath::Lerp(From.ServerTime, To.ServerTime, Alpha);
+	return Result;
+}
+
+bool FCapsuleSnapshot::OverlapsSphere(const FVector& SphereCenter, const float SphereRadius) const
+{
+	// The capsule is a segment along its up axis, swept by its radius.
+	const FVector SegmentOffset = Rotation.GetUpVector() * FMath::Max(HalfHeight - Radius, 0.0f);
+	const FVector ClosestPoint = FMath::ClosestPointOnSegment(SphereCenter, Location - SegmentOffset, Location + SegmentOffset);
+
+	return FVector::DistSquared(ClosestPoint, SphereCenter) <= FMath::Square(Radius + SphereRadius);
+}
+
+ULagCompensationComponent::ULagCompensationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Record after movement has been resolved for the frame.
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void ULagCompensationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	OwnerCharacter = Cast<ACeremonyCharacter>(GetOwner());
+	check(IsValid(OwnerCharacter));
+
+	// History is only needed where hits are verified.
+	if(OwnerCharacter->HasAuthority())
+	{
+		History.SetNum(HistorySize);
+		HistoryHead = 0;
+		HistoryCount = 0;
+
+		SetComponentTickEnabled(true);
+	}
+}
+
+FCapsuleSnapshot ULagCompensationComponent::CaptureSnapshot() const
+{
+	const UCapsuleComponent* Capsule = OwnerCharacter->GetCapsuleComponent();
+
+	FCapsuleSnapshot Snapshot;
+	Snapshot.Location = Capsule->GetComponentLocation();
+	Snapshot.Rotation = Capsule->GetComponentQuat();
+	Snapshot.HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	Snapshot.Radius = Capsule->GetScaledCapsuleRadius();
+	Snapshot.ServerTime = UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this);
+	return Snapshot;
+}
+
+bool ULagCompensationComponent::DidSphereOverlapAtTime(const FVector& SphereCenter, const float SphereRadius, const float ServerTime,
+	FCapsuleSnapshot& OutSnapshot) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRewind);
+	INC_DWORD_STAT(STAT_LagCompensationRewinds);
+
+	OutSnapshot = GetSnapshotAtTime(ServerTime);
+
+	INC_FLOAT_STAT_BY(STAT_LagCompensationRewindSeconds, UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this) - OutSnapshot.ServerTime);
+
+	return OutSnapshot.OverlapsSphere(SphereCenter, SphereRadius);
+}
+
+FCapsuleSnapshot ULagCompensationComponent::GetSnapshotAtTime(const float ServerTime) const
+{
+	// With no history (not yet recorded, or not the server) the present is all there is.
+	if(HistoryCount == 0)
+	{
+		return CaptureSnapshot();
+	}
+
+	const float CurrentTime = UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this);
+	const float RewindTime = FMath::Clamp(ServerTime, CurrentTime - MaxRewindTime, CurrentTime);
+
+	// Newer than the last recording; use the latest.
+	if(RewindTime >= GetHistoryEntry(0).ServerTime)
+	{
+		return GetHistoryEntry(0);
+	}
+
+	// Walk back from the newest entry to find the pair that brackets the rewind time.
+	for(int32 Age = 1; Age < HistoryCount; Age++)
+	{
+		const FCapsuleSnapshot& Older = GetHistoryEntry(Age);
+		if(Older.ServerTime <= RewindTime)
+		{
+			const FCapsuleSnapshot& Newer = GetHistoryEntry(Age - 1);
+			const float Span = Newer.ServerTime - Older.ServerTime;
+			const float Alpha = Span > SMALL_NUMBER ? (RewindTime - Older.ServerTime) / Span : 1.0f;
+
+			return FCapsuleSnapshot::Interpolate(Older, Newer, Alpha);
+		}
+	}
+
+	// Older than the buffer covers; use the oldest.
+	return GetHistoryEntry(HistoryCount - 1);
+}
+
+void ULagCompensationComponent::ResetHistory()
+{
+	HistoryHead = 0;
+	HistoryCount = 0;
+}
+
+void ULagCompensationComponent::TickComponent(const float DeltaTime, const ELevelTick TickType,
+                                              FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	History[HistoryHead] = CaptureSnapshot();
+	HistoryHead = (HistoryHead + 1) % HistorySize;
+	HistoryCount = FMath::Min(HistoryCount + 1, HistorySize);
+}
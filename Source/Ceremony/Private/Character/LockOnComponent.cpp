@@ -4,9 +4,9 @@
 
 #include "Camera/CameraComponent.h"
 #include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyCharacterRegistry.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "DrawDebugHelpers.h"
-#include "Components/PrimitiveComponent.h"
 #include "Engine/World.h"
 
 ULockOnComponent::ULockOnComponent()
@@ -75,9 +75,10 @@ ACeremonyCharacter* ULockOnComponent::FindValidCharacterWithHighestDotProduct()
 void ULockOnComponent::GetValidLockOnCharacters()
 {
 	const UWorld* World = GetWorld();
-	if(!IsValid(World) || !IsValid(OwnerCharacter))
+	UCeremonyCharacterRegistry* CharacterRegistry = UCeremonyCharacterRegistry::Get(this);
+	if(!IsValid(World) || !IsValid(OwnerCharacter) || !IsValid(CharacterRegistry))
 	{
-		UE_LOG(LogTemp, Error, TEXT("ULockOnComponent: World or owning character INVALID."));
+		UE_LOG(LogTemp, Error, TEXT("ULockOnComponent: World, owning character or character registry INVALID."));
 		return;
 	}
 
@@ -86,12 +87,6 @@ void ULockOnComponent::GetValidLockOnCharacters()
 
 	// Cache owner location.
 	const FVector OwnerLocation = OwnerCharacter->GetActorLocation();
-	
-	TArray<FOverlapResult> OutOverlaps;
-	FCollisionObjectQueryParams ObjectQueryParams;
-	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(GetOwner());
 
 	// Draw debug sphere to show the range.
 	if(OwnerCharacter->IsShowingDebugCollision())
@@ -99,55 +94,27 @@ void ULockOnComponent::GetValidLockOnCharacters()
 		DrawDebugSphere(World, OwnerLocation, LockOnSphereRadius, 16, FColor::Red, false, 3.0f, 0, 0);
 	}
 	
-	// First do a sphere overlap to find all characters within the valid radius.
-	if(!World->OverlapMultiByObjectType(OutOverlaps, OwnerLocation, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeSphere(LockOnSphereRadius), Params))
-	{
-		// No pawns found in radius
-		return;
-	}
+	// Find characters within range in front of the camera, to prevent locking onto characters that are behind it.
+	const FRotator CameraRotation = FRotator(0.0f, OwnerCharacter->GetControlRotation().Yaw, 0.0f);
+	const FVector CameraDirection = FRotationMatrix(CameraRotation).GetUnitAxis(EAxis::X);
+
+	TArray<FCeremonyCharacterQueryResult> Results;
+	CharacterRegistry->FindCharactersInCone(OwnerLocation, CameraDirection, LockOnSphereRadius, DotProductRange, Results, OwnerCharacter);
 	
-	for(FOverlapResult& OutOverlap : OutOverlaps)
+	for(const FCeremonyCharacterQueryResult& Result : Results)
 	{
-		ACeremonyCharacter* TargetCharacter = Cast<ACeremonyCharacter>(OutOverlap.GetActor());
-		if(!IsValid(TargetCharacter) || TargetCharacter->GetHealth() == 0.0f)
-		{
-			continue;
-		}
-
-		if(bShowDebugMessages)
-		{
-			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::GetValidLockOnPawns: Checking actor %s, component %s for validity."), *GetNameSafe(OutOverlap.GetActor()), *GetNameSafe(OutOverlap.GetComponent()));
-		}
-		
-		// Check that the cross product between the camera forward vector and the vector to the target is within range.
-		const FRotator CameraRotation = FRotator(0.0f, OwnerCharacter->GetControlRotation().Yaw, 0.0f);
-		const FVector CameraDirection = FRotationMatrix(CameraRotation).GetUnitAxis(EAxis::X);
-
-		// Create a vector from the character to the target.
-		FVector TargetVector = TargetCharacter->GetActorLocation() - OwnerLocation;
-		TargetVector.Z = 0.0f;
-		TargetVector = TargetVector.GetSafeNormal(0.1f);
-		
-		const FVector CrossProduct = FVector::CrossProduct(CameraDirection, TargetVector); 
-		const float DotProduct = FVector::DotProduct(CameraDirection, TargetVector);
-
-		// Check that the dot product is within range, to prevent locking onto characters that are behind the camera.
-		if(DotProduct < DotProductRange)
+		if(Result.Character->GetHealth() == 0.0f)
 		{
-			if(OwnerCharacter->IsShowingDebugCollision())
-			{
-				DrawDebugLine(World, OwnerLocation, TargetCharacter->GetActorLocation(), FColor::Red, false, 3, 0, 0);
-			}
-
 			continue;
 		}
 
 		if(OwnerCharacter->IsShowingDebugCollision())
 		{
-			DrawDebugLine(World, OwnerLocation, TargetCharacter->GetActorLocation(), FColor::Green, false, 3, 0, 0);
+			DrawDebugLine(World, OwnerLocation, Result.Location, FColor::Green, false, 3, 0, 0);
 		}
 
-		ValidLockOnCharacters.Add(FValidLockOnCharacter(TargetCharacter, CrossProduct, DotProduct));
+		// Both vectors are horizontal, so the cross product only has a Z component.
+		ValidLockOnCharacters.Add(FValidLockOnCharacter(Result.Character, FVector(0.0f, 0.0f, Result.CrossProductZ), Result.DotProduct));
 	}
 
 	if(ValidLockOnCharacters.Num() > 1)
@@ -236,8 +203,14 @@ void ULockOnComponent::YawInput(const float Value)
 	
 	bBlockUntilYawReturn = true;
 	
+	// Update list of characters that are valid to lock onto.
 	GetValidLockOnCharacters();
 
+	SwitchLockedOn(Value);
+}
+
+void ULockOnComponent::SwitchLockedOn(const float Value)
+{
 	// No valid ones.
 	if(ValidLockOnCharacters.Num() == 0)
 	{
@@ -252,7 +225,7 @@ void ULockOnComponent::YawInput(const float Value)
 
 		if(bShowDebugMessages)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::YawInput: One one valid pawn to select, %s."), *GetNameSafe(LockedOnCharacter));
+			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::SwitchLockedOn: One one valid pawn to select, %s."), *GetNameSafe(LockedOnCharacter));
 		}
 		return;
 	}
@@ -273,7 +246,7 @@ void ULockOnComponent::YawInput(const float Value)
 		// Couldn't find current target in the valid list
 		if(bShowDebugMessages)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::YawInput: Couldn't find previously locked on pawn %s."), *GetNameSafe(LockedOnCharacter));
+			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::SwitchLockedOn: Couldn't find previously locked on pawn %s."), *GetNameSafe(LockedOnCharacter));
 		}
 
 		SetLockedOn(FindValidCharacterWithHighestDotProduct());
@@ -289,7 +262,7 @@ void ULockOnComponent::YawInput(const float Value)
 			// None exist to the right, keep current selection.
 			if(bShowDebugMessages)
 			{
-				UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::YawInput: Couldn't find pawn to the right, keeping selection %s."), *GetNameSafe(LockedOnCharacter));
+				UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::SwitchLockedOn: Couldn't find pawn to the right, keeping selection %s."), *GetNameSafe(LockedOnCharacter));
 			}
 
 			return;
@@ -297,7 +270,7 @@ void ULockOnComponent::YawInput(const float Value)
 
 		if(bShowDebugMessages)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::YawInput: Found pawn to the right %s."), *GetNameSafe(ValidLockOnCharacters[LockedOnIndex].Character));
+			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::SwitchLockedOn: Found pawn to the right %s."), *GetNameSafe(ValidLockOnCharacters[LockedOnIndex].Character));
 		}
 
 		SetLockedOn(ValidLockOnCharacters[LockedOnIndex].Character);
@@ -311,7 +284,7 @@ void ULockOnComponent::YawInput(const float Value)
 			// None exist to the left, keep current selection.
 			if(bShowDebugMessages)
 			{
-				UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::YawInput: Couldn't find pawn to the left, keeping selection %s."), *GetNameSafe(LockedOnCharacter));
+				UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::SwitchLockedOn: Couldn't find pawn to the left, keeping selection %s."), *GetNameSafe(LockedOnCharacter));
 			}
 
 			return;
@@ -319,7 +292,7 @@ void ULockOnComponent::YawInput(const float Value)
 
 		if(bShowDebugMessages)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::YawInput: Found pawn to the left %s."), *GetNameSafe(ValidLockOnCharacters[LockedOnIndex].Character));
+			UE_LOG(LogTemp, Warning, TEXT("ULockOnComponent::SwitchLockedOn: Found pawn to the left %s."), *GetNameSafe(ValidLockOnCharacters[LockedOnIndex].Character));
 		}
 		
 		SetLockedOn(ValidLockOnCharacters[LockedOnIndex].Character);
@@ -390,6 +363,8 @@ void ULockOnComponent::RotateCharacterYawTowardsTarget(const float DeltaTime)
 {
 	if(!OwnerCharacter->GetAllowMovement())
 	{
+		// Hold the current facing while actions lock movement.
+		OwnerCharacter->SetLockOnYaw(OwnerCharacter->GetActorRotation().Yaw);
 		return;
 	}
 
@@ -400,25 +375,13 @@ void ULockOnComponent::RotateCharacterYawTowardsTarget(const float DeltaTime)
 
 	const float CharacterYaw = OwnerCharacter->GetActorRotation().Yaw;
 
-	float Difference = TargetYaw - CharacterYaw;
+	const float Difference = FRotator::NormalizeAxis(TargetYaw - CharacterYaw);
 
 	if(FMath::Abs(Difference) < 10.0f)
 	{
 		return;
 	}
 
-	if(Difference > 180.0f)
-	{
-		Difference -= 360.0f;
-	}
-	else if(Difference < -180.0f)
-	{
-		Difference += 360.0f;
-	}
-
-	const float Step = Difference > 0.0f? FMath::Clamp(OwnerCharacter->GetCharacterMovement()->RotationRate.Yaw * DeltaTime, 0.0f, Difference)
-						: FMath::Clamp(OwnerCharacter->GetCharacterMovement()->RotationRate.Yaw * DeltaTime * -1.0f, Difference, 0.0f);
-	
 	// If the character is standing still and need to adjust yaw, play correction montage.
 	if(!bPlayingYawCorrectionMontage && FMath::IsNearlyZero(OwnerCharacter->GetVelocity().Size(), 1.0f))
 	{
@@ -427,7 +390,8 @@ void ULockOnComponent::RotateCharacterYawTowardsTarget(const float DeltaTime)
 		OwnerCharacter->SetOnMontageEndedDelegate(this, TEXT("OnYawCorrectionMontageEnded"), YawCorrectionMontage);
 	}
 
-	OwnerCharacter->Server_SetActorRotation(OwnerCharacter->GetActorRotation() + FRotator(0.0f, Step, 0.0f));
+	// The movement component turns the character at its rotation rate, predicted locally and replayed on the server.
+	OwnerCharacter->SetLockOnYaw(TargetYaw);
 }
 
 #pragma endregion
\ No newline at end of file
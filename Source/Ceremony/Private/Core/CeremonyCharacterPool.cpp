@@ -0,0 +1,139 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyCharacterPool.h"
+
+#include "Core/Ceremony.h"
+#include "Character/CeremonyCharacter.h"
+#include "GameFramework/Controller.h"
+#include "TimerManager.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Characters"), STAT_PooledCharacters, STATGROUP_Ceremony);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Characters Reused"), STAT_PooledCharactersReused, STATGROUP_Ceremony);
+
+static TAutoConsoleVariable<int32> CVarCharacterPoolEnabled(
+	TEXT("Ceremony.CharacterPool.Enabled"), 1,
+	TEXT("Whether dead characters are kept for their controller's next respawn. When 0 they're destroyed and respawns spawn new characters."));
+
+UCeremonyCharacterPool* UCeremonyCharacterPool::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonyCharacterPool>() : nullptr;
+}
+
+ACeremonyCharacter* UCeremonyCharacterPool::AcquireCharacter(const AController* Controller, UClass* CharacterClass, const FTransform& Transform)
+{
+	RemoveAbandonedCharacters();
+
+	const int32 Index = PooledCharacters.IndexOfByPredicate([Controller, CharacterClass](const FCeremonyPooledCharacter& Pooled)
+	{
+		return Pooled.Controller.Get() == Controller && Pooled.Character->GetClass() == CharacterClass;
+	});
+
+	if(Index == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	ACeremonyCharacter* Character = PooledCharacters[Index].Character;
+	PooledCharacters.RemoveAtSwap(Index);
+	SET_DWORD_STAT(STAT_PooledCharacters, PooledCharacters.Num());
+	INC_DWORD_STAT(STAT_PooledCharactersReused);
+
+	Character->LeavePool(Transform);
+	return Character;
+}
+
+void UCeremonyCharacterPool::Deinitialize()
+{
+	UWorld* World = GetWorld();
+	if(IsValid(World))
+	{
+		for(TPair<TWeakObjectPtr<ACeremonyCharacter>, FTimerHandle>& Pair : ReturnTimerHandles)
+		{
+			World->GetTimerManager().ClearTimer(Pair.Value);
+		}
+	}
+
+	ReturnTimerHandles.Empty();
+	PooledCharacters.Empty();
+	SET_DWORD_STAT(STAT_PooledCharacters, 0);
+
+	Super::Deinitialize();
+}
+
+bool UCeremonyCharacterPool::ReleaseCharacter(ACeremonyCharacter* Character, const float RagdollTime)
+{
+	UWorld* World = GetWorld();
+	if(CVarCharacterPoolEnabled.GetValueOnGameThread() == 0 || !IsValid(Character) || !IsValid(World))
+	{
+		return false;
+	}
+
+	// A corpse can be killed again; the first death's timer stands.
+	FTimerHandle& TimerHandle = ReturnTimerHandles.FindOrAdd(Character);
+	if(World->GetTimerManager().IsTimerActive(TimerHandle))
+	{
+		return true;
+	}
+
+	const FTimerDelegate TimerDelegate = FTimerDelegate::CreateUObject(this, &UCeremonyCharacterPool::ReturnCharacter,
+		TWeakObjectPtr<ACeremonyCharacter>(Character));
+	World->GetTimerManager().SetTimer(TimerHandle, TimerDelegate, RagdollTime, false);
+	return true;
+}
+
+void UCeremonyCharacterPool::RemoveAbandonedCharacters()
+{
+	PooledCharacters.RemoveAllSwap([](const FCeremonyPooledCharacter& Pooled)
+	{
+		if(!IsValid(Pooled.Character))
+		{
+			return true;
+		}
+
+		if(!Pooled.Controller.IsValid())
+		{
+			Pooled.Character->Destroy();
+			return true;
+		}
+
+		return false;
+	});
+
+	SET_DWORD_STAT(STAT_PooledCharacters, PooledCharacters.Num());
+}
+
+void UCeremonyCharacterPool::ReturnCharacter(const TWeakObjectPtr<ACeremonyCharacter> WeakCharacter)
+{
+	ReturnTimerHandles.Remove(WeakCharacter);
+
+	ACeremonyCharacter* Character = WeakCharacter.Get();
+	if(!IsValid(Character))
+	{
+		return;
+	}
+
+	// The character may have been pooled and handed out to a respawn already.
+	const bool bIsAlreadyPooled = Character->GetIsPooled() || PooledCharacters.ContainsByPredicate([Character](const FCeremonyPooledCharacter& Pooled) { return Pooled.Character == Character; });
+	if(Character->GetHealth() > 0.0f || bIsAlreadyPooled)
+	{
+		return;
+	}
+
+	// Only the controller that possessed the character can reuse it.
+	AController* Controller = Character->GetController();
+	if(!IsValid(Controller))
+	{
+		Character->Destroy();
+		return;
+	}
+
+	Character->EnterPool();
+
+	FCeremonyPooledCharacter& Pooled = PooledCharacters.AddDefaulted_GetRef();
+	Pooled.Character = Character;
+	Pooled.Controller = Controller;
+
+	RemoveAbandonedCharacters();
+}
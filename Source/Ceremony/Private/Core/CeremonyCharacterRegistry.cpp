@@ -0,0 +1,336 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyCharacterRegistry.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Core/Ceremony.h"
+#include "Character/CeremonyCharacter.h"
+#include "Engine/World.h"
+#include "Math/VectorRegister.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Registry Update"), STAT_CharacterRegistryUpdate, STATGROUP_Ceremony);
+DECLARE_CYCLE_STAT(TEXT("Character Registry Query"), STAT_CharacterRegistryQuery, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Registry Queries"), STAT_CharacterRegistryQueries, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Registry Entries Tested"), STAT_CharacterRegistryEntriesTested, STATGROUP_Ceremony);
+
+// Location of padding entries; far enough to fail every query, near enough that squaring it doesn't overflow.
+static constexpr float PaddingLocation = 1.0e10f;
+
+UCeremonyCharacterRegistry* UCeremonyCharacterRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonyCharacterRegistry>() : nullptr;
+}
+
+void UCeremonyCharacterRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCeremonyCharacterRegistry::UpdateRegistry);
+}
+
+void UCeremonyCharacterRegistry::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	RegisteredCharacters.Empty();
+	Characters.Empty();
+	Cells.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UCeremonyCharacterRegistry::FindCharacterAlongLine(const FVector& Start, const FVector& Direction, const float Length,
+                                                        FCeremonyCharacterQueryResult& OutResult, const ACeremonyCharacter* IgnoreCharacter) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterRegistryQuery);
+	INC_DWORD_STAT(STAT_CharacterRegistryQueries);
+
+	const FVector FlatDirection = FVector(Direction.X, Direction.Y, 0.0f).GetSafeNormal();
+
+	const VectorRegister StartX = VectorSetFloat1(Start.X);
+	const VectorRegister StartY = VectorSetFloat1(Start.Y);
+	const VectorRegister StartZ = VectorSetFloat1(Start.Z);
+	const VectorRegister DirectionX = VectorSetFloat1(FlatDirection.X);
+	const VectorRegister DirectionY = VectorSetFloat1(FlatDirection.Y);
+	const VectorRegister LengthRegister = VectorSetFloat1(Length);
+
+	bool bFound = false;
+	float NearestAlongLine = BIG_NUMBER;
+
+	// Any capsule the line can reach has its center within the length plus its radius.
+	ForEachCellInRange(Start, Length + MaxCapsuleRadius, [&](const FCellRange& Range)
+	{
+		INC_DWORD_STAT_BY(STAT_CharacterRegistryEntriesTested, Range.Count);
+
+		for(int32 Index = Range.Start; Index < Range.Start + Range.Count; Index += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(VectorLoadAligned(&LocationsX[Index]), StartX);
+			const VectorRegister DeltaY = VectorSubtract(VectorLoadAligned(&LocationsY[Index]), StartY);
+			const VectorRegister DeltaZ = VectorSubtract(VectorLoadAligned(&LocationsZ[Index]), StartZ);
+			const VectorRegister Radius = VectorLoadAligned(&CapsuleRadii[Index]);
+			const VectorRegister HalfHeight = VectorLoadAligned(&CapsuleHalfHeights[Index]);
+
+			// Distance along the line to the closest approach, and the squared horizontal distance from the line there.
+			const VectorRegister AlongLine = VectorMultiplyAdd(DeltaY, DirectionY, VectorMultiply(DeltaX, DirectionX));
+			const VectorRegister FlatDistanceSquared = VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaX, DeltaX));
+			const VectorRegister FromLineSquared = VectorSubtract(FlatDistanceSquared, VectorMultiply(AlongLine, AlongLine));
+
+			VectorRegister Hit = VectorCompareGE(AlongLine, VectorZero());
+			Hit = VectorBitwiseAnd(Hit, VectorCompareLE(VectorSubtract(AlongLine, Radius), LengthRegister));
+			Hit = VectorBitwiseAnd(Hit, VectorCompareLE(FromLineSquared, VectorMultiply(Radius, Radius)));
+			Hit = VectorBitwiseAnd(Hit, VectorCompareLE(VectorAbs(DeltaZ), HalfHeight));
+
+			for(uint32 Mask = VectorMaskBits(Hit); Mask != 0; Mask &= Mask - 1)
+			{
+				const int32 EntryIndex = Index + FMath::CountTrailingZeros(Mask);
+				const float EntryAlongLine = (LocationsX[EntryIndex] - Start.X) * FlatDirection.X + (LocationsY[EntryIndex] - Start.Y) * FlatDirection.Y;
+
+				// Corpses lie in the registry until they're pooled; as with lock on, they're not targets.
+				FCeremonyCharacterQueryResult Result;
+				if(EntryAlongLine < NearestAlongLine && MakeResult(EntryIndex, Start, IgnoreCharacter, Result) && Result.Character->GetHealth() > 0.0f)
+				{
+					NearestAlongLine = EntryAlongLine;
+					OutResult = Result;
+					bFound = true;
+				}
+			}
+		}
+	});
+
+	return bFound;
+}
+
+void UCeremonyCharacterRegistry::FindCharactersInCone(const FVector& Origin, const FVector& Direction, const float Radius, const float MinimumDotProduct,
+                                                      TArray<FCeremonyCharacterQueryResult>& OutResults, const ACeremonyCharacter* IgnoreCharacter) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterRegistryQuery);
+	INC_DWORD_STAT(STAT_CharacterRegistryQueries);
+
+	const FVector FlatDirection = FVector(Direction.X, Direction.Y, 0.0f).GetSafeNormal();
+
+	const VectorRegister OriginX = VectorSetFloat1(Origin.X);
+	const VectorRegister OriginY = VectorSetFloat1(Origin.Y);
+	const VectorRegister OriginZ = VectorSetFloat1(Origin.Z);
+	const VectorRegister DirectionX = VectorSetFloat1(FlatDirection.X);
+	const VectorRegister DirectionY = VectorSetFloat1(FlatDirection.Y);
+	const VectorRegister RadiusSquared = VectorSetFloat1(FMath::Square(Radius));
+	const VectorRegister MinimumDot = VectorSetFloat1(MinimumDotProduct);
+
+	ForEachCellInRange(Origin, Radius, [&](const FCellRange& Range)
+	{
+		INC_DWORD_STAT_BY(STAT_CharacterRegistryEntriesTested, Range.Count);
+
+		for(int32 Index = Range.Start; Index < Range.Start + Range.Count; Index += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(VectorLoadAligned(&LocationsX[Index]), OriginX);
+			const VectorRegister DeltaY = VectorSubtract(VectorLoadAligned(&LocationsY[Index]), OriginY);
+			const VectorRegister DeltaZ = VectorSubtract(VectorLoadAligned(&LocationsZ[Index]), OriginZ);
+
+			const VectorRegister FlatDistanceSquared = VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaX, DeltaX));
+			const VectorRegister DistanceSquared = VectorMultiplyAdd(DeltaZ, DeltaZ, FlatDistanceSquared);
+
+			// A character directly above or below gives NaN here, which fails the comparison.
+			const VectorRegister DotProduct = VectorMultiply(VectorMultiplyAdd(DeltaY, DirectionY, VectorMultiply(DeltaX, DirectionX)), VectorReciprocalSqrt(FlatDistanceSquared));
+
+			const VectorRegister Hit = VectorBitwiseAnd(VectorCompareLE(DistanceSquared, RadiusSquared), VectorCompareGE(DotProduct, MinimumDot));
+
+			for(uint32 Mask = VectorMaskBits(Hit); Mask != 0; Mask &= Mask - 1)
+			{
+				FCeremonyCharacterQueryResult Result;
+				if(!MakeResult(Index + FMath::CountTrailingZeros(Mask), Origin, IgnoreCharacter, Result))
+				{
+					continue;
+				}
+
+				const FVector ToCharacter = FVector(Result.Location.X - Origin.X, Result.Location.Y - Origin.Y, 0.0f).GetSafeNormal(0.1f);
+				Result.DotProduct = FVector::DotProduct(FlatDirection, ToCharacter);
+				Result.CrossProductZ = FlatDirection.X * ToCharacter.Y - FlatDirection.Y * ToCharacter.X;
+				OutResults.Add(Result);
+			}
+		}
+	});
+}
+
+void UCeremonyCharacterRegistry::FindCharactersInRadius(const FVector& Origin, const float Radius, TArray<FCeremonyCharacterQueryResult>& OutResults,
+                                                        const ACeremonyCharacter* IgnoreCharacter) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterRegistryQuery);
+	INC_DWORD_STAT(STAT_CharacterRegistryQueries);
+
+	const VectorRegister OriginX = VectorSetFloat1(Origin.X);
+	const VectorRegister OriginY = VectorSetFloat1(Origin.Y);
+	const VectorRegister OriginZ = VectorSetFloat1(Origin.Z);
+	const VectorRegister RadiusSquared = VectorSetFloat1(FMath::Square(Radius));
+
+	ForEachCellInRange(Origin, Radius, [&](const FCellRange& Range)
+	{
+		INC_DWORD_STAT_BY(STAT_CharacterRegistryEntriesTested, Range.Count);
+
+		for(int32 Index = Range.Start; Index < Range.Start + Range.Count; Index += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(VectorLoadAligned(&LocationsX[Index]), OriginX);
+			const VectorRegister DeltaY = VectorSubtract(VectorLoadAligned(&LocationsY[Index]), OriginY);
+			const VectorRegister DeltaZ = VectorSubtract(VectorLoadAligned(&LocationsZ[Index]), OriginZ);
+
+			const VectorRegister DistanceSquared = VectorMultiplyAdd(DeltaZ, DeltaZ, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaX, DeltaX)));
+
+			for(uint32 Mask = VectorMaskBits(VectorCompareLE(DistanceSquared, RadiusSquared)); Mask != 0; Mask &= Mask - 1)
+			{
+				FCeremonyCharacterQueryResult Result;
+				if(MakeResult(Index + FMath::CountTrailingZeros(Mask), Origin, IgnoreCharacter, Result))
+				{
+					OutResults.Add(Result);
+				}
+			}
+		}
+	});
+}
+
+template<typename FunctionType>
+void UCeremonyCharacterRegistry::ForEachCellInRange(const FVector& Origin, const float Radius, FunctionType Function) const
+{
+	const FIntPoint MinimumCell = GetCell(Origin - FVector(Radius));
+	const FIntPoint MaximumCell = GetCell(Origin + FVector(Radius));
+
+	// For very large ranges, walking the occupied cells is cheaper than looking up every cell in range.
+	const int64 CellsInRange = static_cast<int64>(MaximumCell.X - MinimumCell.X + 1) * (MaximumCell.Y - MinimumCell.Y + 1);
+	if(CellsInRange > Cells.Num())
+	{
+		for(const TPair<FIntPoint, FCellRange>& Cell : Cells)
+		{
+			if(Cell.Key.X >= MinimumCell.X && Cell.Key.X <= MaximumCell.X && Cell.Key.Y >= MinimumCell.Y && Cell.Key.Y <= MaximumCell.Y)
+			{
+				Function(Cell.Value);
+			}
+		}
+		return;
+	}
+
+	for(int32 X = MinimumCell.X; X <= MaximumCell.X; X++)
+	{
+		for(int32 Y = MinimumCell.Y; Y <= MaximumCell.Y; Y++)
+		{
+			const FCellRange* Range = Cells.Find(FIntPoint(X, Y));
+			if(Range != nullptr)
+			{
+				Function(*Range);
+			}
+		}
+	}
+}
+
+FIntPoint UCeremonyCharacterRegistry::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+bool UCeremonyCharacterRegistry::MakeResult(const int32 Index, const FVector& Origin, const ACeremonyCharacter* IgnoreCharacter,
+                                            FCeremonyCharacterQueryResult& OutResult) const
+{
+	ACeremonyCharacter* Character = Characters[Index];
+	if(!IsValid(Character) || Character == IgnoreCharacter)
+	{
+		return false;
+	}
+
+	OutResult.Character = Character;
+	OutResult.Location = FVector(LocationsX[Index], LocationsY[Index], LocationsZ[Index]);
+	OutResult.ForwardVector = FVector(ForwardsX[Index], ForwardsY[Index], ForwardsZ[Index]);
+	OutResult.DistanceSquared = FVector::DistSquared(OutResult.Location, Origin);
+	return true;
+}
+
+void UCeremonyCharacterRegistry::RegisterCharacter(ACeremonyCharacter* Character)
+{
+	if(IsValid(Character))
+	{
+		RegisteredCharacters.AddUnique(Character);
+	}
+}
+
+void UCeremonyCharacterRegistry::UnregisterCharacter(ACeremonyCharacter* Character)
+{
+	RegisteredCharacters.RemoveSwap(Character);
+
+	// Drop the entry now rather than at the next update, so it isn't returned in the meantime.
+	const int32 Index = Characters.Find(Character);
+	if(Index != INDEX_NONE)
+	{
+		Characters[Index] = nullptr;
+	}
+}
+
+void UCeremonyCharacterRegistry::UpdateRegistry(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if(World != GetWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CharacterRegistryUpdate);
+
+	RegisteredCharacters.RemoveAll([](const ACeremonyCharacter* Character) { return !IsValid(Character); });
+
+	// Group the characters by cell.
+	TArray<TPair<FIntPoint, ACeremonyCharacter*>> CellCharacters;
+	CellCharacters.Reserve(RegisteredCharacters.Num());
+	for(ACeremonyCharacter* Character : RegisteredCharacters)
+	{
+		CellCharacters.Emplace(GetCell(Character->GetActorLocation()), Character);
+	}
+
+	CellCharacters.Sort([](const TPair<FIntPoint, ACeremonyCharacter*>& A, const TPair<FIntPoint, ACeremonyCharacter*>& B)
+	{
+		return A.Key.X != B.Key.X ? A.Key.X < B.Key.X : A.Key.Y < B.Key.Y;
+	});
+
+	Cells.Reset();
+	Characters.Reset();
+	LocationsX.Reset();
+	LocationsY.Reset();
+	LocationsZ.Reset();
+	ForwardsX.Reset();
+	ForwardsY.Reset();
+	ForwardsZ.Reset();
+	CapsuleRadii.Reset();
+	CapsuleHalfHeights.Reset();
+
+	const auto AddEntry = [this](ACeremonyCharacter* Character, const FVector& Location, const FVector& Forward, const float Radius, const float HalfHeight)
+	{
+		Characters.Add(Character);
+		LocationsX.Add(Location.X);
+		LocationsY.Add(Location.Y);
+		LocationsZ.Add(Location.Z);
+		ForwardsX.Add(Forward.X);
+		ForwardsY.Add(Forward.Y);
+		ForwardsZ.Add(Forward.Z);
+		CapsuleRadii.Add(Radius);
+		CapsuleHalfHeights.Add(HalfHeight);
+	};
+
+	MaxCapsuleRadius = 0.0f;
+
+	int32 Index = 0;
+	while(Index < CellCharacters.Num())
+	{
+		const FIntPoint Cell = CellCharacters[Index].Key;
+		const int32 Start = Characters.Num();
+
+		for(; Index < CellCharacters.Num() && CellCharacters[Index].Key == Cell; Index++)
+		{
+			ACeremonyCharacter* Character = CellCharacters[Index].Value;
+			const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+			AddEntry(Character, Character->GetActorLocation(), Character->GetActorForwardVector(), Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight());
+			MaxCapsuleRadius = FMath::Max(MaxCapsuleRadius, Capsule->GetScaledCapsuleRadius());
+		}
+
+		// Pad so every cell is whole blocks of four.
+		while(Characters.Num() % 4 != 0)
+		{
+			AddEntry(nullptr, FVector(PaddingLocation), FVector::ZeroVector, 0.0f, 0.0f);
+		}
+
+		Cells.Add(Cell, {Start, Characters.Num() - Start});
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyCombatData.h"
+
+#include "Animation/AnimMontage.h"
+
+FVector FCombatNotifyWindow::GetSocketLocation(const float Time) const
+{
+	const float ClampedTime = FMath::Clamp(Time, StartTime, EndTime);
+	return FVector(SocketLocationX.Eval(ClampedTime), SocketLocationY.Eval(ClampedTime), SocketLocationZ.Eval(ClampedTime));
+}
+
+bool UCeremonyCombatData::IsHitValid(const UAnimMontage* Montage, const float Position, const ECeremonyAnimNotifyStateType NotifyStateType,
+                                     const FTransform& ActorTransform, const FVector& ImpactPoint, const float Reach, const float TimeTolerance,
+                                     const float ReachTolerance) const
+{
+	const FMontageCombatData* MontageData = GetMontageData(Montage);
+	if(MontageData == nullptr)
+	{
+		return true;
+	}
+
+	for(const FCombatNotifyWindow& Window : MontageData->Windows)
+	{
+		if(Window.NotifyStateType != NotifyStateType || !Window.ContainsTime(Position, TimeTolerance))
+		{
+			continue;
+		}
+
+		if(!Window.bHasSocketPath)
+		{
+			return true;
+		}
+
+		// The socket moves during the tolerance too; take the closest of the start, middle and end of it.
+		const FVector LocalImpactPoint = ActorTransform.InverseTransformPosition(ImpactPoint);
+		const float MaximumDistanceSquared = FMath::Square(Reach + ReachTolerance);
+		for(const float Offset : {-TimeTolerance, 0.0f, TimeTolerance})
+		{
+			if(FVector::DistSquared(Window.GetSocketLocation(Position + Offset), LocalImpactPoint) <= MaximumDistanceSquared)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+#if WITH_EDITOR
+void UCeremonyCombatData::SetMontages(const TMap<UAnimMontage*, FMontageCombatData>& NewMontages, const float NewSampleRate)
+{
+	Montages = NewMontages;
+	SampleRate = NewSampleRate;
+}
+#endif
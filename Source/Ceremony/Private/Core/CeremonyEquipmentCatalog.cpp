@@ -0,0 +1,205 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyEquipmentCatalog.h"
+
+#include "Engine/AssetManager.h"
+#include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyGameModeBase.h"
+#include "Equipment/EquipmentActor.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/GameStateBase.h"
+
+UCeremonyEquipmentCatalog* UCeremonyEquipmentCatalog::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonyEquipmentCatalog>() : nullptr;
+}
+
+void UCeremonyEquipmentCatalog::BuildCatalog()
+{
+	const UWorld* World = GetWorld();
+
+	// The server knows its game mode while the map loads; clients wait for the game state.
+	const AGameModeBase* GameMode = World->GetAuthGameMode();
+	const AGameStateBase* GameState = World->GetGameState();
+	UClass* GameModeClass = IsValid(GameMode) ? GameMode->GetClass() : IsValid(GameState) ? GameState->GameModeClass : nullptr;
+	if(!IsValid(GameModeClass))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UCeremonyEquipmentCatalog::BuildCatalog: Game state not available yet on %s."), *GetNameSafe(World));
+		return;
+	}
+
+	// Every character class that can spawn contributes its equipment, so each machine gets the same IDs whichever classes are in play.
+	const AGameModeBase* GameModeDefault = GameModeClass->GetDefaultObject<AGameModeBase>();
+	TArray<TSubclassOf<ACeremonyCharacter>> CharacterClasses;
+	if(const ACeremonyGameModeBase* CeremonyGameModeDefault = Cast<ACeremonyGameModeBase>(GameModeDefault))
+	{
+		CeremonyGameModeDefault->GetCharacterClasses(CharacterClasses);
+	}
+	else if(GameModeDefault->DefaultPawnClass.Get() != nullptr && GameModeDefault->DefaultPawnClass->IsChildOf<ACeremonyCharacter>())
+	{
+		CharacterClasses.Add(GameModeDefault->DefaultPawnClass.Get());
+	}
+
+	if(CharacterClasses.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UCeremonyEquipmentCatalog::BuildCatalog: %s has no ceremony character classes."), *GetNameSafe(GameModeDefault));
+		return;
+	}
+
+	TArray<TSoftClassPtr<AEquipmentActor>> GatheredClasses;
+	for(const TSubclassOf<ACeremonyCharacter>& CharacterClass : CharacterClasses)
+	{
+		CharacterClass.GetDefaultObject()->GetEquipmentClasses(GatheredClasses);
+	}
+
+	EquipmentClasses.Reset();
+	for(const TSoftClassPtr<AEquipmentActor>& EquipmentClass : GatheredClasses)
+	{
+		if(!EquipmentClass.IsNull())
+		{
+			EquipmentClasses.AddUnique(EquipmentClass);
+		}
+	}
+
+	// Sort by path rather than load order, which differs between machines, and without loading anything.
+	EquipmentClasses.Sort([](const TSoftClassPtr<AEquipmentActor>& A, const TSoftClassPtr<AEquipmentActor>& B) { return A.ToString() < B.ToString(); });
+	check(EquipmentClasses.Num() < MAX_uint8);
+
+	bIsBuilt = true;
+
+	// Start loading the equipment every character spawns with.
+	TArray<FSoftObjectPath> DefaultClassPaths;
+	for(const TSubclassOf<ACeremonyCharacter>& CharacterClass : CharacterClasses)
+	{
+		const ACeremonyCharacter* CharacterDefault = CharacterClass.GetDefaultObject();
+		for(const TSoftClassPtr<AEquipmentActor>& EquipmentClass : {CharacterDefault->GetRightHandEquipmentDefaultClass(), CharacterDefault->GetLeftHandEquipmentDefaultClass()})
+		{
+			if(!EquipmentClass.IsNull())
+			{
+				DefaultClassPaths.AddUnique(EquipmentClass.ToSoftObjectPath());
+			}
+		}
+	}
+
+	if(DefaultClassPaths.Num() > 0)
+	{
+		PreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(DefaultClassPaths);
+	}
+}
+
+void UCeremonyEquipmentCatalog::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(WorldInitializedActorsHandle);
+
+	if(PreloadHandle.IsValid())
+	{
+		PreloadHandle->ReleaseHandle();
+		PreloadHandle.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+TSubclassOf<AEquipmentActor> UCeremonyEquipmentCatalog::GetEquipmentClass(const uint8 EquipmentId)
+{
+	if(!bIsBuilt)
+	{
+		BuildCatalog();
+	}
+
+	return EquipmentClasses.IsValidIndex(EquipmentId - 1) ? EquipmentClasses[EquipmentId - 1].Get() : nullptr;
+}
+
+uint8 UCeremonyEquipmentCatalog::GetEquipmentId(const TSoftClassPtr<AEquipmentActor>& EquipmentClass)
+{
+	if(EquipmentClass.IsNull())
+	{
+		return 0;
+	}
+
+	if(!bIsBuilt)
+	{
+		BuildCatalog();
+	}
+
+	const int32 Index = EquipmentClasses.IndexOfByKey(EquipmentClass);
+	if(Index == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UCeremonyEquipmentCatalog::GetEquipmentId: Equipment %s is not in the catalog; add it to GetEquipmentClasses of a character class the game mode spawns."), *EquipmentClass.ToString());
+		return 0;
+	}
+
+	return static_cast<uint8>(Index + 1);
+}
+
+int32 UCeremonyEquipmentCatalog::GetNumEquipmentClasses()
+{
+	if(!bIsBuilt)
+	{
+		BuildCatalog();
+	}
+
+	return EquipmentClasses.Num();
+}
+
+void UCeremonyEquipmentCatalog::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldInitializedActorsHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UCeremonyEquipmentCatalog::OnWorldInitializedActors);
+}
+
+bool UCeremonyEquipmentCatalog::IsLoadoutLoaded(const FCeremonyLoadout& Loadout)
+{
+	for(const uint8 EquipmentId : {Loadout.RightHandEquipmentId, Loadout.LeftHandEquipmentId})
+	{
+		if(EquipmentId != 0 && GetEquipmentClass(EquipmentId) == nullptr)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TSharedPtr<FStreamableHandle> UCeremonyEquipmentCatalog::LoadLoadout(const FCeremonyLoadout& Loadout, const FStreamableDelegate Delegate)
+{
+	if(!bIsBuilt)
+	{
+		BuildCatalog();
+	}
+
+	TArray<FSoftObjectPath> ClassPaths;
+	for(const uint8 EquipmentId : {Loadout.RightHandEquipmentId, Loadout.LeftHandEquipmentId})
+	{
+		if(EquipmentClasses.IsValidIndex(EquipmentId - 1))
+		{
+			ClassPaths.Add(EquipmentClasses[EquipmentId - 1].ToSoftObjectPath());
+		}
+	}
+
+	if(ClassPaths.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassPaths, Delegate);
+}
+
+void UCeremonyEquipmentCatalog::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	if(Params.World != GetWorld() || bIsBuilt || Params.World->GetAuthGameMode() == nullptr)
+	{
+		return;
+	}
+
+	BuildCatalog();
+
+	// The map is still loading; finish loading the default loadout now, so the first characters don't spawn empty handed.
+	if(PreloadHandle.IsValid())
+	{
+		PreloadHandle->WaitUntilComplete();
+	}
+}
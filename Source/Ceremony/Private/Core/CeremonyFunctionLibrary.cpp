@@ -2,6 +2,27 @@
 
 #include "Core/CeremonyFunctionLibrary.h"
 
+#include "Engine/Engine.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/World.h"
+
+float UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if(!IsValid(World))
+	{
+		return 0.0f;
+	}
+
+	const AGameStateBase* GameState = World->GetGameState();
+	if(!IsValid(GameState))
+	{
+		return World->GetTimeSeconds();
+	}
+
+	return GameState->GetServerWorldTimeSeconds();
+}
+
 void UCeremonyFunctionLibrary::LogRoleAndMode(APawn* Pawn, const FString InfoString)
 {
 	const ENetMode NetMode = Pawn->GetNetMode();
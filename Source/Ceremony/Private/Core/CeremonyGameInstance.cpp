@@ -2,9 +2,51 @@
 
 #include "Core/CeremonyGameInstance.h"
 
+#include "Character/CeremonyCharacter.h"
+#include "EngineUtils.h"
 #include "GameFramework/PlayerController.h"
 #include "Engine/World.h"
 
+void UCeremonyGameInstance::DumpCharacterCost() const
+{
+	UWorld* World = GetWorld();
+	if(!IsValid(World))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Unable to get world."));
+		return;
+	}
+
+	int32 TotalComponents = 0;
+	int32 TotalTickingComponents = 0;
+	SIZE_T TotalBytes = 0;
+	for(TActorIterator<ACeremonyCharacter> It(World); It; ++It)
+	{
+		ACeremonyCharacter* Character = *It;
+		SIZE_T Bytes = Character->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		int32 TickingComponents = 0;
+
+		TInlineComponentArray<UActorComponent*> Components(Character);
+		for(UActorComponent* Component : Components)
+		{
+			Bytes += Component->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+			if(Component->IsComponentTickEnabled())
+			{
+				TickingComponents++;
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("%s - Components %d, Ticking %d, Estimated %.1f KB."), *GetNameSafe(Character), Components.Num(), TickingComponents,
+			Bytes / 1024.0f);
+
+		TotalComponents += Components.Num();
+		TotalTickingComponents += TickingComponents;
+		TotalBytes += Bytes;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Characters in %s (net mode %d) - Components %d, Ticking %d, Estimated %.1f KB."), *GetNameSafe(World),
+		static_cast<int32>(World->GetNetMode()), TotalComponents, TotalTickingComponents, TotalBytes / 1024.0f);
+}
+
 void UCeremonyGameInstance::Host() const
 {
 	UWorld* World = GetWorld();
@@ -2,58 +2,234 @@
 
 #include "Core/CeremonyGameModeBase.h"
 
+#include "Core/Ceremony.h"
 #include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyCharacterPool.h"
+#include "Core/CeremonyCharacterRegistry.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "TimerManager.h"
 #include "Engine/World.h"
 
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued Respawns"), STAT_QueuedRespawns, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Respawns"), STAT_Respawns, STATGROUP_Ceremony);
+
 ACeremonyGameModeBase::ACeremonyGameModeBase()
 {
-	PrimaryActorTick.bCanEverTick = true;
-	PrimaryActorTick.bStartWithTickEnabled = true;
-	PrimaryActorTick.TickInterval = 1.0f;
+	// Respawns are driven by the death path and a timer.
+	PrimaryActorTick.bCanEverTick = false;
+}
+
+AActor* ACeremonyGameModeBase::ChoosePlayerStart_Implementation(AController* Player)
+{
+	UWorld* World = GetWorld();
+	if(PlayerStarts.Num() == 0)
+	{
+		for(TActorIterator<APlayerStart> It(World); It; ++It)
+		{
+			PlayerStarts.Add(*It);
+			PlayerStartLastUsedTimes.Add(-BIG_NUMBER);
+		}
+	}
+
+	const UCeremonyCharacterRegistry* CharacterRegistry = UCeremonyCharacterRegistry::Get(this);
+	const float Now = World->GetTimeSeconds();
+
+	int32 BestIndex = INDEX_NONE;
+	float BestScore = BIG_NUMBER;
+	TArray<FCeremonyCharacterQueryResult> Results;
+	for(int32 Index = 0; Index < PlayerStarts.Num(); Index++)
+	{
+		const APlayerStart* PlayerStart = PlayerStarts[Index];
+		if(!IsValid(PlayerStart))
+		{
+			continue;
+		}
+
+		// Each live character nearby counts up to one, the closer the more.
+		float Score = 0.0f;
+		if(IsValid(CharacterRegistry) && PlayerStartOccupancyRadius > 0.0f)
+		{
+			Results.Reset();
+			CharacterRegistry->FindCharactersInRadius(PlayerStart->GetActorLocation(), PlayerStartOccupancyRadius, Results);
+			for(const FCeremonyCharacterQueryResult& Result : Results)
+			{
+				if(Result.Character->GetHealth() > 0.0f)
+				{
+					Score += 1.0f - FMath::Sqrt(Result.DistanceSquared) / PlayerStartOccupancyRadius;
+				}
+			}
+		}
+
+		if(Now - PlayerStartLastUsedTimes[Index] < PlayerStartReuseTime)
+		{
+			Score += 1.0f;
+		}
+
+		if(Score < BestScore)
+		{
+			BestScore = Score;
+			BestIndex = Index;
+		}
+	}
+
+	if(BestIndex == INDEX_NONE)
+	{
+		return Super::ChoosePlayerStart_Implementation(Player);
+	}
+
+	PlayerStartLastUsedTimes[BestIndex] = Now;
+	return PlayerStarts[BestIndex];
+}
+
+void ACeremonyGameModeBase::GetCharacterClasses(TArray<TSubclassOf<ACeremonyCharacter>>& OutCharacterClasses) const
+{
+	// Null when the default pawn isn't a ceremony character.
+	const TSubclassOf<ACeremonyCharacter> DefaultCharacterClass = DefaultPawnClass.Get();
+	if(DefaultCharacterClass != nullptr)
+	{
+		OutCharacterClasses.AddUnique(DefaultCharacterClass);
+	}
+
+	for(const TSubclassOf<ACeremonyCharacter>& CharacterClass : AdditionalCharacterClasses)
+	{
+		if(CharacterClass != nullptr)
+		{
+			OutCharacterClasses.AddUnique(CharacterClass);
+		}
+	}
+}
+
+float ACeremonyGameModeBase::GetRespawnDelay(const AController* Controller) const
+{
+	return RespawnDelay;
 }
 
 void ACeremonyGameModeBase::PostLogin(APlayerController* NewPlayer)
 {
 	Super::PostLogin(NewPlayer);
-	
+
 	ACeremonyCharacter* Character = Cast<ACeremonyCharacter>(NewPlayer->GetCharacter());
 	if(IsValid(Character))
 	{
 		// Set the player number, which is replicated so that clients will set colors appropriately.
-		Character->ClientPlayerNumber = GetNumPlayers() % 4;
-
-		// On the server, call OnRep directly to force the server to set colors.
-		if(GetNetMode() == NM_ListenServer)
-		{
-			Character->OnRep_ClientPlayerNumber();	
-		}
+		Character->SetClientPlayerNumber(GetNumPlayers() % 4);
 	}
 }
 
-void ACeremonyGameModeBase::RestartDeadPlayers()
+void ACeremonyGameModeBase::ProcessRespawnQueue()
 {
-	UWorld* World = GetWorld();
-	if(IsValid(World))
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	TArray<FQueuedRespawn> Deferred;
+	int32 Respawned = 0;
+	while(RespawnQueue.Num() > 0 && RespawnQueue.HeapTop().Time <= Now && Respawned < MaxRespawnsPerFrame)
 	{
-		for(FConstPlayerControllerIterator WeakPlayerController = World->GetPlayerControllerIterator(); WeakPlayerController; ++WeakPlayerController)
+		FQueuedRespawn Respawn;
+		RespawnQueue.HeapPop(Respawn, false);
+
+		AController* Controller = Respawn.Controller.Get();
+		if(!IsValid(Controller))
+		{
+			continue;
+		}
+
+		const ACeremonyCharacter* Character = Cast<ACeremonyCharacter>(Controller->GetPawn());
+		if(IsValid(Character))
 		{
-			APlayerController* Controller = WeakPlayerController->Get();
-			if(IsValid(Controller))
+			// The dead character is pooled or destroyed at about the same time; wait for it to be let go.
+			if(Character->GetHealth() == 0.0f)
 			{
-				ACeremonyCharacter* Character = Cast<ACeremonyCharacter>(Controller->GetCharacter());
-				if(!IsValid(Character))
-				{
-					RestartPlayer(Controller);
-				}
+				Deferred.Add(Respawn);
 			}
+
+			continue;
 		}
+
+		RestartPlayer(Controller);
+		INC_DWORD_STAT(STAT_Respawns);
+		Respawned++;
 	}
+
+	for(const FQueuedRespawn& Respawn : Deferred)
+	{
+		RespawnQueue.HeapPush(Respawn);
+	}
+
+	SET_DWORD_STAT(STAT_QueuedRespawns, RespawnQueue.Num());
+	ScheduleRespawnTimer();
 }
 
-void ACeremonyGameModeBase::Tick(const float DeltaSeconds)
+void ACeremonyGameModeBase::QueueRespawn(AController* Controller, const float MinimumDelay)
 {
-	Super::Tick(DeltaSeconds);
+	if(!IsValid(Controller))
+	{
+		return;
+	}
 
-	RestartDeadPlayers();
+	// A player only waits for one respawn.
+	if(RespawnQueue.RemoveAll([Controller](const FQueuedRespawn& Respawn) { return Respawn.Controller.Get() == Controller; }) > 0)
+	{
+		RespawnQueue.Heapify();
+	}
+
+	FQueuedRespawn Respawn;
+	Respawn.Controller = Controller;
+	Respawn.Time = GetWorld()->GetTimeSeconds() + FMath::Max(GetRespawnDelay(Controller), MinimumDelay);
+	RespawnQueue.HeapPush(Respawn);
+
+	SET_DWORD_STAT(STAT_QueuedRespawns, RespawnQueue.Num());
+	ScheduleRespawnTimer();
 }
 
+void ACeremonyGameModeBase::ScheduleRespawnTimer()
+{
+	FTimerManager& TimerManager = GetWorldTimerManager();
+	TimerManager.ClearTimer(RespawnTimerHandle);
+
+	if(RespawnQueue.Num() == 0)
+	{
+		return;
+	}
+
+	const float Delay = RespawnQueue.HeapTop().Time - GetWorld()->GetTimeSeconds();
+	if(Delay > 0.0f)
+	{
+		TimerManager.SetTimer(RespawnTimerHandle, this, &ACeremonyGameModeBase::ProcessRespawnQueue, Delay);
+	}
+	else
+	{
+		RespawnTimerHandle = TimerManager.SetTimerForNextTick(this, &ACeremonyGameModeBase::ProcessRespawnQueue);
+	}
+}
+
+bool ACeremonyGameModeBase::ShouldSpawnAtStartSpot_Implementation(AController* Player)
+{
+	return false;
+}
+
+APawn* ACeremonyGameModeBase::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+	UClass* CharacterClass = GetDefaultPawnClassForController(NewPlayer);
+
+	// The equipment catalog only holds the equipment of the listed classes; anything else spawns empty handed.
+	TArray<TSubclassOf<ACeremonyCharacter>> CharacterClasses;
+	GetCharacterClasses(CharacterClasses);
+	if(!CharacterClasses.Contains(CharacterClass))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ACeremonyGameModeBase::SpawnDefaultPawnAtTransform: %s is not in the character classes of %s; add it to AdditionalCharacterClasses."),
+			*GetNameSafe(CharacterClass), *GetNameSafe(this));
+	}
+
+	UCeremonyCharacterPool* CharacterPool = UCeremonyCharacterPool::Get(this);
+	if(IsValid(CharacterPool))
+	{
+		ACeremonyCharacter* Character = CharacterPool->AcquireCharacter(NewPlayer, CharacterClass, SpawnTransform);
+		if(IsValid(Character))
+		{
+			return Character;
+		}
+	}
+
+	return Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
+}
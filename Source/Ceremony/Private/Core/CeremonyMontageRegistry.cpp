@@ -0,0 +1,106 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyMontageRegistry.h"
+
+#include "Animation/AnimMontage.h"
+#include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyEquipmentCatalog.h"
+#include "Equipment/EquipmentActor.h"
+#include "Equipment/EquipmentStructs.h"
+#include "Engine/World.h"
+
+UCeremonyMontageRegistry* UCeremonyMontageRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonyMontageRegistry>() : nullptr;
+}
+
+const FCeremonyMontageSection* UCeremonyMontageRegistry::FindOrBuildSection(const uint8 Section, const ACeremonyCharacter* Character)
+{
+	if(!IsValid(Character))
+	{
+		return nullptr;
+	}
+
+	UClass* CharacterClass = Character->GetClass();
+	const FCeremonyMontageSection* ExistingSection = Section == 0 ? CharacterSections.Find(CharacterClass) : EquipmentSections.Find(Section);
+	if(ExistingSection != nullptr)
+	{
+		return ExistingSection;
+	}
+
+	TArray<UAnimMontage*> GatheredMontages;
+	if(Section == 0)
+	{
+		// Every machine has the class of a character it can see, so its montages can always be registered.
+		CharacterClass->GetDefaultObject<ACeremonyCharacter>()->GetMontages(GatheredMontages);
+	}
+	else
+	{
+		// Equipment that hasn't streamed in yet is built once it's loaded.
+		UCeremonyEquipmentCatalog* EquipmentCatalog = UCeremonyEquipmentCatalog::Get(this);
+		const TSubclassOf<AEquipmentActor> EquipmentClass = IsValid(EquipmentCatalog) ? EquipmentCatalog->GetEquipmentClass(Section) : nullptr;
+		const AEquipmentActor* EquipmentDefault = EquipmentClass.GetDefaultObject();
+		if(!IsValid(EquipmentDefault))
+		{
+			return nullptr;
+		}
+
+		EquipmentDefault->GetMontages(GatheredMontages);
+	}
+
+	FCeremonyMontageSection& NewSection = Section == 0 ? CharacterSections.Add(CharacterClass) : EquipmentSections.Add(Section);
+	for(UAnimMontage* Montage : GatheredMontages)
+	{
+		if(IsValid(Montage))
+		{
+			NewSection.Montages.AddUnique(Montage);
+		}
+	}
+
+	// Load order differs between machines; the path doesn't.
+	NewSection.Montages.Sort([](const UAnimMontage& A, const UAnimMontage& B) { return A.GetPathName() < B.GetPathName(); });
+	check(NewSection.Montages.Num() < MAX_uint8);
+
+	return &NewSection;
+}
+
+UAnimMontage* UCeremonyMontageRegistry::GetMontage(const uint16 MontageId, const ACeremonyCharacter* Character)
+{
+	if(MontageId == 0)
+	{
+		return nullptr;
+	}
+
+	const FCeremonyMontageSection* Section = FindOrBuildSection(static_cast<uint8>(MontageId >> 8), Character);
+	const int32 Index = (MontageId & 0xFF) - 1;
+	return Section != nullptr && Section->Montages.IsValidIndex(Index) ? Section->Montages[Index] : nullptr;
+}
+
+uint16 UCeremonyMontageRegistry::GetMontageId(const UAnimMontage* Montage, const ACeremonyCharacter* Character)
+{
+	if(Montage == nullptr || !IsValid(Character))
+	{
+		return 0;
+	}
+
+	// Search in a fixed order, so every machine picks the same section for a montage that's in several.
+	const FCeremonyLoadout& Loadout = Character->GetLoadout();
+	for(const uint8 SectionIndex : {static_cast<uint8>(0), Loadout.RightHandEquipmentId, Loadout.LeftHandEquipmentId})
+	{
+		const FCeremonyMontageSection* Section = FindOrBuildSection(SectionIndex, Character);
+		const int32 Index = Section != nullptr ? Section->Montages.IndexOfByKey(Montage) : INDEX_NONE;
+		if(Index != INDEX_NONE)
+		{
+			return static_cast<uint16>(SectionIndex << 8 | (Index + 1));
+		}
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("UCeremonyMontageRegistry::GetMontageId: Montage %s is not registered for %s or its equipment; add it to GetMontages on its owner."), *GetNameSafe(Montage), *GetNameSafe(Character));
+	return 0;
+}
+
+bool UCeremonyMontageRegistry::IsValidMontageId(const uint16 MontageId, const ACeremonyCharacter* Character)
+{
+	return MontageId == 0 || IsValid(GetMontage(MontageId, Character));
+}
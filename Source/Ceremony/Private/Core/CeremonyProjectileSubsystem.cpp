@@ -0,0 +1,281 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyProjectileSubsystem.h"
+
+#include "Core/Ceremony.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Equipment/ProjectileActor.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Update"), STAT_ProjectileUpdate, STATGROUP_Ceremony);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles In Flight"), STAT_ProjectilesInFlight, STATGROUP_Ceremony);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles Stuck"), STAT_ProjectilesStuck, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Sweeps Submitted"), STAT_ProjectileSweepsSubmitted, STATGROUP_Ceremony);
+
+UCeremonyProjectileSubsystem* UCeremonyProjectileSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonyProjectileSubsystem>() : nullptr;
+}
+
+void UCeremonyProjectileSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Positions.Empty();
+	Velocities.Empty();
+	NextPositions.Empty();
+	GravityAccelerations.Empty();
+	ExpireTimes.Empty();
+	TypeIndices.Empty();
+	Owners.Empty();
+	SweepHandles.Empty();
+	StuckProjectiles.Empty();
+	ProjectileTypes.Empty();
+	InstancesActor = nullptr;
+
+	SET_DWORD_STAT(STAT_ProjectilesInFlight, 0);
+	SET_DWORD_STAT(STAT_ProjectilesStuck, 0);
+
+	Super::Deinitialize();
+}
+
+int32 UCeremonyProjectileSubsystem::FindOrAddProjectileType(UClass* ProjectileClass)
+{
+	const int32 ExistingIndex = ProjectileTypes.IndexOfByPredicate([ProjectileClass](const FCeremonyProjectileType& Type) { return Type.ProjectileClass == ProjectileClass; });
+	if(ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	const AProjectileActor* ProjectileDefault = ProjectileClass->GetDefaultObject<AProjectileActor>();
+	const UStaticMeshComponent* MeshComponent = ProjectileDefault->GetStaticMeshComponent();
+
+	FCeremonyProjectileType Type;
+	Type.ProjectileClass = ProjectileClass;
+	Type.MeshTransform = MeshComponent->GetRelativeTransform();
+	Type.CollisionRadius = ProjectileDefault->GetCollisionRadius();
+	Type.GravityScale = ProjectileDefault->GetGravityScale();
+	Type.InitialSpeed = ProjectileDefault->GetInitialSpeed();
+	Type.MaxFlightTime = ProjectileDefault->GetMaxFlightTime();
+	Type.StuckLifeSpan = ProjectileDefault->GetStuckLifeSpan();
+
+	UWorld* World = GetWorld();
+	if(!IsValid(InstancesActor))
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		InstancesActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+		USceneComponent* RootComponent = NewObject<USceneComponent>(InstancesActor, TEXT("RootComponent"));
+		InstancesActor->SetRootComponent(RootComponent);
+		RootComponent->RegisterComponent();
+	}
+
+	// The instances are placed in world space, so the component stays at the origin.
+	Type.Instances = NewObject<UInstancedStaticMeshComponent>(InstancesActor);
+	Type.Instances->SetMobility(EComponentMobility::Movable);
+	Type.Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Type.Instances->SetGenerateOverlapEvents(false);
+	Type.Instances->SetCanEverAffectNavigation(false);
+	Type.Instances->SetStaticMesh(MeshComponent->GetStaticMesh());
+	Type.Instances->OverrideMaterials = MeshComponent->OverrideMaterials;
+	Type.Instances->SetupAttachment(InstancesActor->GetRootComponent());
+	Type.Instances->RegisterComponent();
+
+	return ProjectileTypes.Add(Type);
+}
+
+void UCeremonyProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCeremonyProjectileSubsystem::UpdateProjectiles);
+}
+
+void UCeremonyProjectileSubsystem::LaunchProjectile(const TSubclassOf<AProjectileActor> ProjectileClass, AActor* Owner, const FVector& Location, const FRotator& Rotation)
+{
+	// Projectiles are cosmetic, and hits are detected by the owning client; a dedicated server has nothing to draw.
+	UWorld* World = GetWorld();
+	if(ProjectileClass == nullptr || !IsValid(World) || World->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	const int32 TypeIndex = FindOrAddProjectileType(ProjectileClass);
+	const FCeremonyProjectileType& Type = ProjectileTypes[TypeIndex];
+
+	Positions.Add(Location);
+	Velocities.Add(Rotation.Vector() * Type.InitialSpeed);
+	NextPositions.Add(Location);
+	GravityAccelerations.Add(World->GetGravityZ() * Type.GravityScale);
+	ExpireTimes.Add(World->GetTimeSeconds() + Type.MaxFlightTime);
+	TypeIndices.Add(TypeIndex);
+	Owners.Add(Owner);
+	SweepHandles.AddDefaulted();
+
+	SET_DWORD_STAT(STAT_ProjectilesInFlight, Positions.Num());
+}
+
+void UCeremonyProjectileSubsystem::RemoveProjectileAtSwap(const int32 Index)
+{
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	NextPositions.RemoveAtSwap(Index, 1, false);
+	GravityAccelerations.RemoveAtSwap(Index, 1, false);
+	ExpireTimes.RemoveAtSwap(Index, 1, false);
+	TypeIndices.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+	SweepHandles.RemoveAtSwap(Index, 1, false);
+}
+
+void UCeremonyProjectileSubsystem::UpdateInstances()
+{
+	for(FCeremonyProjectileType& Type : ProjectileTypes)
+	{
+		Type.InstanceTransforms.Reset();
+	}
+
+	for(int32 Index = 0; Index < Positions.Num(); Index++)
+	{
+		FCeremonyProjectileType& Type = ProjectileTypes[TypeIndices[Index]];
+		Type.InstanceTransforms.Add(Type.MeshTransform * FTransform(Velocities[Index].Rotation(), Positions[Index]));
+	}
+
+	for(const FStuckProjectile& Stuck : StuckProjectiles)
+	{
+		const USceneComponent* AttachComponent = Stuck.AttachComponent.Get();
+		const FTransform Transform = IsValid(AttachComponent) ? Stuck.Transform * AttachComponent->GetComponentTransform() : Stuck.Transform;
+
+		FCeremonyProjectileType& Type = ProjectileTypes[Stuck.TypeIndex];
+		Type.InstanceTransforms.Add(Type.MeshTransform * Transform);
+	}
+
+	for(FCeremonyProjectileType& Type : ProjectileTypes)
+	{
+		UInstancedStaticMeshComponent* Instances = Type.Instances;
+		if(!IsValid(Instances))
+		{
+			continue;
+		}
+
+		// Instances are only added and removed as volleys start and end; the rest of the time they're moved in one batch.
+		const int32 NumInstances = Instances->GetInstanceCount();
+		const int32 NumProjectiles = Type.InstanceTransforms.Num();
+		for(int32 InstanceIndex = NumInstances; InstanceIndex < NumProjectiles; InstanceIndex++)
+		{
+			Instances->AddInstance(FTransform::Identity);
+		}
+
+		for(int32 InstanceIndex = NumInstances - 1; InstanceIndex >= NumProjectiles; InstanceIndex--)
+		{
+			Instances->RemoveInstance(InstanceIndex);
+		}
+
+		if(NumProjectiles > 0)
+		{
+			Instances->BatchUpdateInstancesTransforms(0, Type.InstanceTransforms, true, true, true);
+		}
+	}
+}
+
+void UCeremonyProjectileSubsystem::UpdateProjectiles(UWorld* World, ELevelTick TickType, const float DeltaSeconds)
+{
+	if(World != GetWorld() || !IsValid(InstancesActor))
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileUpdate);
+
+	const float Now = World->GetTimeSeconds();
+
+	// A projectile only moves along the sweep submitted last frame once it's come back clear; one that hit sticks where it hit. A sweep without
+	// results leaves the projectile at its last confirmed position, and the next sweep starts from there.
+	for(int32 Index = Positions.Num() - 1; Index >= 0; Index--)
+	{
+		FTraceDatum SweepData;
+		if(!SweepHandles[Index].IsValid() || !World->QueryTraceData(SweepHandles[Index], SweepData))
+		{
+			continue;
+		}
+
+		const FHitResult* Hit = SweepData.OutHits.FindByPredicate([](const FHitResult& Result) { return Result.bBlockingHit; });
+		if(Hit == nullptr)
+		{
+			Positions[Index] = NextPositions[Index];
+			continue;
+		}
+
+		const FCeremonyProjectileType& Type = ProjectileTypes[TypeIndices[Index]];
+		const FTransform Transform(Velocities[Index].Rotation(), Hit->Location);
+
+		FStuckProjectile Stuck;
+		Stuck.TypeIndex = TypeIndices[Index];
+		Stuck.ExpireTime = Now + Type.StuckLifeSpan;
+
+		// Stick to characters and anything else that moves.
+		USceneComponent* HitComponent = Hit->GetComponent();
+		if(IsValid(HitComponent) && HitComponent->Mobility == EComponentMobility::Movable)
+		{
+			Stuck.AttachComponent = HitComponent;
+			Stuck.Transform = Transform.GetRelativeTransform(HitComponent->GetComponentTransform());
+		}
+		else
+		{
+			Stuck.Transform = Transform;
+		}
+
+		StuckProjectiles.Add(Stuck);
+		RemoveProjectileAtSwap(Index);
+	}
+
+	for(int32 Index = Positions.Num() - 1; Index >= 0; Index--)
+	{
+		if(ExpireTimes[Index] <= Now)
+		{
+			RemoveProjectileAtSwap(Index);
+		}
+	}
+
+	StuckProjectiles.RemoveAllSwap([Now](const FStuckProjectile& Stuck) { return Stuck.ExpireTime <= Now || Stuck.AttachComponent.IsStale(); }, false);
+
+	// Integrate every projectile in flight in one pass over the arrays. The flight continues from the last integrated position, which is the
+	// confirmed position unless a sweep is still outstanding, so an unconfirmed step doesn't bend the trajectory.
+	const int32 NumProjectiles = Positions.Num();
+	FVector* RESTRICT Velocity = Velocities.GetData();
+	FVector* RESTRICT NextPosition = NextPositions.GetData();
+	const float* RESTRICT GravityAcceleration = GravityAccelerations.GetData();
+	for(int32 Index = 0; Index < NumProjectiles; Index++)
+	{
+		Velocity[Index].Z += GravityAcceleration[Index] * DeltaSeconds;
+		NextPosition[Index] += Velocity[Index] * DeltaSeconds;
+	}
+
+	// Sweep every projectile from its confirmed position to its next position in one batch, covering any step that wasn't confirmed; the
+	// results are read next frame.
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(CeremonyProjectileSweep), false);
+	for(int32 Index = 0; Index < NumProjectiles; Index++)
+	{
+		Params.ClearIgnoredActors();
+		const AActor* Owner = Owners[Index].Get();
+		if(IsValid(Owner))
+		{
+			Params.AddIgnoredActor(Owner);
+		}
+
+		const FCollisionShape Shape = FCollisionShape::MakeSphere(ProjectileTypes[TypeIndices[Index]].CollisionRadius);
+		SweepHandles[Index] = World->AsyncSweepByObjectType(EAsyncTraceType::Single, Positions[Index], NextPositions[Index], FQuat::Identity,
+			ObjectQueryParams, Shape, Params);
+	}
+
+	INC_DWORD_STAT_BY(STAT_ProjectileSweepsSubmitted, NumProjectiles);
+	SET_DWORD_STAT(STAT_ProjectilesInFlight, NumProjectiles);
+	SET_DWORD_STAT(STAT_ProjectilesStuck, StuckProjectiles.Num());
+
+	UpdateInstances();
+}
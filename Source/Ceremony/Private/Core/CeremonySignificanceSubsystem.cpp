@@ -0,0 +1,188 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonySignificanceSubsystem.h"
+
+#include "Core/Ceremony.h"
+#include "Character/CeremonyCharacter.h"
+#include "GameFramework/PlayerController.h"
+#include "SignificanceManager.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Changes"), STAT_SignificanceChanges, STATGROUP_Ceremony);
+
+static TAutoConsoleVariable<int32> CVarSignificanceEnabled(
+	TEXT("Ceremony.Significance.Enabled"), 1,
+	TEXT("Whether character significance reduces IK, animation, widget and footstep cost. When 0 every character is at the highest significance."));
+
+static TAutoConsoleVariable<float> CVarSignificanceNearDistance(
+	TEXT("Ceremony.Significance.NearDistance"), 1500.0f,
+	TEXT("Distance from a viewpoint within which on screen characters are at high significance, and off screen characters at medium."));
+
+static TAutoConsoleVariable<float> CVarSignificanceFarDistance(
+	TEXT("Ceremony.Significance.FarDistance"), 4000.0f,
+	TEXT("Distance from a viewpoint within which on screen characters are at medium significance; beyond it they're at low."));
+
+static TAutoConsoleVariable<float> CVarSignificanceViewDotProduct(
+	TEXT("Ceremony.Significance.ViewDotProduct"), 0.5f,
+	TEXT("Minimum dot product between the view direction and the direction to a character for it to count as on screen."));
+
+static TAutoConsoleVariable<float> CVarSignificanceMediumIKInterval(
+	TEXT("Ceremony.Significance.MediumIKInterval"), 0.1f,
+	TEXT("Interval between IK foot traces, in seconds, for characters at medium significance. Feet aren't traced at low significance."));
+
+static TAutoConsoleVariable<int32> CVarSignificanceMediumAnimationFrameSkip(
+	TEXT("Ceremony.Significance.MediumAnimationFrameSkip"), 1,
+	TEXT("Animation frames skipped between updates for characters at medium significance."));
+
+static TAutoConsoleVariable<int32> CVarSignificanceLowAnimationFrameSkip(
+	TEXT("Ceremony.Significance.LowAnimationFrameSkip"), 3,
+	TEXT("Animation frames skipped between updates for characters at low significance."));
+
+// Tag characters are registered with the significance manager under.
+static const FName CharacterSignificanceTag = TEXT("CeremonyCharacter");
+
+UCeremonySignificanceSubsystem* UCeremonySignificanceSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonySignificanceSubsystem>() : nullptr;
+}
+
+float UCeremonySignificanceSubsystem::CalculateSignificance(const ACeremonyCharacter* Character, const FTransform& Viewpoint)
+{
+	if(CVarSignificanceEnabled.GetValueOnGameThread() == 0 || Character->IsLocallyControlled() || Character->GetOpponentHasLockedOn())
+	{
+		return static_cast<float>(ECeremonySignificance::Highest);
+	}
+
+	const FVector ToCharacter = Character->GetActorLocation() - Viewpoint.GetLocation();
+	const float DistanceSquared = ToCharacter.SizeSquared();
+	const bool bIsOnScreen = FVector::DotProduct(Viewpoint.GetRotation().GetForwardVector(), ToCharacter.GetSafeNormal()) >=
+		CVarSignificanceViewDotProduct.GetValueOnGameThread();
+
+	ECeremonySignificance Significance = ECeremonySignificance::Low;
+	if(DistanceSquared <= FMath::Square(CVarSignificanceNearDistance.GetValueOnGameThread()))
+	{
+		Significance = bIsOnScreen ? ECeremonySignificance::High : ECeremonySignificance::Medium;
+	}
+	else if(bIsOnScreen && DistanceSquared <= FMath::Square(CVarSignificanceFarDistance.GetValueOnGameThread()))
+	{
+		Significance = ECeremonySignificance::Medium;
+	}
+
+	return static_cast<float>(Significance);
+}
+
+void UCeremonySignificanceSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Viewpoints.Empty();
+
+	Super::Deinitialize();
+}
+
+int32 UCeremonySignificanceSubsystem::GetAnimationFrameSkip(const ECeremonySignificance Significance)
+{
+	switch(Significance)
+	{
+	case ECeremonySignificance::Low:
+		return FMath::Max(CVarSignificanceLowAnimationFrameSkip.GetValueOnGameThread(), 0);
+	case ECeremonySignificance::Medium:
+		return FMath::Max(CVarSignificanceMediumAnimationFrameSkip.GetValueOnGameThread(), 0);
+	default:
+		return 0;
+	}
+}
+
+float UCeremonySignificanceSubsystem::GetInverseKinematicsTraceInterval(const ECeremonySignificance Significance)
+{
+	switch(Significance)
+	{
+	case ECeremonySignificance::Low:
+		return -1.0f;
+	case ECeremonySignificance::Medium:
+		return FMath::Max(CVarSignificanceMediumIKInterval.GetValueOnGameThread(), 0.0f);
+	default:
+		return 0.0f;
+	}
+}
+
+void UCeremonySignificanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCeremonySignificanceSubsystem::UpdateSignificance);
+}
+
+void UCeremonySignificanceSubsystem::RegisterCharacter(ACeremonyCharacter* Character) const
+{
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	if(SignificanceManager == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No significance manager for %s; it will stay at the highest significance."), *GetNameSafe(Character));
+		return;
+	}
+
+	auto SignificanceFunction = [](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+	{
+		const ACeremonyCharacter* ManagedCharacter = Cast<ACeremonyCharacter>(ObjectInfo->GetObject());
+		return IsValid(ManagedCharacter) ? CalculateSignificance(ManagedCharacter, Viewpoint) : 0.0f;
+	};
+
+	auto PostSignificanceFunction = [](USignificanceManager::FManagedObjectInfo* ObjectInfo, const float OldSignificance, const float Significance,
+		bool bFinal)
+	{
+		// Compare against the character rather than the old value, as the first update has nothing to compare to.
+		ACeremonyCharacter* ManagedCharacter = Cast<ACeremonyCharacter>(ObjectInfo->GetObject());
+		const ECeremonySignificance NewSignificance = static_cast<ECeremonySignificance>(FMath::RoundToInt(Significance));
+		if(IsValid(ManagedCharacter) && ManagedCharacter->GetSignificance() != NewSignificance)
+		{
+			INC_DWORD_STAT(STAT_SignificanceChanges);
+			ManagedCharacter->SetSignificance(NewSignificance);
+		}
+	};
+
+	SignificanceManager->RegisterObject(Character, CharacterSignificanceTag, SignificanceFunction, USignificanceManager::EPostSignificanceType::Sequential,
+		PostSignificanceFunction);
+}
+
+void UCeremonySignificanceSubsystem::UnregisterCharacter(ACeremonyCharacter* Character) const
+{
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	if(SignificanceManager != nullptr && SignificanceManager->GetManagedObject(Character) != nullptr)
+	{
+		SignificanceManager->UnregisterObject(Character);
+	}
+}
+
+void UCeremonySignificanceSubsystem::UpdateSignificance(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if(World != GetWorld())
+	{
+		return;
+	}
+
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(World);
+	if(SignificanceManager == nullptr)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	Viewpoints.Reset();
+	for(FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if(IsValid(PlayerController) && PlayerController->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			Viewpoints.Emplace(ViewRotation, ViewLocation);
+		}
+	}
+
+	SignificanceManager->Update(Viewpoints);
+}
@@ -0,0 +1,123 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Core/CeremonyTraceSubsystem.h"
+
+#include "Core/Ceremony.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Trace Batch Submit"), STAT_TraceBatchSubmit, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Line Traces Submitted"), STAT_AsyncLineTracesSubmitted, STATGROUP_Ceremony);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Overlaps Submitted"), STAT_AsyncOverlapsSubmitted, STATGROUP_Ceremony);
+
+UCeremonyTraceSubsystem* UCeremonyTraceSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	return IsValid(World) ? World->GetSubsystem<UCeremonyTraceSubsystem>() : nullptr;
+}
+
+void UCeremonyTraceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	AsyncLineTraceDelegate.BindUObject(this, &UCeremonyTraceSubsystem::OnAsyncLineTraceComplete);
+	AsyncOverlapDelegate.BindUObject(this, &UCeremonyTraceSubsystem::OnAsyncOverlapComplete);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCeremonyTraceSubsystem::SubmitPendingRequests);
+}
+
+void UCeremonyTraceSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	PendingLineTraces.Empty();
+	PendingOverlaps.Empty();
+	LineTraceCallbacks.Empty();
+	OverlapCallbacks.Empty();
+
+	Super::Deinitialize();
+}
+
+void UCeremonyTraceSubsystem::CancelRequest(const uint32 RequestId)
+{
+	// A request not yet submitted is skipped when the batch is submitted; one already in flight completes, but with no callback the result is dropped.
+	LineTraceCallbacks.Remove(RequestId);
+	OverlapCallbacks.Remove(RequestId);
+}
+
+uint32 UCeremonyTraceSubsystem::RequestLineTrace(const FVector& Start, const FVector& End, const ECollisionChannel TraceChannel,
+                                                 const FCollisionQueryParams& Params, FOnCeremonyLineTraceComplete Callback)
+{
+	const uint32 RequestId = ++LastRequestId;
+
+	PendingLineTraces.Add({RequestId, Start, End, TraceChannel, Params});
+	LineTraceCallbacks.Add(RequestId, MoveTemp(Callback));
+
+	return RequestId;
+}
+
+uint32 UCeremonyTraceSubsystem::RequestOverlap(const FVector& Location, const FCollisionShape& Shape, const FCollisionObjectQueryParams& ObjectQueryParams,
+                                               const FCollisionQueryParams& Params, FOnCeremonyOverlapComplete Callback)
+{
+	const uint32 RequestId = ++LastRequestId;
+
+	PendingOverlaps.Add({RequestId, Location, Shape, ObjectQueryParams, Params});
+	OverlapCallbacks.Add(RequestId, MoveTemp(Callback));
+
+	return RequestId;
+}
+
+void UCeremonyTraceSubsystem::SubmitPendingRequests(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if(World != GetWorld())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TraceBatchSubmit);
+
+	for(const FPendingLineTrace& Trace : PendingLineTraces)
+	{
+		if(LineTraceCallbacks.Contains(Trace.RequestId))
+		{
+			World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Trace.Start, Trace.End, Trace.TraceChannel, Trace.Params,
+				FCollisionResponseParams::DefaultResponseParam, &AsyncLineTraceDelegate, Trace.RequestId);
+			INC_DWORD_STAT(STAT_AsyncLineTracesSubmitted);
+		}
+	}
+
+	for(const FPendingOverlap& Overlap : PendingOverlaps)
+	{
+		if(OverlapCallbacks.Contains(Overlap.RequestId))
+		{
+			World->AsyncOverlapByObjectType(Overlap.Location, FQuat::Identity, Overlap.ObjectQueryParams, Overlap.Shape, Overlap.Params,
+				&AsyncOverlapDelegate, Overlap.RequestId);
+			INC_DWORD_STAT(STAT_AsyncOverlapsSubmitted);
+		}
+	}
+
+	PendingLineTraces.Reset();
+	PendingOverlaps.Reset();
+}
+
+void UCeremonyTraceSubsystem::OnAsyncLineTraceComplete(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	FOnCeremonyLineTraceComplete Callback;
+	if(!LineTraceCallbacks.RemoveAndCopyValue(Datum.UserData, Callback))
+	{
+		return;
+	}
+
+	const bool bHit = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit;
+	Callback.ExecuteIfBound(bHit, bHit ? Datum.OutHits[0] : FHitResult());
+}
+
+void UCeremonyTraceSubsystem::OnAsyncOverlapComplete(const FTraceHandle& Handle, FOverlapDatum& Datum)
+{
+	FOnCeremonyOverlapComplete Callback;
+	if(!OverlapCallbacks.RemoveAndCopyValue(Datum.UserData, Callback))
+	{
+		return;
+	}
+
+	Callback.ExecuteIfBound(Datum.OutOverlaps);
+}
@@ -3,29 +3,29 @@
 #include "Equipment/EquipmentActor.h"
 
 #include "Character/CeremonyCharacter.h"
-#include "Net/UnrealNetwork.h"
 
 AEquipmentActor::AEquipmentActor()
 {
 	PrimaryActorTick.bCanEverTick = false;
 	PrimaryActorTick.bStartWithTickEnabled = false;
 
-	// Replicate equipment spawned on the server to clients.
-	SetReplicates(true);
+	// Spawned locally on every machine from the owner's loadout.
+	SetReplicates(false);
 }
 
 void AEquipmentActor::BeginPlay()
 {
 	Super::BeginPlay();
 
-	OwnerCharacter = Cast<ACeremonyCharacter>(GetOwner());	
+	OwnerCharacter = Cast<ACeremonyCharacter>(GetOwner());
+
+	AttackDefinitions.Reset();
+	BuildAttackDefinitions();
 }
 
-void AEquipmentActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+uint8 AEquipmentActor::AddAttackDefinition(const FDamageParams& DamageParams, const bool bIsCharged, const ESpecialAttackType SpecialAttackType)
 {
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-
-	// Replicate the equipment state to owning client.
-	DOREPLIFETIME_CONDITION(AEquipmentActor, EquipmentState, COND_OwnerOnly);
+	check(AttackDefinitions.Num() <= MAX_uint8);
+	
+	return static_cast<uint8>(AttackDefinitions.Emplace(DamageParams, bIsCharged, SpecialAttackType));
 }
-
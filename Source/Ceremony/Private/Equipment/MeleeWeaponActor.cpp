@@ -3,10 +3,12 @@
 #include "Equipment/MeleeWeaponActor.h"
 
 #include "Components/ArrowComponent.h"
-#include "Components/CapsuleComponent.h"
 #include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyCharacterRegistry.h"
+#include "Core/CeremonyFunctionLibrary.h"
 #include "Character/CeremonyMovementComponent.h"
 #include "DrawDebugHelpers.h"
+#include "Character/HitboxComponent.h"
 #include "Components/StaticMeshComponent.h"
 #include "TimerManager.h"
 
@@ -24,12 +26,10 @@ AMeleeWeaponActor::AMeleeWeaponActor()
 	StaticMeshComponent->SetGenerateOverlapEvents(false);
 	StaticMeshComponent->SetCollisionProfileName(TEXT("NoCollision"));
 	
-	CapsuleComponent = CreateDefaultSubobject<UCapsuleComponent>(TEXT("CapsuleComponent"));
-	CapsuleComponent->SetCollisionProfileName("OverlapOnlyPawn");
-	CapsuleComponent->SetGenerateOverlapEvents(false);
+	CapsuleComponent = CreateDefaultSubobject<UHitboxComponent>(TEXT("CapsuleComponent"));
 	CapsuleComponent->SetCapsuleRadius(3.0f);
 	CapsuleComponent->SetCapsuleHalfHeight(48.0f);
-	CapsuleComponent->OnComponentBeginOverlap.AddDynamic(this, &AMeleeWeaponActor::OnCapsuleComponentOverlap);
+	CapsuleComponent->OnHitboxHit.BindUObject(this, &AMeleeWeaponActor::OnHitboxHit);
 	CapsuleComponent->SetupAttachment(StaticMeshComponent);
 }
 
@@ -55,7 +55,7 @@ void AMeleeWeaponActor::CancelActions()
 		Press2FullyChargedTimerHandle.Invalidate();
 	}
 	
-	CapsuleComponent->SetGenerateOverlapEvents(false);
+	CapsuleComponent->SetCanHit(false);
 	
 	bPress1IsAttacking = false;
 	bPress1QueueNextAttack = false;
@@ -75,6 +75,45 @@ void AMeleeWeaponActor::ShowCollision(const bool bShow)
 
 #pragma region Attack
 
+void AMeleeWeaponActor::BuildAttackDefinitions()
+{
+	for(const FStandardAttackParams& AttackParams : Press1AttackParams)
+	{
+		AddAttackDefinition(AttackParams.DamageParams);
+	}
+
+	Press1RunningAttackId = AddAttackDefinition(Press1RunningAttackParams.DamageParams);
+	Press2AttackId = AddAttackDefinition(Press2AttackParams.DamageParams, true);
+	Press2JumpingAttackId = AddAttackDefinition(Press2JumpingAttackParams.DamageParams);
+
+	if(Press1AttackParams.Num() > 0)
+	{
+		BackStabAttackId = AddAttackDefinition(Press1AttackParams[0].DamageParams, false, ESpecialAttackType::BackStab);
+		RiposteAttackId = AddAttackDefinition(Press1AttackParams[0].DamageParams, false, ESpecialAttackType::Riposte);
+	}
+}
+
+void AMeleeWeaponActor::GetMontages(TArray<UAnimMontage*>& OutMontages) const
+{
+	for(const FStandardAttackParams& AttackParams : Press1AttackParams)
+	{
+		OutMontages.Add(AttackParams.Montage);
+	}
+
+	OutMontages.Add(Press1RunningAttackParams.Montage);
+	OutMontages.Add(Press2AttackParams.AttackMontage);
+	OutMontages.Add(Press2AttackParams.ChargeMontage);
+	OutMontages.Add(Press2JumpingAttackParams.Montage);
+	OutMontages.Add(BackStabMontage);
+	OutMontages.Add(RiposteMontage);
+}
+
+float AMeleeWeaponActor::GetReach() const
+{
+	// The actor is attached at the hand; the capsule lies along its up axis.
+	return FVector::Dist(GetActorLocation(), CapsuleComponent->GetComponentLocation()) + CapsuleComponent->GetScaledCapsuleHalfHeight();
+}
+
 void AMeleeWeaponActor::CheckForAttackTransition()
 {
 	// If the next attack is queued, transition to it.
@@ -95,11 +134,9 @@ void AMeleeWeaponActor::CheckForAttackTransition()
 			Press1CurrentAttack = 0;
 		}
 
-		// Set up damage in case a hit occurs.
-		DamageEnduranceDamageStunTime = FVector(Press1AttackParams[Press1CurrentAttack].DamageParams.DamageStandard,
-			Press1AttackParams[Press1CurrentAttack].DamageParams.EnduranceDamageStandard,
-				Press1AttackParams[Press1CurrentAttack].DamageParams.StunTime);
-		DamageType = static_cast<uint8>(Press1AttackParams[Press1CurrentAttack].DamageParams.DamageType);
+		// Set up the attack in case a hit occurs.
+		ActiveAttackId = static_cast<uint8>(Press1CurrentAttack);
+		ActiveCharge = 0;
 		
 		// Play the next attack and jump to the active section.
 		OwnerCharacter->DepleteEndurance(Press1AttackParams[Press1CurrentAttack].EnduranceConsumption);
@@ -142,6 +179,10 @@ void AMeleeWeaponActor::OnAttackMontageEnded(UAnimMontage* Montage, const bool b
 				Press1CurrentAttack = 0;
 			}
 
+			// Set up the attack in case a hit occurs.
+			ActiveAttackId = static_cast<uint8>(Press1CurrentAttack);
+			ActiveCharge = 0;
+			
 			// Play the next attack.
 			OwnerCharacter->DepleteEndurance(Press1AttackParams[Press1CurrentAttack].EnduranceConsumption);
 			OwnerCharacter->PlayMontageGlobally(Press1AttackParams[Press1CurrentAttack].Montage);
@@ -173,71 +214,32 @@ void AMeleeWeaponActor::OnAttackMontageEnded(UAnimMontage* Montage, const bool b
 	}
 }
 
-void AMeleeWeaponActor::OnCapsuleComponentOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AMeleeWeaponActor::OnHitboxHit(const FHitResult& Hit)
 {
-	// Prevent hitting a character more than once with the same attack.
-	if(DamagedActors.Contains(OtherActor))
+	if(!IsValid(OwnerCharacter))
 	{
 		return;
 	}
 
-	const UWorld* World = GetWorld();
-	if(!IsValid(World) || !IsValid(OwnerCharacter))
+	if(OwnerCharacter->IsShowingDebugCollision())
 	{
-		return;
+		const UWorld* World = GetWorld();
+		DrawDebugCapsule(World, Hit.Location, CapsuleComponent->GetScaledCapsuleHalfHeight(),
+		                 CapsuleComponent->GetScaledCapsuleRadius(),
+		                 CapsuleComponent->GetComponentRotation().Quaternion(), FColor::Red, false, 3.0f, 0, 0);
+		
+		DrawDebugSphere(World, Hit.ImpactPoint, 3.0f, 8, FColor::Red, false, 3.0f, 0, 1);
 	}
 
-	// They have overlapped, we need to get the location of the overlap by sweeping a small distance.
-	TArray<FHitResult> OutHits;
-
-	const FVector Start = CapsuleComponent->GetComponentLocation();
-	const FVector End = FVector(Start.X + 1.0f, Start.Y + 1.0f, Start.Z + 1.0f);
-	
-	FCollisionObjectQueryParams ObjectQueryParams;
-	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
-
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(OwnerCharacter);
-	Params.AddIgnoredActors(DamagedActors);
-	
-	if(World->SweepMultiByObjectType(OutHits, Start, End, CapsuleComponent->GetComponentRotation().Quaternion(), ObjectQueryParams, CapsuleComponent->GetCollisionShape(), Params))
-	{
-		for(auto OutHit : OutHits)
-		{
-			if(OutHit.Actor == OtherActor && OutHit.GetComponent() == OtherComp)
-			{
-				if(OwnerCharacter->IsShowingDebugCollision())
-				{
-					DrawDebugCapsule(World, Start, CapsuleComponent->GetScaledCapsuleHalfHeight(),
-					                 CapsuleComponent->GetScaledCapsuleRadius(),
-					                 CapsuleComponent->GetComponentRotation().Quaternion(), FColor::Red, false, 3.0f, 0, 0);
-					
-					DrawDebugSphere(World, OutHit.ImpactPoint, 3.0f, 8, FColor::Red, false, 3.0f, 0, 1);
-				}
-
-				DamagedActors.Add(OtherActor);
-
-				ACeremonyCharacter* CharacterHit = Cast<ACeremonyCharacter>(OutHit.GetActor());
-				
-				OwnerCharacter->Server_VerifyOverlapForDamage(CharacterHit, OutHit.ImpactPoint, DamageEnduranceDamageStunTime, DamageType);
-				break;
-			}
-		}
-	}
+	// The server checks the hit against the montage that made it, which may still be queued.
+	ACeremonyCharacter* CharacterHit = Cast<ACeremonyCharacter>(Hit.GetActor());
+	OwnerCharacter->SendPendingCosmeticAnimMontage();
+	OwnerCharacter->Server_VerifyOverlapForDamage(CharacterHit, Hit.ImpactPoint, OwnerCharacter->GetEquipmentHand(this), ActiveAttackId, ActiveCharge, UCeremonyFunctionLibrary::GetServerWorldTimeSeconds(this));
 }
 
 void AMeleeWeaponActor::SetAttackCanDamage(const bool bCanDamage)
 {
-	if(bCanDamage)
-	{
-		DamagedActors.Empty();
-		CapsuleComponent->SetGenerateOverlapEvents(true);
-	}
-	else
-	{
-		CapsuleComponent->SetGenerateOverlapEvents(false);
-	}
+	CapsuleComponent->SetCanHit(bCanDamage);
 }
 
 #pragma endregion
@@ -262,11 +264,9 @@ void AMeleeWeaponActor::Press1()
 			
 			if(OwnerCharacter->GetIsRunning())
 			{
-				// Set up damage in case a hit occurs.
-				DamageEnduranceDamageStunTime = FVector_NetQuantize(Press1RunningAttackParams.DamageParams.DamageStandard,
-					Press1RunningAttackParams.DamageParams.EnduranceDamageStandard,
-						Press1RunningAttackParams.DamageParams.StunTime);
-				DamageType = static_cast<uint8>(Press1RunningAttackParams.DamageParams.DamageType);
+				// Set up the attack in case a hit occurs.
+				ActiveAttackId = Press1RunningAttackId;
+				ActiveCharge = 0;
 				
 				OwnerCharacter->SetIsRunning(false);
 				OwnerCharacter->DepleteEndurance(Press1RunningAttackParams.EnduranceConsumption);
@@ -284,22 +284,20 @@ void AMeleeWeaponActor::Press1()
 					OwnerCharacter->DepleteEndurance(BackStabEnduranceConsumption);
 					OwnerCharacter->PlayMontageGlobally(BackStabMontage);
 					OwnerCharacter->SetOnMontageEndedDelegate(this, "OnAttackMontageEnded", BackStabMontage);
-					OwnerCharacter->Server_VerifyBackStab(OutHitCharacter, Press1AttackParams[0].DamageParams.DamageStandard * Press1AttackParams[0].DamageParams.BackStabMultiplier);
+					OwnerCharacter->Server_VerifyBackStab(OutHitCharacter, OwnerCharacter->GetEquipmentHand(this), BackStabAttackId);
 				}
 				else if(OutAttackType == ESpecialAttackType::Riposte)
 				{
 					OwnerCharacter->DepleteEndurance(RiposteEnduranceConsumption);
 					OwnerCharacter->PlayMontageGlobally(RiposteMontage);
 					OwnerCharacter->SetOnMontageEndedDelegate(this, "OnAttackMontageEnded", RiposteMontage);
-					OwnerCharacter->Server_VerifyRiposte(OutHitCharacter, Press1AttackParams[0].DamageParams.DamageStandard * Press1AttackParams[0].DamageParams.RiposteMultiplier);
+					OwnerCharacter->Server_VerifyRiposte(OutHitCharacter, OwnerCharacter->GetEquipmentHand(this), RiposteAttackId);
 				}
 				else
 				{
-					// Set up damage in case a hit occurs.
-					DamageEnduranceDamageStunTime = FVector_NetQuantize(Press1AttackParams[Press1CurrentAttack].DamageParams.DamageStandard,
-						Press1AttackParams[Press1CurrentAttack].DamageParams.EnduranceDamageStandard,
-							Press1AttackParams[Press1CurrentAttack].DamageParams.StunTime);
-					DamageType = static_cast<uint8>(Press1AttackParams[Press1CurrentAttack].DamageParams.DamageType);
+					// Set up the attack in case a hit occurs.
+					ActiveAttackId = static_cast<uint8>(Press1CurrentAttack);
+					ActiveCharge = 0;
 
 					OwnerCharacter->DepleteEndurance(Press1AttackParams[Press1CurrentAttack].EnduranceConsumption);
 					OwnerCharacter->PlayMontageGlobally(Press1AttackParams[Press1CurrentAttack].Montage);
@@ -365,12 +363,9 @@ void AMeleeWeaponActor::Release2()
 		// Determine the amount of endurance consumption, damage, and endurance damage from the time charged.
 		const float TimeDifference = FMath::Clamp(World->GetTimeSeconds() - Press2ChargeStartTimestamp, 0.0f, Press2AttackParams.ChargeSeconds);
 
-		// Set up damage in case a hit occurs.
-		DamageEnduranceDamageStunTime = FVector_NetQuantize(FMath::Lerp(Press2AttackParams.DamageParams.DamageStandard, Press2AttackParams.DamageParams.DamageFullyCharged, TimeDifference/Press2AttackParams.ChargeSeconds),
-			FMath::Lerp(Press2AttackParams.DamageParams.EnduranceDamageStandard, Press2AttackParams.DamageParams.EnduranceDamageFullyCharged, TimeDifference/Press2AttackParams.ChargeSeconds),
-				Press2AttackParams.DamageParams.StunTime);
-
-		DamageType = static_cast<uint8>(Press2JumpingAttackParams.DamageParams.DamageType);
+		// Set up the attack in case a hit occurs; the server scales the damage by the charge.
+		ActiveAttackId = Press2AttackId;
+		ActiveCharge = FAttackDefinition::QuantizeCharge(TimeDifference/Press2AttackParams.ChargeSeconds);
 		
 		const float EnduranceConsumed = FMath::Lerp(Press2AttackParams.EnduranceConsumptionMinimum, Press2AttackParams.EnduranceConsumptionMaximum, TimeDifference/Press2AttackParams.ChargeSeconds);
 
@@ -408,11 +403,9 @@ void AMeleeWeaponActor::TriggerPress2Attack()
 			
 			if(OwnerCharacter->GetIsRunning())
 			{
-				// Set up damage in case a hit occurs.
-				DamageEnduranceDamageStunTime = FVector_NetQuantize(Press2JumpingAttackParams.DamageParams.DamageStandard,
-					Press2JumpingAttackParams.DamageParams.EnduranceDamageStandard,
-						Press2JumpingAttackParams.DamageParams.StunTime);
-				DamageType = static_cast<uint8>(Press2JumpingAttackParams.DamageParams.DamageType);
+				// Set up the attack in case a hit occurs.
+				ActiveAttackId = Press2JumpingAttackId;
+				ActiveCharge = 0;
 
 				OwnerCharacter->SetIsRunning(false);
 				OwnerCharacter->DepleteEndurance(Press2JumpingAttackParams.EnduranceConsumption);
@@ -429,9 +422,9 @@ void AMeleeWeaponActor::TriggerPress2Attack()
 					return;
 				}
 
-				// Reset damage types, they will be set on release.
-				DamageEnduranceDamageStunTime = FVector_NetQuantize::ZeroVector;
-				DamageType = 0;
+				// The attack is set up on release, once the charge is known.
+				ActiveAttackId = Press2AttackId;
+				ActiveCharge = 0;
 				
 				OwnerCharacter->PlayMontageGlobally(Press2AttackParams.ChargeMontage);
 				
@@ -470,45 +463,41 @@ ACeremonyCharacter* AMeleeWeaponActor::CheckForSpecialAttack(ESpecialAttackType&
 	ACeremonyCharacter* OutHitCharacter = nullptr;
 	OutAttackType = ESpecialAttackType::None;
 
-	UWorld* World = GetWorld();
-	if(!IsValid(World))
+	const UCeremonyCharacterRegistry* CharacterRegistry = UCeremonyCharacterRegistry::Get(this);
+	if(!IsValid(CharacterRegistry))
 	{
-		UE_LOG(LogTemp, Error, TEXT("AMeleeWeaponActor::CheckForSpecialAttack: Unable to get world for %s."), *GetNameSafe(this));
+		UE_LOG(LogTemp, Error, TEXT("AMeleeWeaponActor::CheckForSpecialAttack: Unable to get character registry for %s."), *GetNameSafe(this));
+		return nullptr;
 	}
 
 	const FVector Start = OwnerCharacter->GetActorLocation();
 	const FVector AttackingCharacterForwardVector = OwnerCharacter->GetActorForwardVector();
-	const FVector End = Start + AttackingCharacterForwardVector * SpecialAttackReach;
 
 	if(OwnerCharacter->IsShowingDebugCollision())
 	{
-		DrawDebugLine(World, Start, End, FColor::Red, false, 3.0f, 0, 0);
+		DrawDebugLine(GetWorld(), Start, Start + AttackingCharacterForwardVector * SpecialAttackReach, FColor::Red, false, 3.0f, 0, 0);
 	}
-	
-	FHitResult OutHit;
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(OwnerCharacter);
-	if(!World->LineTraceSingleByChannel(OutHit, Start, End, ECC_Pawn, Params))
+
+	// Find the first character the reach passes through; the registry doesn't know about walls, so check that one trace.
+	FCeremonyCharacterQueryResult Result;
+	if(!CharacterRegistry->FindCharacterAlongLine(Start, AttackingCharacterForwardVector, SpecialAttackReach, Result, OwnerCharacter) ||
+		!OwnerCharacter->HasLineOfSightTo(Result.Character))
 	{
 		return nullptr;
 	}
 
 	if(bShowDebugMessages)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("AMeleeWeaponActor::CheckForSpecialAttack: Character %s hit actor %s, hit component %s."), *GetNameSafe(OwnerCharacter), *GetNameSafe(OutHit.GetActor()), *GetNameSafe(OutHit.GetComponent()));	
+		UE_LOG(LogTemp, Warning, TEXT("AMeleeWeaponActor::CheckForSpecialAttack: Character %s found character %s."), *GetNameSafe(OwnerCharacter), *GetNameSafe(Result.Character));	
 	}
 	
-	OutHitCharacter = Cast<ACeremonyCharacter>(OutHit.GetActor());
-	if(!IsValid(OutHitCharacter))
-	{
-		return nullptr;
-	}
+	OutHitCharacter = Result.Character;
 
-	const FVector HitCharacterForwardVector = OutHitCharacter->GetActorForwardVector();
+	const FVector HitCharacterForwardVector = Result.ForwardVector;
 
 	if(OwnerCharacter->IsShowingDebugCollision())
 	{
-		DrawDebugLine(World, OutHitCharacter->GetActorLocation(), OutHitCharacter->GetActorLocation() + HitCharacterForwardVector * SpecialAttackReach, FColor::Green, false, 3.0f, 0, 0);
+		DrawDebugLine(GetWorld(), OutHitCharacter->GetActorLocation(), OutHitCharacter->GetActorLocation() + HitCharacterForwardVector * SpecialAttackReach, FColor::Green, false, 3.0f, 0, 0);
 	}
 
 	const float DotProduct = FVector::DotProduct(AttackingCharacterForwardVector, HitCharacterForwardVector);
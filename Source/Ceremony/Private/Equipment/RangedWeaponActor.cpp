@@ -4,6 +4,7 @@
 
 #include "Components/ArrowComponent.h"
 #include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyProjectileSubsystem.h"
 #include "Equipment/ProjectileActor.h"
 #include "Components/SkeletalMeshComponent.h"
 
@@ -44,6 +45,11 @@ void ARangedWeaponActor::CancelActions()
 
 #pragma region Attack
 
+void ARangedWeaponActor::BuildAttackDefinitions()
+{
+	Press1AttackId = AddAttackDefinition(Press1AttackParams.DamageParams);
+}
+
 void ARangedWeaponActor::CheckForAttackTransition()
 {
 	if(bTwoHandPress1IsPreparing)
@@ -57,6 +63,12 @@ void ARangedWeaponActor::CheckForAttackTransition()
 	}
 }
 
+void ARangedWeaponActor::GetMontages(TArray<UAnimMontage*>& OutMontages) const
+{
+	OutMontages.Add(Press1AttackParams.AttackMontage);
+	OutMontages.Add(Press1AttackParams.PrepareMontage);
+}
+
 void ARangedWeaponActor::OnAttackMontageEnded(UAnimMontage* Montage, const bool bInterrupted)
 {
 	OwnerCharacter->ClearOnMontageEndedDelegate();
@@ -81,7 +93,8 @@ void ARangedWeaponActor::FireProjectile()
 {
 	const FVector_NetQuantize Location = GetActorLocation();
 	const FRotator Rotation = FRotator(0.0f, OwnerCharacter->GetActorRotation().Yaw, 0.0f);
-	Server_SpawnProjectile(ProjectileClassToSpawn, Location, Rotation);
+	LaunchProjectile(Location, Rotation);
+	OwnerCharacter->Server_LaunchProjectile(OwnerCharacter->GetEquipmentHand(this), Location, Rotation);
 
 	OwnerCharacter->SetIsAiming(false);
 	OwnerCharacter->SetAllowEnduranceRecovery(false);
@@ -136,24 +149,33 @@ void ARangedWeaponActor::TwoHandResume1(bool bHeldDown)
 
 #pragma endregion
 
-#pragma region Server
+#pragma region Projectile
 
-void ARangedWeaponActor::Server_SpawnProjectile_Implementation(TSubclassOf<AProjectileActor> ClassToSpawn,
-	const FVector_NetQuantize Location, const FRotator Rotation)
+void ARangedWeaponActor::LaunchProjectile(const FVector& Location, const FRotator& Rotation) const
 {
-	UWorld* World = GetWorld();
-	if(!IsValid(World))
+	UCeremonyProjectileSubsystem* ProjectileSubsystem = UCeremonyProjectileSubsystem::Get(this);
+	if(!IsValid(ProjectileSubsystem))
 	{
-		UE_LOG(LogTemp, Error, TEXT("ARangedWeaponActor::Server_SpawnProjectile_Implementation: Can't spawn projectile, world invalid."));
+		UE_LOG(LogTemp, Error, TEXT("ARangedWeaponActor::LaunchProjectile: Can't launch projectile, projectile subsystem invalid."));
 		return;
 	}
-		
-	FActorSpawnParameters SpawnParameters;
-	SpawnParameters.Owner = OwnerCharacter;
-	SpawnParameters.Instigator = OwnerCharacter;
-	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
-	AProjectileActor* Projectile = World->SpawnActor<AProjectileActor>(ProjectileClassToSpawn, Location, Rotation, SpawnParameters);
+	ProjectileSubsystem->LaunchProjectile(ProjectileClassToSpawn, OwnerCharacter, Location, Rotation);
 }
 
-#pragma endregion
\ No newline at end of file
+bool ARangedWeaponActor::VerifyLaunch(FVector& Location)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	if(Now - LastLaunchTime < MinLaunchInterval)
+	{
+		return false;
+	}
+
+	LastLaunchTime = Now;
+
+	const FVector CharacterLocation = OwnerCharacter->GetActorLocation();
+	Location = CharacterLocation + (Location - CharacterLocation).GetClampedToMaxSize(MaxLaunchDistance);
+	return true;
+}
+
+#pragma endregion
@@ -58,6 +58,13 @@ void AShieldActor::GetDamageAfterAbsorption(const float DamageIn, const EDamageT
 
 #pragma region Press1
 
+void AShieldActor::GetMontages(TArray<UAnimMontage*>& OutMontages) const
+{
+	OutMontages.Add(BlockingMontage);
+	OutMontages.Add(ImpactMontage);
+	OutMontages.Add(ParryMontage);
+}
+
 void AShieldActor::OnImpactMontageEnded(UAnimMontage* Montage, bool bInterrupted) const
 {
 	OwnerCharacter->ClearOnMontageEndedDelegate();
@@ -4,10 +4,55 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
 #include "CeremonyAnimInstance.generated.h"
 
+class ACeremonyCharacter;
+class UCeremonyAnimInstance;
+
+/**
+ * Proxy for the Ceremony animation instance. The character state is copied on the game thread before the update, and the blend space and IK
+ * variables are computed from the copy during the worker thread update, just before the anim graph reads them.
+ */
+USTRUCT()
+struct CEREMONY_API FCeremonyAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FCeremonyAnimInstanceProxy() {}
+
+	FCeremonyAnimInstanceProxy(UAnimInstance* InAnimInstance) : FAnimInstanceProxy(InAnimInstance) {}
+
+protected:
+
+	// Copy the character state on the game thread.
+	void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+
+	// Compute the anim instance variables on the worker thread.
+	void Update(float DeltaSeconds) override;
+
+	// The instance being updated; only written to during the worker thread update, where the game thread doesn't touch it.
+	UCeremonyAnimInstance* CeremonyAnimInstance = nullptr;
+
+	// Whether there was a character to copy the state from this update.
+	bool bHasOwner = false;
+
+	// Character state copied before the update.
+	FVector OwnerVelocity = FVector::ZeroVector;
+	FQuat OwnerRotation = FQuat::Identity;
+	bool bOwnerIsFalling = false;
+	bool bOwnerIsLockedOn = false;
+	bool bOwnerMeleeLocomotion = false;
+	FVector OwnerPelvisOffset = FVector::ZeroVector;
+	FVector OwnerLeftFootOffsetLocation = FVector::ZeroVector;
+	FVector OwnerRightFootOffsetLocation = FVector::ZeroVector;
+	FRotator OwnerLeftFootOffsetRotation = FRotator::ZeroRotator;
+	FRotator OwnerRightFootOffsetRotation = FRotator::ZeroRotator;
+};
+
 /**
- * Base animation instance for the Ceremony character animation blueprint.
+ * Base animation instance for the Ceremony character animation blueprint. Its variables are set by the proxy during the worker thread update,
+ * so the anim blueprint shouldn't implement the update event if it's to stay off the game thread.
  */
 UCLASS()
 class CEREMONY_API UCeremonyAnimInstance : public UAnimInstance
@@ -15,12 +60,22 @@ class CEREMONY_API UCeremonyAnimInstance : public UAnimInstance
 
 	GENERATED_BODY()
 
+	friend struct FCeremonyAnimInstanceProxy;
+
 public:
 
-	void NativeUpdateAnimation(float DeltaSeconds) override;
+	void NativeInitializeAnimation() override;
 
 protected:
 
+	FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+
+	void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override;
+
+	// The character owning the mesh, cached on initialization.
+	UPROPERTY(Transient)
+	ACeremonyCharacter* OwnerCharacter;
+
 	UPROPERTY(Transient, BlueprintReadOnly)
 	bool bIsFalling;
 
@@ -49,6 +49,10 @@ class CEREMONY_API UCeremonyAnimNotifyState : public UAnimNotifyState
 
 public:
 
+	FORCEINLINE bool GetAttackIsRightHanded() const { return bAttackIsRightHanded; }
+
+	FORCEINLINE ECeremonyAnimNotifyStateType GetNotifyStateType() const { return NotifyStateType; }
+
 #if WITH_EDITOR
 	// Add checks for the editor so that you can only edit pertinent properties.
 	bool CanEditChange(const FProperty* InProperty) const override;
@@ -5,26 +5,52 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "CeremonyAnimNotifyState.h"
+#include "CeremonyHitLog.h"
+#include "Core/CeremonySignificanceSubsystem.h"
+#include "Equipment/EquipmentStructs.h"
 #include "CeremonyCharacter.generated.h"
 
 class AEquipmentActor;
+enum class ECombatStateFlags : uint8;
 class UWidgetComponent;
 
 /**
- * Structure which is used to play cosmetic montages on clients.
+ * Structure which is used to play cosmetic montages on clients. The montage is sent as its registry ID, with the position it started at and the server
+ * time it started, so late receivers can catch up.
  */
-USTRUCT(BlueprintType)
+USTRUCT()
 struct FCosmeticAnimMontage
 {
 	GENERATED_BODY()
 
-	void Set(UAnimMontage* NewMontage, const float NewPosition) { Montage = NewMontage; Position = NewPosition; }
+	// Position is sent in hundredths of a second.
+	static uint16 QuantizePosition(const float Position) { return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Position * 100.0f), 0, static_cast<int32>(MAX_uint16))); }
+	FORCEINLINE float GetPosition() const { return QuantizedPosition / 100.0f; }
+
+	FORCEINLINE bool operator==(const FCosmeticAnimMontage& Other) const { return MontageId == Other.MontageId && QuantizedPosition == Other.QuantizedPosition && ServerStartTime == Other.ServerStartTime; }
+
+	// Stopping sends only the ID.
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
 	
-	UPROPERTY(EditAnywhere)
-	UAnimMontage* Montage;
+	// Registry ID of the montage; 0 stops the montage.
+	UPROPERTY()
+	uint16 MontageId = 0;
+
+	UPROPERTY()
+	uint16 QuantizedPosition = 0;
 
-	UPROPERTY(EditAnywhere)
-	float Position = 0.0f;
+	// The server world time the montage started at the position.
+	UPROPERTY()
+	float ServerStartTime = 0.0f;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCosmeticAnimMontage> : public TStructOpsTypeTraitsBase2<FCosmeticAnimMontage>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
 };
 
 
@@ -42,9 +68,15 @@ public:
 
 	// Handle cleanup when the character leaves the game.
 	void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Queue the player's respawn when the character falls out of the world and is destroyed.
+	void FellOutOfWorld(const UDamageType& DamageType) override;
+
+	// Strip the cosmetic components when running as a dedicated server.
+	void PostInitializeComponents() override;
 	
 	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
-	
+
 	void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	
 	void Tick(float DeltaTime) override;
@@ -87,35 +119,14 @@ public:
 	UFUNCTION()
 	void OnRep_ClientPlayerNumber() const;
 
-	// Tracks which player number in the world; used to set color.
-	UPROPERTY(Transient, ReplicatedUsing=OnRep_ClientPlayerNumber)
-	int32 ClientPlayerNumber = 0;
+	// Set the player number on the server, which is replicated so that clients will set colors appropriately.
+	void SetClientPlayerNumber(int32 PlayerNumber);
 	
 protected:
-
-	// Called from the server to trigger the client into back stabbed.
-	UFUNCTION(Client, Reliable)
-	void Client_BackStabbed();
-	void Client_BackStabbed_Implementation();
-	
-	UFUNCTION(Client, Reliable)
-	void Client_DepleteEnduranceCanStagger(float EnduranceToDeplete);
-	void Client_DepleteEnduranceCanStagger_Implementation(float EnduranceToDeplete);
-
-	// Called from the server to trigger the client into riposted.
-	UFUNCTION(Client, Reliable)
-	void Client_Riposted();
-	void Client_Riposted_Implementation();
-	
-	// Called from the server to trigger the client into staggered.
-	UFUNCTION(Client, Reliable)
-	void Client_Staggered();
-	void Client_Staggered_Implementation();
 	
-	// Called from the server to trigger the client into stunned.
-	UFUNCTION(Client, Reliable)
-	void Client_Stunned(float InStunTime);
-	void Client_Stunned_Implementation(float InStunTime);
+	// Tracks which player number in the world; used to set color.
+	UPROPERTY(Transient, ReplicatedUsing=OnRep_ClientPlayerNumber)
+	int32 ClientPlayerNumber = 0;
 	
 #pragma endregion
 	
@@ -123,6 +134,8 @@ protected:
 
 public:
 
+	FORCEINLINE const class ULagCompensationComponent* GetLagCompensationComponent() const { return LagCompensationComponent; }
+
 	// IK component for moving feet and hips.
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
 	class UInverseKinematicsComponent* InverseKinematicsComponent;
@@ -133,6 +146,10 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
 	class UCameraComponent* CameraComponent;
 	
+	// Streams combat state to the server and keeps its history there.
+	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
+	class UCombatStateComponent* CombatStateComponent;
+	
 	// Debug component for state text.
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
 	class UDebugComponent* DebugComponent;
@@ -141,10 +158,14 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
 	class UFootstepComponent* FootstepComponent;
 	
-	// Collision capsule for the kicking foot.
+	// Hitbox for the kicking foot.
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
-	UCapsuleComponent* KickCapsuleComponent;
+	class UHitboxComponent* KickCapsuleComponent;
 
+	// Server side capsule history, used to verify hits where the attacker saw the victim.
+	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
+	class ULagCompensationComponent* LagCompensationComponent;
+	
 	// Component which enables lock on functionality.
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
 	class ULockOnComponent* LockOnComponent;
@@ -161,6 +182,16 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category = "CeremonyCharacter | Components")
 	class USpringArmComponent* SpringArmComponent;
 
+	// Returns the user widget of the opponent widget component, or nullptr if it was stripped or hasn't been created.
+	class UCeremonyOpponentUserWidget* GetOpponentUserWidget() const;
+
+	// Destroy the components which only present the character to a player; the camera, debug, footsteps and widgets. Also turns off animation
+	// update rate optimization. Foot IK doesn't tick on dedicated servers, and is kept for its bone names.
+	void StripCosmeticComponents();
+
+	// Update the debug state text, if the debug component exists.
+	void UpdateDebugStateText() const;
+
 #pragma endregion
 	
 #pragma region Equipment
@@ -175,6 +206,15 @@ public:
 	bool GetCanAttack() const;
 	
 	bool GetCanBlock() const;
+
+	// Returns the equipment held in the hand, or nullptr.
+	AEquipmentActor* GetEquipment(EEquipmentHand Hand) const;
+
+	// Add every equipment class a loadout can hold; used to build the equipment catalog from class defaults without loading the equipment.
+	virtual void GetEquipmentClasses(TArray<TSoftClassPtr<AEquipmentActor>>& OutEquipmentClasses) const;
+
+	// Returns the hand holding the equipment, or None if the character doesn't hold it.
+	EEquipmentHand GetEquipmentHand(const AEquipmentActor* Equipment) const;
 	
 	FORCEINLINE bool GetIsAttacking() const { return bIsAttacking; }
 
@@ -183,6 +223,16 @@ public:
 	FORCEINLINE bool GetIsParrying() const { return bIsParrying; }
 
 	FORCEINLINE bool GetIsShieldLeftHanded() const { return bIsShieldLeftHanded; }
+
+	FORCEINLINE const TSoftClassPtr<AEquipmentActor>& GetLeftHandEquipmentDefaultClass() const { return LeftHandEquipmentDefaultClass; }
+
+	FORCEINLINE FName GetLeftHandSocketName() const { return LeftHandSocketName; }
+
+	FORCEINLINE const FCeremonyLoadout& GetLoadout() const { return Loadout; }
+
+	FORCEINLINE const TSoftClassPtr<AEquipmentActor>& GetRightHandEquipmentDefaultClass() const { return RightHandEquipmentDefaultClass; }
+
+	FORCEINLINE FName GetRightHandSocketName() const { return RightHandSocketName; }
 	
 	FORCEINLINE bool GetParryCanStagger() const { return bParryCanStagger; }
 	
@@ -197,6 +247,9 @@ public:
 
 	void SetIsParrying(bool bParry);
 
+	// Called on the server to change the equipment held; every machine spawns the equipment from the replicated loadout.
+	void SetLoadout(const FCeremonyLoadout& NewLoadout);
+
 	void SetParryCanStagger(bool bCanStagger);
 	
 protected:
@@ -211,6 +264,21 @@ protected:
 	void RightHandRelease1();
 	void RightHandRelease2();
 
+	// Called when the equipment of the loadout has streamed in; replaces the local equipment with that of the loadout.
+	void OnLoadoutLoaded();
+
+	// Called when the loadout replicates, and directly on the server; streams in the equipment of the loadout if it isn't loaded yet.
+	UFUNCTION()
+	void OnRep_Loadout();
+
+	// Replace the equipment in the hand with locally spawned equipment of the class, attached to the hand's socket. A null class empties the hand,
+	// and equipment already of the class is kept.
+	void ReplaceEquipment(EEquipmentHand Hand, TSubclassOf<AEquipmentActor> EquipmentClass);
+
+	// Link the anim layers of the equipment locally, replacing those linked before. The right hand equipment's layers are used, or the left
+	// hand's if the right has none.
+	void UpdateEquipmentAnimLayers();
+	
 	// State set when attack animations are being played.
 	bool bIsAttacking = false;
 
@@ -222,13 +290,17 @@ protected:
 	
 	bool bIsShieldLeftHanded = true;
 	
-	// Reference to the item equipped in the left hand.
-	UPROPERTY(Transient, Replicated)
+	// Equipment classes a loadout can hold besides the defaults.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Equipment")
+	TArray<TSoftClassPtr<AEquipmentActor>> AdditionalEquipmentClasses;
+
+	// Reference to the item equipped in the left hand, spawned locally from the loadout.
+	UPROPERTY(Transient)
 	AEquipmentActor* LeftHandEquipment;
 
 	// Class to spawn for the default left hand equipment.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Equipment")
-	TSubclassOf<AEquipmentActor> LeftHandEquipmentDefaultClass;
+	TSoftClassPtr<AEquipmentActor> LeftHandEquipmentDefaultClass;
 
 	// Socket with which to attach right hand equipment.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Equipment")
@@ -242,13 +314,24 @@ protected:
 
 	bool bParryCanStagger = false;
 	
-	// Reference to the item equipped in the right hand.
-	UPROPERTY(Transient, Replicated)
+	// Anim layers currently linked from equipment.
+	UPROPERTY(Transient)
+	TSubclassOf<class UCeremonyAnimInstance> LinkedAnimLayerClass;
+
+	// The equipment held, as catalog IDs; replicated instead of the equipment, which every machine spawns for itself.
+	UPROPERTY(Transient, ReplicatedUsing=OnRep_Loadout)
+	FCeremonyLoadout Loadout;
+
+	// Keeps the equipment of the loadout loaded, and is cancelled when the loadout changes before it has streamed in.
+	TSharedPtr<struct FStreamableHandle> LoadoutHandle;
+	
+	// Reference to the item equipped in the right hand, spawned locally from the loadout.
+	UPROPERTY(Transient)
 	AEquipmentActor* RightHandEquipment;
 
 	// Class to spawn for the default right hand equipment.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Equipment")
-	TSubclassOf<AEquipmentActor> RightHandEquipmentDefaultClass;
+	TSoftClassPtr<AEquipmentActor> RightHandEquipmentDefaultClass;
 
 	// Socket with which to attach right hand equipment.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Equipment")
@@ -264,6 +347,9 @@ protected:
 
 public:
 
+	// Apply combat state received from the owning client on the server; see UCombatStateComponent.
+	void ApplyCombatStateFlags(ECombatStateFlags Flags);
+	
 	// Cancels all actions the character could be currently taking.
 	void CancelActions();
 	
@@ -276,8 +362,12 @@ public:
 
 	// Returns if the character is free to perform actions that are singular; attacking, rolling, jumping, etc.
 	bool GetCanPerformStandardAction() const;
+
+	// Returns the combat state the server needs for verifying hits, packed into flags.
+	ECombatStateFlags GetCombatStateFlags() const;
 	
-	FORCEINLINE float GetEndurance() const { return Endurance; }
+	// Returns the current endurance, evaluated from the value at the last change and the rate since.
+	float GetEndurance() const;
 
 	FORCEINLINE float GetHealth() const { return Health; }
 
@@ -286,10 +376,13 @@ public:
 	FORCEINLINE bool GetIsStaggered() const { return bIsStaggered; }
 	
 	FORCEINLINE bool GetIsStunned() const { return bIsStunned; }
+
+	// Returns if nothing in the world blocks visibility between the two characters; used to keep special attacks from passing through walls.
+	bool HasLineOfSightTo(const ACeremonyCharacter* OtherCharacter) const;
 	
 	bool IsShowingDebugCollision() const;
 
-	// Called via notify to check the material below the character and play the appropriate footstep sound.
+	// Called via notify on every client to check the material below the character and play the appropriate footstep sound locally.
 	void PlayFootstepSound(bool bRightFoot);
 
 	// Play a sound at the actor's location.
@@ -304,13 +397,29 @@ public:
 	void SetIsStunned(bool bStunned);
 
 	// Call when a locally controlled opponent has locked on to this character (or released lock on).
-	void SetOpponentHasLockedOn(bool bHasLockedOn) const;
+	void SetOpponentHasLockedOn(bool bHasLockedOn);
 	
 protected:
 	
 	UFUNCTION()
 	void OnRep_Health() const;
 
+	// Set health on the server, clamped to the maximum.
+	void SetHealth(float NewHealth);
+
+	// Called when the endurance runs out while running; applies the penalty and stops running.
+	void OnEnduranceRanOut();
+
+	// Called when the stagger timer expires.
+	void OnStaggerExpired();
+
+	// Called when the stun timer expires.
+	void OnStunExpired();
+
+	// Fold the endurance change so far into the value, pick the rate for the current state and schedule running out. Call whenever the state
+	// the rate depends on changes.
+	void UpdateEnduranceRate();
+
 	// If the character is in a state that allows endurance to be recovered.
 	bool bAllowEnduranceRecovery = true;
 	
@@ -325,7 +434,7 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay")
 	float BlockingEnduranceRecoveryPerSecond = 10.0f;
 	
-	// Character endurance; at 0 (or negative values) they cannot perform actions.
+	// Character endurance at EnduranceTimestamp; at 0 (or negative values) they cannot perform actions. Read it with GetEndurance().
 	UPROPERTY(Transient)
 	float Endurance;
 
@@ -333,9 +442,18 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay")
 	float EnduranceMaximum = 100.0f;
 	
+	// The rate endurance changes per second since EnduranceTimestamp; negative while running, positive while recovering.
+	float EnduranceRate = 0.0f;
+	
 	// Endurance recovery rate per second when walking/standing.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay")
 	float EnduranceRecoveryPerSecond = 40.0f;
+
+	// Timer for running out of endurance while running.
+	FTimerHandle EnduranceTimerHandle;
+
+	// World time at which Endurance was last set.
+	float EnduranceTimestamp = 0.0f;
 	
 	// Character health; at 0, they die.
 	UPROPERTY(Transient, ReplicatedUsing=OnRep_Health)
@@ -345,6 +463,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay")
 	float HealthMaximum = 100.0f;
 
+	// How long the dead character lies as a ragdoll before it's pooled or destroyed; the player doesn't respawn before then.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay", meta=(ClampMin=0.0f))
+	float DeadBodyTime = 5.0f;
+
 	bool bIsInvincible = false;
 
 	// Whether the character is staggered and able to be riposted. This must be replicated.
@@ -358,8 +480,8 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay")
 	float StaggerTime = 2.0f;
 	
-	// Timer to count down before stagger is released.
-	float StaggerTimer = 0.0f;
+	// Timer to release the stagger.
+	FTimerHandle StaggerTimerHandle;
 	
 	// The number of times hit while stunned, to trigger early stun exit.
 	int32 StunCount = 0;
@@ -368,17 +490,62 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Gameplay")
 	int32 StunCountMaximum = 1;
 
-	// Timer to count down time before stun is released.
-	float StunTimer = 0.0f;
+	// Timer to release the stun.
+	FTimerHandle StunTimerHandle;
 	
 #pragma endregion 
 
+#pragma region HitLog
+
+public:
+
+	// Called on clients for each replicated hit record, and directly where the record was added without replication (listen server, standalone).
+	void OnHitRecordReceived(const FHitRecord& Record);
+	
+protected:
+
+	// Triggers the locally controlled character into back stabbed.
+	void ApplyBackStabbed();
+	
+	void ApplyDepleteEnduranceCanStagger(float EnduranceToDeplete);
+
+	// Update the damage indicator seen by opponents.
+	void ApplyOpponentWidgetDamage(float Damage) const;
+	
+	// Triggers the locally controlled character into riposted.
+	void ApplyRiposted();
+
+	// Triggers the locally controlled character into staggered.
+	void ApplyStaggered();
+
+	// Triggers the locally controlled character into stunned.
+	void ApplyStunned(float InStunTime);
+
+	// Returns the audio property for a hit sound.
+	USoundBase* GetHitSound(EHitSound HitSound) const;
+	
+	// Recent hits on the character, delta replicated to all clients.
+	UPROPERTY(Transient, Replicated)
+	FHitLog HitLog;
+
+	// How long, in seconds, hit records are kept on the server. Clients ignore records older than this, such as those received when the character becomes relevant.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | HitLog", meta=(ClampMin=0.1f, ClampMax=10.0f))
+	float HitRecordLifetime = 1.0f;
+	
+#pragma endregion
+
 #pragma region Kick
 
 public:
 	
 	FORCEINLINE bool GetIsKicking() const { return bIsKicking; }
 
+	// The distance from the kick socket to the far end of the kick hitbox.
+	float GetKickReach() const;
+
+	// The socket the kick hitbox is attached to.
+	FName GetKickSocketName() const;
+
 	void SetIsKicking(bool bKick);
 	
 	void SetKickCanDamage(bool bCanDamage) const;
@@ -387,18 +554,13 @@ protected:
 
 	void Kick();
 
-	UFUNCTION()
-	void OnKickComponentOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-		UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	// Called by the kick hitbox once per character per kick.
+	void OnKickHit(const FHitResult& Hit);
 	
 	UFUNCTION()
 	void OnKickMontageComplete(UAnimMontage* Montage, const bool bInterrupted);
 
 	bool bIsKicking = false;
-	
-	// Array to keep track of who's been kicked in a single kick. Prevents kicking the same person more than once with one kick.
-	UPROPERTY(Transient)
-	TArray<AActor*> KickedActors;
 
 	// The endurance damage done
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Kick")
@@ -426,9 +588,16 @@ public:
 	// Clears all delegates that would be called when a montage playback ends.
 	void ClearOnMontageEndedDelegate() const;
 
+	// Add every montage the character can play without equipment; used to build the montage registry from class defaults.
+	virtual void GetMontages(TArray<UAnimMontage*>& OutMontages) const;
+
 	// Play a montage locally on the client, and replicate it via the server to other clients to play with CosmeticAnimMontage.
 	void PlayMontageGlobally(UAnimMontage* MontageToPlay, FName JumpToSection = NAME_None);	
 
+	// Send a montage request queued this frame now, rather than at the end of the frame. Called before a hit is sent to the server, so it
+	// checks the hit against the montage that made it.
+	void SendPendingCosmeticAnimMontage();
+
 	// Sets the function to call when a playing montage has finished playing or is interrupted.
 	void SetOnMontageEndedDelegate(UObject* UserObject, FName FunctionName, UAnimMontage* ActiveMontage) const;
 
@@ -437,10 +606,17 @@ public:
 	
 protected:
 
+	// Send the final montage state requested this frame, unless it's the state already sent. Bound to the world's post actor tick while a request is pending.
+	void FlushCosmeticAnimMontage(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	
 	UFUNCTION()
 	void OnBackStabOrRiposteMontageEnded(UAnimMontage* Montage, bool bInterrupted);
+
+	// Buffer a montage state to send to the server at the end of the frame. Cancelling an action commonly stops and plays in the same frame; only the last
+	// request is sent.
+	void QueueCosmeticAnimMontage(const FCosmeticAnimMontage& NewCosmeticAnimMontage);
 	
-	// Triggered when the server changes this value on clients.
+	// Triggered when the server changes this value on clients. The montage is fast forwarded by the time since it started on the server.
 	UFUNCTION()
 	void OnRepCosmeticAnimMontage() const;
 	
@@ -454,6 +630,15 @@ protected:
 	// When one client plays a montage, the server updates this value on the other clients to trigger that montage to play remotely.
 	UPROPERTY(Transient, ReplicatedUsing=OnRepCosmeticAnimMontage)
 	FCosmeticAnimMontage CosmeticAnimMontage;
+
+	// Handle for the end of frame flush; valid while a montage request is pending.
+	FDelegateHandle FlushCosmeticAnimMontageHandle;
+
+	// The montage state last sent to the server.
+	FCosmeticAnimMontage LastSentCosmeticAnimMontage;
+	
+	// The final montage state requested this frame.
+	FCosmeticAnimMontage PendingCosmeticAnimMontage;
 	
 	// The amount of time to blend animations after a montage has been interrupted or stopped.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Montage")
@@ -511,6 +696,9 @@ public:
 
 	// Called from the locked on component to enable/disable lock.
 	void SetIsLockedOn(bool bLocked);
+
+	// Called from the locked on component to turn the character towards its target; the yaw is streamed to the server when it changes enough.
+	void SetLockOnYaw(float Yaw);
 	
 	void SetIsRunning(bool bRun);
 	
@@ -528,6 +716,15 @@ protected:
 	void MoveRight(float AxisValue);
 	float MoveRightLastValue = 0.0f;
 
+	// Whether there was movement input on either axis, as running only costs endurance while moving.
+	bool bHasMovementInput = false;
+
+	// Update bHasMovementInput from the last axis values, and the endurance rate if it changed.
+	void UpdateHasMovementInput();
+
+	// Resend the last lock on yaw while locked on; the yaw is unreliable and is otherwise only sent when it changes.
+	void ResendLockOnYaw();
+
 	void RunPress();
 
 	void RunRelease();
@@ -544,8 +741,28 @@ protected:
 	// Whether the character is currently locked on to another character.
 	UPROPERTY(Transient, ReplicatedUsing=OnRep_IsLockedOn)
 	bool bIsLockedOn;
+
+	// The last lock on yaw sent to the server, compressed.
+	uint16 LastSentLockOnYaw = 0;
+
+	// The last lock on yaw received on the server, compressed. Kept while not locked on, as the yaw can arrive before the combat state that
+	// carries lock on.
+	uint16 ReceivedLockOnYaw = 0;
+
+	// Whether the server has received a lock on yaw since lock on was last released.
+	bool bHasReceivedLockOnYaw = false;
+
+	// The lock on yaw must change by this many degrees before it's sent to the server again.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Movement", meta=(ClampMin=0.0f, ClampMax=10.0f))
+	float LockOnYawSendThreshold = 2.0f;
+
+	// How often, in seconds, the last lock on yaw is resent while locked on, to recover from a lost send.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Movement", meta=(ClampMin=0.05f, ClampMax=2.0f))
+	float LockOnYawResendInterval = 0.25f;
+
+	FTimerHandle LockOnYawResendTimerHandle;
 	
-	// Whether the character is currently running.
+	// Whether the character is currently running. The server sets it from the saved moves of the owning client, see UCeremonyMovementComponent.
 	UPROPERTY(Transient, Replicated)
 	bool bIsRunning;
 
@@ -553,7 +770,7 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Movement", meta=(ClampMin=0.0f))
 	float JumpEnduranceConsumption = 40.0f;
 
-	UPROPERTY(Transient, Replicated)
+	// Set locally from two hand equipment in the loadout.
 	bool bMeleeLocomotion = true;
 	
 	// The amount of endurance to consume per second while running.
@@ -586,15 +803,47 @@ protected:
 	void Multicast_KillCharacter(ACeremonyCharacter* CharacterToKill);
 	void Multicast_KillCharacter_Implementation(ACeremonyCharacter* CharacterToKill);
 
-	// Called from the server to force an actor rotation while locked on.
-	UFUNCTION(NetMulticast, Reliable)
-	void Multicast_SetActorRotation(FRotator Rotation);
-	void Multicast_SetActorRotation_Implementation(FRotator Rotation);
+	// Launch a projectile locally from the ranged weapon in the hand, on every machine but the one that fired it.
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_LaunchProjectile(EEquipmentHand Hand, FVector_NetQuantize Location, FRotator Rotation);
+	void Multicast_LaunchProjectile_Implementation(EEquipmentHand Hand, FVector_NetQuantize Location, FRotator Rotation);
 	
-	// Called from the server to tell all simulated proxies to update their damage indicator.
-	UFUNCTION(NetMulticast, Reliable)
-	void Multicast_SetOpponentWidgetDamage(float Damage);
-	void Multicast_SetOpponentWidgetDamage_Implementation(float Damage);
+#pragma endregion
+
+#pragma region Pool
+
+public:
+
+	// Called on the server by the character pool once the dead character has lain for a while; unpossess it and hide it until it's reused.
+	void EnterPool();
+
+	FORCEINLINE bool GetIsPooled() const { return bIsPooled; }
+
+	// Called on the server by the character pool to reuse the character at the transform, with full health, before it's possessed again.
+	void LeavePool(const FTransform& Transform);
+	
+protected:
+
+	// Called on the owning client before the character is pooled, as the client keeps the endurance and action state.
+	UFUNCTION(Client, Reliable)
+	void Client_ResetCharacterState();
+	void Client_ResetCharacterState_Implementation();
+	
+	// Hides or shows the character as it enters or leaves the pool.
+	UFUNCTION()
+	void OnRep_IsPooled();
+
+	// Make the character visible to target queries and significance.
+	void RegisterWithSubsystems();
+
+	// Cancel all actions and montages, and restore endurance and the flags to how the character begins play.
+	void ResetCharacterState();
+
+	void UnregisterFromSubsystems();
+
+	// Whether the character is dead and waiting in the pool to be reused.
+	UPROPERTY(Transient, ReplicatedUsing=OnRep_IsPooled)
+	bool bIsPooled = false;
 	
 #pragma endregion
 
@@ -641,12 +890,19 @@ protected:
 
 public:
 
-	// A character who plays montages triggers the server to push a cosmetic variable change on the other clients, to see the montage as it's played. The variable must change for this to occur, therefore
-	// at the end of each montage playback, this needs to be reset to nullptr/0.
+	// A projectile launched by the client from the ranged weapon in the hand; the server passes it on to the other clients. Projectiles are
+	// cosmetic, so a lost launch only loses the arrow.
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_LaunchProjectile(EEquipmentHand Hand, FVector_NetQuantize Location, FRotator Rotation);
+	void Server_LaunchProjectile_Implementation(EEquipmentHand Hand, FVector_NetQuantize Location, FRotator Rotation);
+	bool Server_LaunchProjectile_Validate(EEquipmentHand Hand, FVector_NetQuantize Location, FRotator Rotation) { return true; }
+
+	// A character who plays montages triggers the server to push a cosmetic variable change on the other clients, to see the montage as it's played. The start time
+	// is stamped by the client, so each play is a change even when the same montage is repeated; a montage ID of 0 stops playback.
 	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_PlayCosmeticAnimMontage(UAnimMontage* MontageToPlay, float Position);
-	void Server_PlayCosmeticAnimMontage_Implementation(UAnimMontage* MontageToPlay, float Position);
-	bool Server_PlayCosmeticAnimMontage_Validate(UAnimMontage* MontageToPlay, float Position) { return true; }	
+	void Server_PlayCosmeticAnimMontage(const FCosmeticAnimMontage& NewCosmeticAnimMontage);
+	void Server_PlayCosmeticAnimMontage_Implementation(const FCosmeticAnimMontage& NewCosmeticAnimMontage);
+	bool Server_PlayCosmeticAnimMontage_Validate(const FCosmeticAnimMontage& NewCosmeticAnimMontage) { return true; }
 
 	// Play a sound at the player's location on all clients.
 	UFUNCTION(Server, Reliable, WithValidation)
@@ -654,68 +910,60 @@ public:
 	void Server_PlaySound_Implementation(USoundBase* Sound) { Multicast_PlaySound(Sound); }
 	bool Server_PlaySound_Validate(USoundBase* Sound) { return true; }
 		
-	// Rotate the actor on the server, which will replicate to all clients.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetActorRotation(FRotator NewRotation);
-	void Server_SetActorRotation_Implementation(FRotator NewRotation);
-	bool Server_SetActorRotation_Validate(FRotator NewRotation) { return true; }
-	
-	// The server must know the character is blocking during ServerVerifyOverlapForDamage.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetIsBlocking(bool bBlocking);
-	void Server_SetIsBlocking_Implementation(const bool bBlocking) { bIsBlocking = bBlocking; }
-	bool Server_SetIsBlocking_Validate(bool bBlocking) { return true; }
-
-	// The server must know the character is invincible during ServerVerifyOverlapForDamage.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetIsInvincible(bool bInvincible);
-	void Server_SetIsInvincible_Implementation(const bool bInvincible) { bIsInvincible = bInvincible; }
-	bool Server_SetIsInvincible_Validate(bool bInvincible) { return true; }
-
-	// The server must know if the character is locked on in order to animate properly; while locked on, the character strafes and faces the target.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetIsLockedOn(bool bLocked);
-	void Server_SetIsLockedOn_Implementation(const bool bLocked) { SetIsLockedOn(bLocked); }
-	bool Server_SetIsLockedOn_Validate(bool bLocked) { return true; }
-	
-	// The server must know the character is running in order to adjust location at the right rate. Otherwise the character will rubber band as the client disagrees with the server.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetIsRunning(bool bInIsRunning);
-	void Server_SetIsRunning_Implementation(const bool bInIsRunning) { bIsRunning = bInIsRunning; }
-	bool Server_SetIsRunning_Validate(bool bInIsRunning) { return true; }
-
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetIsStaggered(bool bStagger);
-	void Server_SetIsStaggered_Implementation(const bool bStagger) { bIsStaggered = bStagger; }
-	bool Server_SetIsStaggered_Validate(bool bStagger) { return true; }
-	
-	// The server must know that the character is in active parry frames, to parry other characters in ServerVerifyOverlapForDamage.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SetParryCanStagger(bool bCanStagger);
-	void Server_SetParryCanStagger_Implementation(const bool bCanStagger) { bParryCanStagger = bCanStagger; }
-	bool Server_SetParryCanStagger_Validate(bool bCanStagger) { return true; }
+	// While locked on, the yaw the character turns towards. The movement component turns to it while replaying moves, and the rotation reaches other clients through replicated movement.
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_SetLockOnYaw(uint16 CompressedYaw);
+	void Server_SetLockOnYaw_Implementation(uint16 CompressedYaw);
+	bool Server_SetLockOnYaw_Validate(uint16 CompressedYaw) { return true; }
 	
-	// When a back stab connects on a client, verify on the server.
+	// When a back stab connects on a client, verify on the server. The damage comes from the attack table of the weapon in the hand.
 	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_VerifyBackStab(ACeremonyCharacter* CharacterHit, float Damage);
-	void Server_VerifyBackStab_Implementation(ACeremonyCharacter* CharacterHit, float Damage);
-	bool Server_VerifyBackStab_Validate(ACeremonyCharacter* CharacterHit, float Damage) { return true; };
+	void Server_VerifyBackStab(ACeremonyCharacter* CharacterHit, EEquipmentHand Hand, uint8 AttackId);
+	void Server_VerifyBackStab_Implementation(ACeremonyCharacter* CharacterHit, EEquipmentHand Hand, uint8 AttackId);
+	bool Server_VerifyBackStab_Validate(ACeremonyCharacter* CharacterHit, EEquipmentHand Hand, uint8 AttackId) { return true; };
 	
-	// When an attack connects on a client, a sweep is done on the server to verify that a hit was made.
+	// When an attack connects on a client, the server rewinds the character hit to the client's timestamp and verifies the impact point against its capsule at that time.
+	// The client sends the hand holding the weapon, the attack ID and the quantized charge; the server computes the damage from the weapon's attack table. No hand is a kick.
 	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_VerifyOverlapForDamage(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, FVector_NetQuantize DamageEnduranceDamageStunTime, uint8 DamageType);
-	void Server_VerifyOverlapForDamage_Implementation(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, FVector_NetQuantize DamageEnduranceDamageStunTime, uint8 IntDamageType);
-	bool Server_VerifyOverlapForDamage_Validate(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, FVector_NetQuantize DamageEnduranceDamageStunTime, uint8 DamageType);
+	void Server_VerifyOverlapForDamage(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, EEquipmentHand Hand, uint8 AttackId, uint8 QuantizedCharge, float ClientServerTime);
+	void Server_VerifyOverlapForDamage_Implementation(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, EEquipmentHand Hand, uint8 AttackId, uint8 QuantizedCharge, float ClientServerTime);
+	bool Server_VerifyOverlapForDamage_Validate(ACeremonyCharacter* CharacterHit, FVector_NetQuantize ImpactPoint, EEquipmentHand Hand, uint8 AttackId, uint8 QuantizedCharge, float ClientServerTime) { return true; }
 
-	// When a riposte connects on a client, verify on the server.
+	// When a riposte connects on a client, verify on the server. The damage comes from the attack table of the weapon in the hand.
 	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_VerifyRiposte(ACeremonyCharacter* CharacterHit, float Damage);
-	void Server_VerifyRiposte_Implementation(ACeremonyCharacter* CharacterHit, float Damage);
-	bool Server_VerifyRiposte_Validate(ACeremonyCharacter* CharacterHit, float Damage) { return true; };
+	void Server_VerifyRiposte(ACeremonyCharacter* CharacterHit, EEquipmentHand Hand, uint8 AttackId);
+	void Server_VerifyRiposte_Implementation(ACeremonyCharacter* CharacterHit, EEquipmentHand Hand, uint8 AttackId);
+	bool Server_VerifyRiposte_Validate(ACeremonyCharacter* CharacterHit, EEquipmentHand Hand, uint8 AttackId) { return true; };
 	
 protected:
 
 	void Server_HelperKillCharacter(ACeremonyCharacter* Character);
+
+	// Look up an attack from the table of the weapon in the hand, making sure the hand holds a weapon and the attack is of the expected type.
+	const FAttackDefinition* Server_HelperGetAttackDefinition(EEquipmentHand Hand, uint8 AttackId, ESpecialAttackType SpecialAttackType) const;
+
+	// Check a hit from the hand, or a kick for no hand, against the baked window and socket path of the montage this character was playing at
+	// the time. Rejects a hit from an empty hand; otherwise passes without combat data.
+	bool Server_HelperIsHitInCombatData(const FVector& ImpactPoint, EEquipmentHand Hand, float ClientServerTime) const;
+
+	// Add a hit caused by this character to the log of the character hit; replaces the individual sound, damage and reaction RPCs.
+	void Server_HelperRecordHit(ACeremonyCharacter* CharacterHit, float Damage, EHitReaction Reaction, float ReactionValue, EHitSound Sound);
+
+	// Attack and kick windows baked from the montages; when set, hits are only accepted inside a window and within reach of its socket path.
+	// The data references every montage, so it's only loaded on the server.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Server")
+	TSoftObjectPtr<class UCeremonyCombatData> ServerCombatData;
+
+	// Keeps the combat data loaded on the server.
+	TSharedPtr<struct FStreamableHandle> ServerCombatDataHandle;
+
+	// Distance beyond the equipment reach that a hit is still accepted at when checked against the combat data.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Server", meta=(ClampMin=0.0f))
+	float ServerCombatDataReachTolerance = 30.0f;
+
+	// Time before and after a window that a hit is still accepted at when checked against the combat data.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Server", meta=(ClampMin=0.0f))
+	float ServerCombatDataTimeTolerance = 0.1f;
 	
 	// When a back stab happens locally, it's verified on the server with a dot product and distance limit. This shouldn't be less than the local setting.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Server", meta=(ClampMin=1.0f))
@@ -733,10 +981,35 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Server", meta=(ClampMin=0.0f, ClampMax=1.0f))
 	float ServerRiposteMaxDotProduct = -0.8f;
 	
-	// When a character hits locally, a sphere overlap at that location is done on the server to verify the character is there.
+	// When a character hits locally, a sphere at that location is tested on the server against the rewound capsule of the character hit.
 	UPROPERTY(EditDefaultsOnly, Category = "CeremonyCharacter | Server", meta=(ClampMin=1.0f))
 	float ServerVerifyOverlapsSphereRadius = 20.0f;
 	
 #pragma endregion 
+
+#pragma region Significance
+
+public:
+
+	// Whether a local player is locked on to this character.
+	FORCEINLINE bool GetOpponentHasLockedOn() const { return bOpponentHasLockedOn; }
+
+	FORCEINLINE ECeremonySignificance GetSignificance() const { return Significance; }
+
+	// Scale the IK, animation, widget and footstep cost to the significance; set by the significance subsystem.
+	void SetSignificance(ECeremonySignificance NewSignificance);
+
+protected:
+
+	// Set the animation update rate for the current significance, through the mesh update rate optimization parameters.
+	void ApplyAnimUpdateRate(struct FAnimUpdateRateParameters* Parameters) const;
+
+	// Whether a local player is locked on to this character.
+	bool bOpponentHasLockedOn = false;
+
+	// How much this character matters to the local players.
+	ECeremonySignificance Significance = ECeremonySignificance::Highest;
+
+#pragma endregion
 	
 };
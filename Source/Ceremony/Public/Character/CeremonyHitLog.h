@@ -0,0 +1,107 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "CeremonyHitLog.generated.h"
+
+class ACeremonyCharacter;
+
+/**
+ * The reaction the character receiving a hit plays on its owning client.
+ */
+UENUM()
+enum class EHitReaction : uint8
+{
+	None,
+	BackStabbed,
+	DepleteEnduranceCanStagger,
+	Riposted,
+	Staggered,
+	Stunned
+};
+
+/**
+ * The sound played on all clients for a hit; resolved to the character's audio properties.
+ */
+UENUM()
+enum class EHitSound : uint8
+{
+	None,
+	AttackHit,
+	BlockAttack,
+	KickBlocked,
+	KickInterrupt,
+	Parry
+};
+
+/**
+ * A single hit on a character, replicated to all clients. Clients play the sound, show the damage and play the reaction from it locally.
+ */
+USTRUCT()
+struct FHitRecord : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	// Damage is only displayed, so it's sent in tenths.
+	static uint16 QuantizeDamage(const float Damage) { return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Damage * 10.0f), 0, static_cast<int32>(MAX_uint16))); }
+	FORCEINLINE float GetDamage() const { return QuantizedDamage / 10.0f; }
+
+	// Handle a record that arrived on a client.
+	void PostReplicatedAdd(const struct FHitLog& InArraySerializer);
+
+	// The character that caused the hit.
+	UPROPERTY()
+	ACeremonyCharacter* Instigator = nullptr;
+
+	UPROPERTY()
+	uint16 QuantizedDamage = 0;
+
+	UPROPERTY()
+	EHitReaction Reaction = EHitReaction::None;
+
+	// Stun time for stuns, endurance to deplete for blocked hits.
+	UPROPERTY()
+	float ReactionValue = 0.0f;
+
+	UPROPERTY()
+	EHitSound Sound = EHitSound::None;
+
+	// The server world time when the hit was recorded; clients ignore records that are too old to react to.
+	UPROPERTY()
+	float ServerTime = 0.0f;
+};
+
+/**
+ * Delta replicated log of the recent hits on a character. The server appends records and trims them by age; only new records are sent.
+ */
+USTRUCT()
+struct FHitLog : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	// Append a record, removing any older than the lifetime.
+	void AddRecord(const FHitRecord& Record, float Lifetime);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParams)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FHitRecord, FHitLog>(Records, DeltaParams, *this);
+	}
+
+	UPROPERTY()
+	TArray<FHitRecord> Records;
+
+	// The character the log belongs to; receives the records.
+	UPROPERTY(NotReplicated)
+	ACeremonyCharacter* OwnerCharacter = nullptr;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHitLog> : public TStructOpsTypeTraitsBase2<FHitLog>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
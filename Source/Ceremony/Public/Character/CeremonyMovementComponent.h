@@ -6,6 +6,52 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "CeremonyMovementComponent.generated.h"
 
+/**
+ * Saved move which carries Ceremony movement state, so the server replays each move with the same state the client used.
+ */
+class FSavedMove_Ceremony : public FSavedMove_Character
+{
+
+public:
+
+	typedef FSavedMove_Character Super;
+
+	FSavedMove_Ceremony() : bSavedWantsToRun(false), bSavedWantsForcedMovement(false) {}
+	
+	bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	
+	void Clear() override;
+
+	uint8 GetCompressedFlags() const override;
+
+	void PrepMoveFor(ACharacter* C) override;
+	
+	void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+
+	// Whether the character was running during this move.
+	uint8 bSavedWantsToRun : 1;
+
+	// Whether an animation was forcing movement during this move.
+	uint8 bSavedWantsForcedMovement : 1;
+	
+};
+
+/**
+ * Client prediction data which allocates Ceremony saved moves.
+ */
+class FNetworkPredictionData_Client_Ceremony : public FNetworkPredictionData_Client_Character
+{
+
+public:
+
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_Ceremony(const UCharacterMovementComponent& ClientMovement);
+
+	FSavedMovePtr AllocateNewMove() override;
+	
+};
+
 /**
  * Overloaded movement component to allow running on server and client.
  */
@@ -14,6 +60,9 @@ class CEREMONY_API UCeremonyMovementComponent : public UCharacterMovementCompone
 {
 	GENERATED_BODY()
 
+	// Saved moves capture and restore the prediction state.
+	friend class FSavedMove_Ceremony;
+	
 public:
 
 	void BeginPlay() override;
@@ -23,5 +72,62 @@ public:
 	// Character reference.
 	UPROPERTY(Transient)
 	class ACeremonyCharacter* OwnerCharacter;
+
+#pragma region LockOn
+
+public:
+
+	// Stop turning towards a lock on target.
+	void ClearLockOnYaw();
+
+	FORCEINLINE bool HasLockOnYaw() const { return bHasLockOnYaw; }
+	
+	// Turn the character towards a yaw at the rotation rate. This runs as part of movement, so it's predicted locally. The yaw isn't carried by
+	// the saved moves; the server turns towards the last yaw received through the character's unreliable Server_SetLockOnYaw.
+	void SetLockOnYaw(float Yaw);
+
+protected:
+
+	// Override to turn towards the lock on yaw, when one is set.
+	void PhysicsRotation(float DeltaTime) override;
+
+	bool bHasLockOnYaw = false;
+
+	// The yaw to turn towards while locked on.
+	float LockOnYaw = 0.0f;
+	
+#pragma endregion
+
+#pragma region Prediction
+
+public:
+
+	FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	FORCEINLINE bool GetWantsForcedMovement() const { return bWantsForcedMovement; }
+	
+	FORCEINLINE bool GetWantsToRun() const { return bWantsToRun; }
+
+	// Count corrections from the server; a correction means the server replayed a move differently from the client.
+	void OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase,
+		FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+	
+	// Set from the character when an animation starts or stops forcing movement.
+	void SetWantsForcedMovement(bool bForcedMovement);
+	
+	// Set from the character when it starts or stops running.
+	void SetWantsToRun(bool bRun);
+
+	// Unpack the Ceremony state from a move received by the server.
+	void UpdateFromCompressedFlags(uint8 Flags) override;
+
+protected:
+
+	// Forced movement is driven by animation and always at walk speed.
+	bool bWantsForcedMovement = false;
+	
+	bool bWantsToRun = false;
+	
+#pragma endregion
 	
 };
@@ -21,9 +21,9 @@ class CEREMONY_API UCeremonyUserWidget : public UUserWidget
 
 public:
 
-	// Function to call to update the endurance display.
+	// Function to call to update the endurance display. The bar follows the rate per second from the current value until it's called again.
 	UFUNCTION()
-	void OnEnduranceChanged(float Current, float Max);
+	void OnEnduranceChanged(float Current, float Max, float RatePerSecond = 0.0f);
 
 	// Function to call to update health display.
 	UFUNCTION()
@@ -36,15 +36,27 @@ public:
 protected:
 
 	float InterpolateBar(float Current, float Target, float DeltaTime, float DownInterpolationSpeed) const;
+
+	// Returns whether the endurance target is still moving at the rate.
+	bool IsEnduranceChanging() const;
 	
 	// Automatically bind this reference to the endurance bar widget inside the child blueprint.
 	UPROPERTY(meta=(BindWidget))
 	UImage* EnduranceBar;
 
+	// The endurance and world time of the last change, from which the target is followed at the rate.
+	float EnduranceChangeTime = 0.0f;
+	float EnduranceChangeValue = 100.0f;
+	
 	float EnduranceCurrentValue = 100.0f;
 
 	UPROPERTY(Transient)
 	UMaterialInstanceDynamic* EnduranceDynamicMaterial;
+
+	float EnduranceMaximumValue = 100.0f;
+
+	// The rate per second the endurance changes at since the last change.
+	float EnduranceRate = 0.0f;
 	
 	float EnduranceTargetValue = 100.0f;
 	
@@ -0,0 +1,136 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CombatStateComponent.generated.h"
+
+class ACeremonyCharacter;
+
+/**
+ * Combat state bits which the owning client sends to the server, and the server uses when verifying hits.
+ */
+enum class ECombatStateFlags : uint8
+{
+	None = 0,
+	Blocking = 1 << 0,
+	ShieldLeftHanded = 1 << 1,
+	Invincible = 1 << 2,
+	ParryCanStagger = 1 << 3,
+	LockedOn = 1 << 4,
+	Staggered = 1 << 5
+};
+ENUM_CLASS_FLAGS(ECombatStateFlags)
+
+/**
+ * A single combat state change; the full state of the flags, stamped with the server time it took effect on the client.
+ */
+USTRUCT()
+struct FCombatStateCommand
+{
+	GENERATED_BODY()
+
+	FORCEINLINE ECombatStateFlags GetFlags() const { return static_cast<ECombatStateFlags>(Flags); }
+
+	UPROPERTY()
+	uint8 Flags = 0;
+
+	UPROPERTY()
+	float ServerTime = 0.0f;
+};
+
+/**
+ * Streams combat state from the owning client to the server in a single unreliable RPC. Each send carries the most recent commands, so a dropped
+ * packet is covered by the next one, and the server keeps a history of the states so hits can be checked against the state at the rewind time.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class CEREMONY_API UCombatStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UCombatStateComponent();
+
+	// Returns the combat state that was in effect at the given server time; used by the server to verify hits.
+	ECombatStateFlags GetFlagsAtTime(float ServerTime) const;
+
+	// Called when the owning character changes combat state. The owning client queues a command to the server; the server records the state and
+	// ignores any older command from the client, so a server forced change (stagger on parry) isn't undone by a late packet.
+	void OnCombatStateChanged();
+
+	// Sends queued commands at the end of the frame, and resends them until the resend window has passed.
+	void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+
+	void BeginPlay() override;
+
+	// Apply the commands in order on the server, skipping any at or before the last received time. Stamps are clamped to the present, and to no
+	// further back than the connection round trip, so a client can't backdate a state over hits already rewound.
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_ReceiveCombatState(const TArray<FCombatStateCommand>& Commands);
+	void Server_ReceiveCombatState_Implementation(const TArray<FCombatStateCommand>& Commands);
+	bool Server_ReceiveCombatState_Validate(const TArray<FCombatStateCommand>& Commands);
+
+	// Returns the history entry that is the given number of entries older than the most recent.
+	FORCEINLINE const FCombatStateCommand& GetHistoryEntry(const int32 Age) const { return History[(HistoryHead - 1 - Age + HistorySize) % HistorySize]; }
+
+	// Record a state on the server.
+	void RecordState(const FCombatStateCommand& Command);
+
+	// Send the most recent commands to the server.
+	void SendPendingCommands();
+
+	// The number of most recent commands sent with every RPC.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=1, ClampMax=8))
+	int32 CommandRedundancy = 3;
+
+	// Ring buffer of states applied on the server; HistoryHead is the next index written.
+	TArray<FCombatStateCommand> History;
+
+	int32 HistoryCount = 0;
+
+	int32 HistoryHead = 0;
+
+	// The number of state changes the server keeps. It should cover the maximum rewind time.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=2, ClampMax=64))
+	int32 HistorySize = 16;
+
+	// Whether a command has been queued since the pending commands were last sent. Changes in the same frame go out in one send.
+	bool bHasUnsentCommand = false;
+	
+	// The time stamp of the latest state applied on the server.
+	float LastAppliedTime = 0.0f;
+
+	// The client stamp of the latest command accepted on the server, or the time of the latest server change; older commands are stale.
+	float LastReceivedTime = 0.0f;
+
+	// The world time of the last change on the owning client.
+	float LastChangeTime = 0.0f;
+
+	// The engine frame of the last command queued on the owning client.
+	uint64 LastCommandFrame = 0;
+
+	// The stamp of the last command queued on the owning client.
+	float LastCommandTime = 0.0f;
+	
+	// The world time the owning client last sent the pending commands.
+	float LastSendTime = 0.0f;
+
+	// Cached reference to the owning character.
+	UPROPERTY(Transient)
+	ACeremonyCharacter* OwnerCharacter;
+
+	// The most recent commands on the owning client, oldest first.
+	TArray<FCombatStateCommand> PendingCommands;
+
+	// How often, in seconds, the pending commands are resent.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.01f, ClampMax=1.0f))
+	float ResendInterval = 0.05f;
+
+	// How long, in seconds, after the last change the pending commands are resent; covers loss of the last packet in a burst.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.0f, ClampMax=2.0f))
+	float ResendWindow = 0.25f;
+};
@@ -10,6 +10,7 @@
 #include "FootstepComponent.generated.h"
 
 class ACeremonyCharacter;
+class UPhysicalMaterial;
 
 /**
  * Structure for a data table containing footstep sounds.
@@ -24,7 +25,7 @@ struct FFootStepSound : public FTableRowBase
 };
 
 /**
- * Footstep sound effect component.
+ * Footstep sound effect component. Footsteps are resolved and played locally on every client from the animation notify; nothing is sent over the network.
  */
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class CEREMONY_API UFootstepComponent : public UActorComponent
@@ -35,19 +36,29 @@ public:
 
 	UFootstepComponent();
 
-	// Call to get the sound to play for the material which is below the character.
-	USoundBase* GetFootstepSound(FName FootBoneName) const;
+	// Trace below the foot and play the sound for the material found; the sound plays when the trace completes next frame.
+	void PlayFootstepSound(FName FootBoneName);
 	
 protected:
 
 	void BeginPlay() override;
 
+	// Returns the sound for the material, looking it up in the data table the first time.
+	USoundBase* GetFootstepSound(UPhysicalMaterial* PhysicalMaterial);
+
+	// Play the sound for the surface below the foot.
+	void OnFootTraceComplete(bool bHit, const FHitResult& Hit);
+
 	// Query params to use over and over when checking the material.
 	FCollisionQueryParams CollisionQueryParams;
 
 	// Data table to use for looking up footstep sounds.
 	UPROPERTY(EditDefaultsOnly)
 	UDataTable* FootstepDataTable;
+
+	// Sounds looked up from the data table by physical material name, cached the first time each material is stepped on. Materials without a row map to nullptr.
+	UPROPERTY(Transient)
+	TMap<UPhysicalMaterial*, USoundBase*> FootstepSounds;
 	
 	// The distance to trace down from the foot to find a surface for footstep sounds.
 	UPROPERTY(EditDefaultsOnly)
@@ -0,0 +1,67 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/CapsuleComponent.h"
+#include "HitboxComponent.generated.h"
+
+// Called once per actor hit while the hitbox is active, with the impact point from the sweep.
+DECLARE_DELEGATE_OneParam(FOnHitboxHit, const FHitResult& /* Hit */);
+
+/**
+ * Capsule used to detect melee hits. While active, the capsule is swept every frame from where it was on the previous frame to where it is now, so
+ * fast swings can't pass through a character between frames. The motion is split into sub-steps by how far the capsule turned, rotating about the
+ * point it is attached at, so swings follow the arc rather than cutting across it. Each actor is reported once per activation.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class CEREMONY_API UHitboxComponent : public UCapsuleComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UHitboxComponent();
+
+	// Activate to start sweeping for hits, clearing the actors already hit; deactivate to stop.
+	void SetCanHit(bool bCanHit);
+
+	// Sweeps the capsule over its motion since the last frame.
+	void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Bound by the owner to receive hits.
+	FOnHitboxHit OnHitboxHit;
+
+protected:
+
+	// The point the capsule rotates about when sub-stepping; the attach socket, or the capsule itself if not attached.
+	FVector GetPivotLocation() const;
+
+	// Record the current transform as the start of the next sweep.
+	void StorePreviousTransform();
+
+	// Sweep between two capsule locations, reporting any actors not hit yet. Returns false if the world is unavailable.
+	bool Sweep(const FVector& Start, const FVector& End, const FQuat& Rotation);
+
+	// Actors already hit during this activation.
+	UPROPERTY(Transient)
+	TArray<AActor*> HitActors;
+
+	// The maximum number of sweeps per frame.
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox", meta=(ClampMin=1, ClampMax=16))
+	int32 MaxSubSteps = 8;
+
+	// The maximum rotation, in degrees, of a single sweep.
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox", meta=(ClampMin=1.0f, ClampMax=90.0f))
+	float MaxSubStepAngle = 15.0f;
+
+	// The capsule offset from the pivot in its local space; constant while attached.
+	FVector PivotOffset = FVector::ZeroVector;
+
+	// The pivot location on the previous frame.
+	FVector PreviousPivotLocation = FVector::ZeroVector;
+
+	// The capsule rotation on the previous frame.
+	FQuat PreviousRotation = FQuat::Identity;
+
+};
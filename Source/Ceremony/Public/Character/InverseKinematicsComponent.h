@@ -30,16 +30,28 @@ public:
 	FORCEINLINE bool GetShowDebugTraces() const { return bShowDebugTraces; }
 
 	void SetShowDebugTraces(const bool bShowTraces) { bShowDebugTraces = bShowTraces; }
+
+	// Set how often the feet are traced; 0 traces every frame. When negative, tracing stops and the component stops ticking once the feet are at rest.
+	void SetTraceInterval(float Interval);
 	
 	void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	
 protected:
 
+	// Whether the pelvis and feet have returned to no offset.
+	bool IsAtRest() const;
+	
 	// Resets the offsets by interpolating to 0 offset.
 	void ResetOffsets(float DeltaTime);
 	
-	// Sets the foot offset for the named foot and returns the current and target offsets.
-	void SetFootOffset(float DeltaTime, FName FootBoneName, FVector& CurrentOffsetLocation, FVector& TargetOffsetLocation, FRotator& CurrentOffsetRotation) const;
+	// Moves the current foot offset towards the target.
+	void InterpolateFootOffset(float DeltaTime, FVector& CurrentOffsetLocation, const FVector& TargetOffsetLocation, FRotator& CurrentOffsetRotation, const FRotator& TargetOffsetRotation) const;
+
+	// Sets the target offsets for a foot from the trace requested last frame.
+	void OnFootTraceComplete(bool bHit, const FHitResult& Hit, FVector FootFloorLocation, bool bRightFoot);
+
+	// Queues the trace below the named foot; the result arrives next frame.
+	void RequestFootTrace(FName FootBoneName, bool bRightFoot);
 
 	// Sets the pelvis offset.
 	void SetPelvisOffset(float DeltaTime, FVector InLeftFootTargetOffsetLocation, FVector InRightFootTargetOffsetLocation);
@@ -67,6 +79,7 @@ protected:
 	FVector LeftFootCurrentOffsetLocation = FVector::ZeroVector;
 	FRotator LeftFootCurrentOffsetRotation = FRotator::ZeroRotator;
 	FVector LeftFootTargetOffsetLocation = FVector::ZeroVector;
+	FRotator LeftFootTargetOffsetRotation = FRotator::ZeroRotator;
 	
 	FVector PelvisOffset = FVector::ZeroVector;
 	FVector PelvisTarget = FVector::ZeroVector;
@@ -78,6 +91,7 @@ protected:
 	FVector RightFootCurrentOffsetLocation = FVector::ZeroVector;
 	FVector RightFootTargetOffsetLocation = FVector::ZeroVector;
 	FRotator RightFootCurrentOffsetRotation = FRotator::ZeroRotator;
+	FRotator RightFootTargetOffsetRotation = FRotator::ZeroRotator;
 	
 	// Show debug traces for locations, impact points, and target locations.
 	UPROPERTY(EditDefaultsOnly)
@@ -90,4 +104,10 @@ protected:
 	// How far below the foot floor to end the trace.
 	UPROPERTY(EditDefaultsOnly)
 	float TraceDistanceBelow = 30.0f;
+
+	// Time between foot traces, or negative when not tracing.
+	float TraceInterval = 0.0f;
+
+	// Time since the feet were last traced.
+	float TimeSinceTrace = 0.0f;
 };
@@ -0,0 +1,92 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LagCompensationComponent.generated.h"
+
+class ACeremonyCharacter;
+
+/**
+ * The character collision capsule as it was at a point in server time.
+ */
+struct FCapsuleSnapshot
+{
+	// Blend between two snapshots; used to find the capsule between two recorded server frames.
+	static FCapsuleSnapshot Interpolate(const FCapsuleSnapshot& From, const FCapsuleSnapshot& To, float Alpha);
+
+	// Returns true if a sphere overlaps the capsule; an analytic test with no physics scene query.
+	bool OverlapsSphere(const FVector& SphereCenter, float SphereRadius) const;
+
+	FVector Location = FVector::ZeroVector;
+
+	FQuat Rotation = FQuat::Identity;
+
+	float HalfHeight = 0.0f;
+
+	float Radius = 0.0f;
+
+	// The server world time when the snapshot was recorded.
+	float ServerTime = 0.0f;
+};
+
+/**
+ * Server side history of the owning character collision capsule, used to rewind hit verification to the time the attacker saw the hit.
+ *
+ * Only the capsule is recorded. The capsule is the only volume a hit on this character is tested against. The hitboxes (weapon and kick
+ * capsules) belong to the attacker and follow its animation, which a dedicated server doesn't evaluate; the attacker side is checked against
+ * the baked combat data instead.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class CEREMONY_API ULagCompensationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	ULagCompensationComponent();
+
+	FORCEINLINE float GetMaxRewindTime() const { return MaxRewindTime; }
+
+	// Returns the capsule as it was at the given server time; the time is clamped to the maximum rewind window.
+	FCapsuleSnapshot GetSnapshotAtTime(float ServerTime) const;
+
+	// Rewinds the capsule to the given server time and tests it against the impact sphere.
+	bool DidSphereOverlapAtTime(const FVector& SphereCenter, float SphereRadius, float ServerTime, FCapsuleSnapshot& OutSnapshot) const;
+
+	// Forget the recorded capsules, so rewinds don't reach back across a teleport; used when a pooled character is reused.
+	void ResetHistory();
+
+	// Records the capsule every server frame.
+	void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+
+	void BeginPlay() override;
+
+	// Capture the current capsule into the history buffer.
+	FCapsuleSnapshot CaptureSnapshot() const;
+
+	// Returns the snapshot that is the given number of entries older than the most recent.
+	FORCEINLINE const FCapsuleSnapshot& GetHistoryEntry(const int32 Age) const { return History[(HistoryHead - 1 - Age + HistorySize) % HistorySize]; }
+
+	// Ring buffer of capsule snapshots; HistoryHead is the next index written.
+	TArray<FCapsuleSnapshot> History;
+
+	int32 HistoryCount = 0;
+
+	int32 HistoryHead = 0;
+
+	// The number of server frames of capsule history to keep. It should cover the maximum rewind time at the server tick rate.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=2, ClampMax=256))
+	int32 HistorySize = 32;
+
+	// The furthest back in time, in seconds, that a hit can be rewound. Client timestamps older than this are clamped.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.0f, ClampMax=1.0f))
+	float MaxRewindTime = 0.3f;
+
+	// Cached reference to the owning character.
+	UPROPERTY(Transient)
+	ACeremonyCharacter* OwnerCharacter;
+};
@@ -51,6 +51,8 @@ class CEREMONY_API ULockOnComponent : public UActorComponent
 public:	
 	
 	ULockOnComponent();
+
+	FORCEINLINE UAnimMontage* GetYawCorrectionMontage() const { return YawCorrectionMontage; }
 	
 	// Triggered when the lock on button is pressed.
 	void Press();
@@ -70,10 +72,14 @@ protected:
 	
 	ACeremonyCharacter* FindValidCharacterWithHighestDotProduct();
 	
+	// Fill the valid lock on characters from the character registry.
 	void GetValidLockOnCharacters();
 
 	// Call internally to set the character that the owner of this component is locking on to.
 	void SetLockedOn(ACeremonyCharacter* CharacterToLockOnTo);
+
+	// Select the next valid character to the left or right of the current one.
+	void SwitchLockedOn(float Value);
 	
 	// Prevents toggling too quickly between lock on targets.
 	bool bBlockUntilYawReturn = false;
@@ -82,7 +88,7 @@ protected:
 	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.0f, ClampMax=1.0f))
 	float DotProductRange = 0.5f;
 
-	// The radius of the sphere used to find other characters.
+	// The radius around the character to find other characters in.
 	UPROPERTY(EditDefaultsOnly)
 	float LockOnSphereRadius = 1000.0f;
 	
@@ -3,3 +3,6 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+// Stat group for profiling Ceremony gameplay systems; view in game with "stat Ceremony".
+DECLARE_STATS_GROUP(TEXT("Ceremony"), STATGROUP_Ceremony, STATCAT_Advanced);
@@ -0,0 +1,66 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonyCharacterPool.generated.h"
+
+class ACeremonyCharacter;
+class AController;
+
+/**
+ * A dead character waiting in the pool, and the controller that possessed it.
+ */
+USTRUCT()
+struct FCeremonyPooledCharacter
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	ACeremonyCharacter* Character = nullptr;
+
+	TWeakObjectPtr<AController> Controller;
+};
+
+/**
+ * Keeps dead characters and their equipment on the server for their controller's next respawn, instead of destroying them and spawning new
+ * ones. The character actor stays alive on the clients too, so a respawn opens no actor channels, spawns nothing and leaves nothing for
+ * garbage collection. Pooled characters of controllers that have left are destroyed. Disabled with Ceremony.CharacterPool.Enabled.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyCharacterPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the pool for the world of the context object, or nullptr.
+	static UCeremonyCharacterPool* Get(const UObject* WorldContextObject);
+
+	// Returns the pooled character of the class last possessed by the controller, reset at the transform, or nullptr if there isn't one.
+	ACeremonyCharacter* AcquireCharacter(const AController* Controller, UClass* CharacterClass, const FTransform& Transform);
+
+	void Deinitialize() override;
+
+	// Called on the server when a character dies; it's left as a ragdoll for the time, then pooled. Returns false if the character should be
+	// destroyed instead. Releasing a character that's already waiting to be pooled keeps its original timer.
+	bool ReleaseCharacter(ACeremonyCharacter* Character, float RagdollTime);
+
+protected:
+
+	// Destroy pooled characters whose controller has left.
+	void RemoveAbandonedCharacters();
+
+	// Called once the ragdoll time has passed, to put the character in the pool if it's still dead.
+	void ReturnCharacter(TWeakObjectPtr<ACeremonyCharacter> WeakCharacter);
+
+	// The return timer of each released character that isn't pooled yet.
+	TMap<TWeakObjectPtr<ACeremonyCharacter>, FTimerHandle> ReturnTimerHandles;
+
+	// Characters waiting to be reused.
+	UPROPERTY(Transient)
+	TArray<FCeremonyPooledCharacter> PooledCharacters;
+
+};
@@ -0,0 +1,127 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/ContainerAllocationPolicies.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonyCharacterRegistry.generated.h"
+
+class ACeremonyCharacter;
+
+/**
+ * A character returned by a registry query, as of the last registry update.
+ */
+struct FCeremonyCharacterQueryResult
+{
+	ACeremonyCharacter* Character = nullptr;
+
+	FVector Location = FVector::ZeroVector;
+
+	FVector ForwardVector = FVector::ZeroVector;
+
+	// Squared distance from the query origin.
+	float DistanceSquared = 0.0f;
+
+	// Dot product between the query direction and the horizontal direction to the character; 1 when straight ahead. 0 for radius queries.
+	float DotProduct = 0.0f;
+
+	// Z of the cross product between the query direction and the horizontal direction to the character; positive to the right. 0 for radius queries.
+	float CrossProductZ = 0.0f;
+};
+
+/**
+ * Keeps the location, facing and capsule size of every live character in a uniform grid, refreshed once per frame after all actors have ticked.
+ * The data is stored as separate arrays per component, grouped by cell and padded to blocks of four, so queries test four characters at a time
+ * with vector instructions and never touch the physics scene. Queries see the positions from the end of the previous frame.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyCharacterRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the registry for the world of the context object, or nullptr.
+	static UCeremonyCharacterRegistry* Get(const UObject* WorldContextObject);
+
+	void Deinitialize() override;
+
+	// Find the nearest living character whose capsule a horizontal line from the start, along the direction, passes through within the length.
+	bool FindCharacterAlongLine(const FVector& Start, const FVector& Direction, float Length, FCeremonyCharacterQueryResult& OutResult,
+	                            const ACeremonyCharacter* IgnoreCharacter = nullptr) const;
+
+	// Find characters within the radius whose horizontal direction from the origin has at least the minimum dot product with the direction.
+	void FindCharactersInCone(const FVector& Origin, const FVector& Direction, float Radius, float MinimumDotProduct,
+	                          TArray<FCeremonyCharacterQueryResult>& OutResults, const ACeremonyCharacter* IgnoreCharacter = nullptr) const;
+
+	// Find characters within the radius of the origin.
+	void FindCharactersInRadius(const FVector& Origin, float Radius, TArray<FCeremonyCharacterQueryResult>& OutResults,
+	                            const ACeremonyCharacter* IgnoreCharacter = nullptr) const;
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// Called by characters on begin play; the character is queryable from the next update.
+	void RegisterCharacter(ACeremonyCharacter* Character);
+
+	// Called by characters on end play; the character is no longer returned by queries.
+	void UnregisterCharacter(ACeremonyCharacter* Character);
+
+protected:
+
+	/**
+	 * The range of entries belonging to one grid cell. Both start and count are multiples of four.
+	 */
+	struct FCellRange
+	{
+		int32 Start;
+		int32 Count;
+	};
+
+	// Float arrays aligned for vector loads.
+	typedef TArray<float, TAlignedHeapAllocator<16>> FAlignedFloatArray;
+
+	// Call the function with the range of every occupied cell overlapping the square around the origin.
+	template<typename FunctionType>
+	void ForEachCellInRange(const FVector& Origin, float Radius, FunctionType Function) const;
+
+	// Returns the cell containing the location.
+	FIntPoint GetCell(const FVector& Location) const;
+
+	// Fill the query result for the entry. Returns false for padding, the ignored character, and characters destroyed since the last update.
+	bool MakeResult(int32 Index, const FVector& Origin, const ACeremonyCharacter* IgnoreCharacter, FCeremonyCharacterQueryResult& OutResult) const;
+
+	// Rebuild the grid from the registered characters once all actors have ticked.
+	void UpdateRegistry(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	// Occupied cells and their entries.
+	TMap<FIntPoint, FCellRange> Cells;
+
+	// The width of a grid cell; close to the largest query radius keeps queries to a few cells.
+	float CellSize = 1000.0f;
+
+	// The largest capsule radius at the last update, to widen line queries by.
+	float MaxCapsuleRadius = 0.0f;
+
+	// Entries by component, grouped by cell. Padding entries have no character and are placed far enough away to fail every test.
+	FAlignedFloatArray LocationsX;
+	FAlignedFloatArray LocationsY;
+	FAlignedFloatArray LocationsZ;
+	FAlignedFloatArray ForwardsX;
+	FAlignedFloatArray ForwardsY;
+	FAlignedFloatArray ForwardsZ;
+	FAlignedFloatArray CapsuleRadii;
+	FAlignedFloatArray CapsuleHalfHeights;
+
+	// The character of each entry, or nullptr for padding and characters unregistered since the last update.
+	UPROPERTY(Transient)
+	TArray<ACeremonyCharacter*> Characters;
+
+	// Handle for the post actor tick binding.
+	FDelegateHandle PostActorTickHandle;
+
+	// Characters that have begun play and not ended it.
+	UPROPERTY(Transient)
+	TArray<ACeremonyCharacter*> RegisteredCharacters;
+
+};
@@ -0,0 +1,101 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Character/CeremonyAnimNotifyState.h"
+#include "Curves/RichCurve.h"
+#include "Engine/DataAsset.h"
+#include "CeremonyCombatData.generated.h"
+
+class UAnimMontage;
+
+/**
+ * A notify state window in a montage, in montage time. Attack and kick windows carry the path of the socket their hitbox is attached to.
+ */
+USTRUCT()
+struct FCombatNotifyWindow
+{
+	GENERATED_BODY()
+
+	// Whether the time is inside the window, widened by the tolerance on both ends.
+	FORCEINLINE bool ContainsTime(const float Time, const float Tolerance) const { return Time >= StartTime - Tolerance && Time <= EndTime + Tolerance; }
+
+	// Returns the socket location relative to the actor at the time, clamped to the window.
+	FVector GetSocketLocation(float Time) const;
+
+	UPROPERTY(VisibleAnywhere)
+	ECeremonyAnimNotifyStateType NotifyStateType = ECeremonyAnimNotifyStateType::Attack;
+
+	UPROPERTY(VisibleAnywhere)
+	bool bAttackIsRightHanded = true;
+
+	UPROPERTY(VisibleAnywhere)
+	float StartTime = 0.0f;
+
+	UPROPERTY(VisibleAnywhere)
+	float EndTime = 0.0f;
+
+	// Whether the socket location curves were baked for this window.
+	UPROPERTY(VisibleAnywhere)
+	bool bHasSocketPath = false;
+
+	// Socket location relative to the actor over the window, one curve per axis.
+	UPROPERTY()
+	FCompressedRichCurve SocketLocationX;
+
+	UPROPERTY()
+	FCompressedRichCurve SocketLocationY;
+
+	UPROPERTY()
+	FCompressedRichCurve SocketLocationZ;
+};
+
+/**
+ * The baked windows of one montage.
+ */
+USTRUCT()
+struct FMontageCombatData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	TArray<FCombatNotifyWindow> Windows;
+};
+
+/**
+ * Notify windows and hitbox socket paths baked offline from every character and equipment montage by the BakeCombatData commandlet. Notifies
+ * only fire where the montage is animated locally; with this data the server can check a reported hit against the montage the attacker is
+ * playing without evaluating any animation.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyCombatData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the baked windows of the montage, or nullptr if it wasn't baked.
+	const FMontageCombatData* GetMontageData(const UAnimMontage* Montage) const { return Montages.Find(Montage); }
+
+	// Whether a window of the type is open at the montage position, and the impact is within reach of its socket path. Montages that weren't baked
+	// can't be checked and always pass.
+	bool IsHitValid(const UAnimMontage* Montage, float Position, ECeremonyAnimNotifyStateType NotifyStateType, const FTransform& ActorTransform,
+	                const FVector& ImpactPoint, float Reach, float TimeTolerance, float ReachTolerance) const;
+
+#if WITH_EDITOR
+	// Replace all baked data; used by the bake commandlet.
+	void SetMontages(const TMap<UAnimMontage*, FMontageCombatData>& NewMontages, float NewSampleRate);
+#endif
+
+protected:
+
+	// Baked windows by montage.
+	UPROPERTY(VisibleAnywhere)
+	TMap<UAnimMontage*, FMontageCombatData> Montages;
+
+	// The rate socket paths were sampled at before compression.
+	UPROPERTY(VisibleAnywhere)
+	float SampleRate = 0.0f;
+
+};
@@ -0,0 +1,71 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonyEquipmentCatalog.generated.h"
+
+class AEquipmentActor;
+struct FCeremonyLoadout;
+
+/**
+ * Assigns small IDs to every equipment class characters can hold, so a loadout replicates as IDs instead of equipment actors. The catalog is
+ * built from class defaults of every character class the game mode can spawn, sorted by path, so the IDs match on clients and the server. ID
+ * 0 is reserved for no equipment.
+ *
+ * Equipment classes are soft references, so the character doesn't load every weapon with its montages and sounds. Each class is streamed in
+ * with everything it references when a loadout holding it is chosen, and the default loadout is preloaded while the map loads.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyEquipmentCatalog : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the catalog for the world of the context object, or nullptr.
+	static UCeremonyEquipmentCatalog* Get(const UObject* WorldContextObject);
+
+	void Deinitialize() override;
+
+	// Returns the equipment class with the given ID, or nullptr for 0, an unknown ID, or a class that isn't loaded yet.
+	TSubclassOf<AEquipmentActor> GetEquipmentClass(uint8 EquipmentId);
+
+	// Returns the ID of the equipment class, or 0 if it isn't in the catalog.
+	uint8 GetEquipmentId(const TSoftClassPtr<AEquipmentActor>& EquipmentClass);
+
+	// The number of equipment classes in the catalog; IDs run from 1 to the number.
+	int32 GetNumEquipmentClasses();
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// Whether the equipment of every hand of the loadout is loaded.
+	bool IsLoadoutLoaded(const FCeremonyLoadout& Loadout);
+
+	// Stream in the equipment of the loadout, calling the delegate once it's loaded. The equipment stays loaded while the handle is held.
+	TSharedPtr<FStreamableHandle> LoadLoadout(const FCeremonyLoadout& Loadout, FStreamableDelegate Delegate);
+
+protected:
+
+	// Gather the equipment classes from the class defaults and assign the IDs. Deferred until first use on clients, as they need the game state to
+	// find the game mode.
+	void BuildCatalog();
+
+	// Called while the map loads, before play begins; builds the catalog and loads the default loadout where the game mode is known.
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+
+	// Whether the catalog has been built.
+	bool bIsBuilt = false;
+
+	// Catalogued equipment classes, indexed by ID - 1.
+	TArray<TSoftClassPtr<AEquipmentActor>> EquipmentClasses;
+
+	FDelegateHandle WorldInitializedActorsHandle;
+
+	// Keeps the equipment of the default loadout loaded for the life of the world.
+	TSharedPtr<FStreamableHandle> PreloadHandle;
+
+};
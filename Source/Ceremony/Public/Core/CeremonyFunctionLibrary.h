@@ -17,6 +17,10 @@ class CEREMONY_API UCeremonyFunctionLibrary : public UBlueprintFunctionLibrary
 
 public:
 
+	// Returns the server world time; on clients this is the estimate replicated through the game state.
+	UFUNCTION(BlueprintPure, meta=(WorldContext="WorldContextObject"))
+	static float GetServerWorldTimeSeconds(const UObject* WorldContextObject);
+	
 	UFUNCTION(BlueprintCallable)
 	static void LogRoleAndMode(APawn* Pawn, FString InfoString);
 	
@@ -16,6 +16,10 @@ class CEREMONY_API UCeremonyGameInstance : public UGameInstance
 
 public:
 
+	// Log the component count, ticking components and estimated memory of every character, for comparing the game and server builds.
+	UFUNCTION(Exec)
+	void DumpCharacterCost() const;
+	
 	UFUNCTION(Exec)
 	void Host() const;
 
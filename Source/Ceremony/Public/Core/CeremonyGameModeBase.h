@@ -6,8 +6,12 @@
 #include "GameFramework/GameModeBase.h"
 #include "CeremonyGameModeBase.generated.h"
 
+class ACeremonyCharacter;
+class APlayerStart;
+
 /**
- * Base game mode for Ceremony.
+ * Base game mode for Ceremony. Dead players are queued for respawn by the death path and respawned from a timer, a few per frame, at the
+ * player start with the fewest characters nearby.
  */
 UCLASS()
 class CEREMONY_API ACeremonyGameModeBase : public AGameModeBase
@@ -18,11 +22,80 @@ public:
 
 	ACeremonyGameModeBase();
 
+	// Choose the cached player start with the fewest characters nearby, avoiding starts used moments ago.
+	AActor* ChoosePlayerStart_Implementation(AController* Player) override;
+
+	// Add every character class players can spawn as; the default pawn class and the additional character classes. Read from the class
+	// defaults, so clients get the same classes as the server.
+	void GetCharacterClasses(TArray<TSubclassOf<ACeremonyCharacter>>& OutCharacterClasses) const;
+
 	void PostLogin(APlayerController* NewPlayer) override;
 
-	void Tick(float DeltaSeconds) override;
+	// Called on the server when the controller's character dies; the player is respawned after its respawn delay, and no sooner than the
+	// minimum delay.
+	void QueueRespawn(AController* Controller, float MinimumDelay = 0.0f);
+
+	// Players respawn at the least occupied start rather than where they first spawned.
+	bool ShouldSpawnAtStartSpot_Implementation(AController* Player) override;
+
+	// Reuse the controller's pooled character when there is one, rather than spawning a new one.
+	APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
 
 protected:
 
-	void RestartDeadPlayers();
+	/**
+	 * A player waiting to respawn, ordered by respawn time.
+	 */
+	struct FQueuedRespawn
+	{
+		TWeakObjectPtr<AController> Controller;
+
+		// World time at which to respawn.
+		float Time;
+
+		FORCEINLINE bool operator<(const FQueuedRespawn& Other) const { return Time < Other.Time; }
+	};
+
+	// Returns the delay between the controller's character dying and respawning; override for per player delays.
+	virtual float GetRespawnDelay(const AController* Controller) const;
+
+	// Character classes players can spawn as besides the default pawn class; their equipment is added to the equipment catalog.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyGameMode")
+	TArray<TSubclassOf<ACeremonyCharacter>> AdditionalCharacterClasses;
+
+	// Respawn the players that are due, up to the maximum per frame, and schedule the rest.
+	void ProcessRespawnQueue();
+
+	// Set the timer for the earliest queued respawn, or the next frame if one is already due.
+	void ScheduleRespawnTimer();
+
+	// Maximum number of players respawned in one frame, so many deaths at once don't spike a single frame.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyGameMode", meta=(ClampMin=1))
+	int32 MaxRespawnsPerFrame = 1;
+
+	// Player starts found in the world on first use.
+	UPROPERTY(Transient)
+	TArray<APlayerStart*> PlayerStarts;
+
+	// The world time each player start was last chosen, matching PlayerStarts.
+	TArray<float> PlayerStartLastUsedTimes;
+
+	// Characters within this distance of a player start count against it, more so the closer they are.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyGameMode", meta=(ClampMin=0.0f))
+	float PlayerStartOccupancyRadius = 1000.0f;
+
+	// A player start chosen within this many seconds counts as occupied, as the character spawned there isn't in the registry yet.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyGameMode", meta=(ClampMin=0.0f))
+	float PlayerStartReuseTime = 2.0f;
+
+	// The time from a character dying to its player respawning.
+	UPROPERTY(EditDefaultsOnly, Category = "CeremonyGameMode", meta=(ClampMin=0.0f))
+	float RespawnDelay = 5.0f;
+
+	// Players waiting to respawn, as a heap ordered by respawn time.
+	TArray<FQueuedRespawn> RespawnQueue;
+
+	// Timer for the earliest queued respawn.
+	FTimerHandle RespawnTimerHandle;
+
 };
@@ -0,0 +1,68 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonyMontageRegistry.generated.h"
+
+class ACeremonyCharacter;
+class UAnimMontage;
+
+/**
+ * The montages of one character class or one piece of equipment, sorted by path.
+ */
+USTRUCT()
+struct FCeremonyMontageSection
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<UAnimMontage*> Montages;
+};
+
+/**
+ * Assigns small IDs to every montage characters and their equipment can play, so montages replicate as an ID instead of an object reference.
+ * The high byte of an ID is the section: 0 for the montages of the class of the character playing it, or the equipment catalog ID of the
+ * equipment that plays it. The low byte is the montage within its section, sorted by path, so the IDs match on clients and the server.
+ * Sections are built from class defaults on first use; equipment is streamed in, so its section is only built once its class is loaded. ID 0
+ * is reserved for no montage.
+ *
+ * A montage can be in several sections, so its ID is chosen from the loadout of the character playing it rather than from whatever has
+ * been loaded, and the receiver finds the section in the ID.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyMontageRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the registry for the world of the context object, or nullptr.
+	static UCeremonyMontageRegistry* Get(const UObject* WorldContextObject);
+
+	// Returns the montage with the given ID played by the character, or nullptr for 0, an unknown ID, or equipment that isn't loaded yet.
+	UAnimMontage* GetMontage(uint16 MontageId, const ACeremonyCharacter* Character);
+
+	// Returns the ID of the montage played by the character, or 0 if it isn't registered. The character's own section is searched first,
+	// then the sections of the equipment in its right and left hands.
+	uint16 GetMontageId(const UAnimMontage* Montage, const ACeremonyCharacter* Character);
+
+	// Whether the ID is 0 or belongs to a montage the character can play.
+	bool IsValidMontageId(uint16 MontageId, const ACeremonyCharacter* Character);
+
+protected:
+
+	// Returns the section with the given index for the character, building it from class defaults on first use, or nullptr if its equipment
+	// isn't loaded yet.
+	const FCeremonyMontageSection* FindOrBuildSection(uint8 Section, const ACeremonyCharacter* Character);
+
+	// Section 0 of each character class.
+	UPROPERTY(Transient)
+	TMap<UClass*, FCeremonyMontageSection> CharacterSections;
+
+	// The section of each equipment, by equipment catalog ID.
+	UPROPERTY(Transient)
+	TMap<uint8, FCeremonyMontageSection> EquipmentSections;
+
+};
@@ -0,0 +1,124 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonyProjectileSubsystem.generated.h"
+
+class AProjectileActor;
+class UInstancedStaticMeshComponent;
+
+/**
+ * A kind of projectile, read from the class defaults of a projectile actor class, and the mesh instances drawing every projectile of the kind.
+ */
+USTRUCT()
+struct FCeremonyProjectileType
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	UClass* ProjectileClass = nullptr;
+
+	// One instance per projectile of the type, in flight or stuck; nullptr when nothing is drawn, as on a dedicated server.
+	UPROPERTY(Transient)
+	UInstancedStaticMeshComponent* Instances = nullptr;
+
+	// The mesh relative to the projectile, from the class defaults.
+	FTransform MeshTransform;
+
+	float CollisionRadius = 0.0f;
+
+	float GravityScale = 1.0f;
+
+	float InitialSpeed = 0.0f;
+
+	float MaxFlightTime = 0.0f;
+
+	float StuckLifeSpan = 0.0f;
+
+	// Instance transforms gathered each frame, kept to avoid reallocating.
+	TArray<FTransform> InstanceTransforms;
+};
+
+/**
+ * Simulates every projectile in the world in one place, instead of spawning a projectile actor with its own movement, collision and delegates
+ * per arrow. Projectiles in flight are kept as parallel arrays and integrated together once all actors have ticked; the sweep from each
+ * projectile to its next position is submitted as one batch of asynchronous sweeps, and the projectile only moves there once the sweep comes
+ * back clear the next frame. Projectiles that hit stick to what they hit for a while. Each projectile is drawn as an instance of its type's
+ * instanced mesh, so a volley costs no actors or components.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyProjectileSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the subsystem for the world of the context object, or nullptr.
+	static UCeremonyProjectileSubsystem* Get(const UObject* WorldContextObject);
+
+	void Deinitialize() override;
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// Launch a projectile of the class locally, flying from the location along the rotation at the class's initial speed. The owner is never hit
+	// by its own projectiles.
+	void LaunchProjectile(TSubclassOf<AProjectileActor> ProjectileClass, AActor* Owner, const FVector& Location, const FRotator& Rotation);
+
+protected:
+
+	/**
+	 * A projectile that hit something, following the component it's stuck in until it expires.
+	 */
+	struct FStuckProjectile
+	{
+		int32 TypeIndex;
+
+		TWeakObjectPtr<USceneComponent> AttachComponent;
+
+		// Relative to the attach component, or in world space if it has none.
+		FTransform Transform;
+
+		// World time at which the projectile is removed.
+		float ExpireTime;
+	};
+
+	// Returns the index of the type for the projectile class, adding it if needed.
+	int32 FindOrAddProjectileType(UClass* ProjectileClass);
+
+	// Remove the projectile in flight at the index, swapping the last one into its place.
+	void RemoveProjectileAtSwap(int32 Index);
+
+	// Apply last frame's sweeps, integrate the projectiles in flight, submit their sweeps, and update the mesh instances.
+	void UpdateProjectiles(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	// Write the transform of every projectile to its type's mesh instances.
+	void UpdateInstances();
+
+	// Projectiles in flight, as parallel arrays indexed by projectile.
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<FVector> NextPositions;
+	TArray<float> GravityAccelerations;
+	TArray<float> ExpireTimes;
+	TArray<int32> TypeIndices;
+	TArray<TWeakObjectPtr<AActor>> Owners;
+
+	// The sweep from each projectile's position to its next position, submitted last frame.
+	TArray<FTraceHandle> SweepHandles;
+
+	TArray<FStuckProjectile> StuckProjectiles;
+
+	UPROPERTY(Transient)
+	TArray<FCeremonyProjectileType> ProjectileTypes;
+
+	// Holds the instanced mesh components; spawned locally on the first launch.
+	UPROPERTY(Transient)
+	AActor* InstancesActor;
+
+	// Handle for the post actor tick binding.
+	FDelegateHandle PostActorTickHandle;
+
+};
@@ -0,0 +1,72 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonySignificanceSubsystem.generated.h"
+
+class ACeremonyCharacter;
+
+/**
+ * How much a character matters to the local players, from least to most; the value is the significance registered with the significance manager.
+ */
+UENUM()
+enum class ECeremonySignificance : uint8
+{
+	// Far away, or off screen and not near; no IK, widget ticks or footsteps, and animation at the lowest rate.
+	Low,
+	// Mid distance, or near and off screen; IK and animation at a reduced rate.
+	Medium,
+	// Near and on screen; everything at full rate.
+	High,
+	// Locally controlled, or locked on to by a local player; always at full rate.
+	Highest
+};
+
+/**
+ * Ranks the characters by distance and direction from the local players' viewpoints, and by lock on, through the significance manager once all
+ * actors have ticked. Characters apply their significance to the IK, animation, widget and footstep cost. Thresholds are set with the
+ * Ceremony.Significance console variables. Characters aren't registered on dedicated servers.
+ */
+UCLASS()
+class CEREMONY_API UCeremonySignificanceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the subsystem for the world of the context object, or nullptr.
+	static UCeremonySignificanceSubsystem* Get(const UObject* WorldContextObject);
+
+	void Deinitialize() override;
+
+	// Returns the number of animation frames to skip between updates at the significance.
+	static int32 GetAnimationFrameSkip(ECeremonySignificance Significance);
+
+	// Returns the interval between IK foot traces at the significance, or a negative value when the feet shouldn't be traced.
+	static float GetInverseKinematicsTraceInterval(ECeremonySignificance Significance);
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// Called by characters on begin play; the character's significance is set from the next update.
+	void RegisterCharacter(ACeremonyCharacter* Character) const;
+
+	// Called by characters on end play.
+	void UnregisterCharacter(ACeremonyCharacter* Character) const;
+
+protected:
+
+	// Returns the significance of the character from one viewpoint; the significance manager keeps the highest of all viewpoints.
+	static float CalculateSignificance(const ACeremonyCharacter* Character, const FTransform& Viewpoint);
+
+	// Gather the local players' viewpoints and update the significance of every registered character.
+	void UpdateSignificance(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	// Handle for the post actor tick binding.
+	FDelegateHandle PostActorTickHandle;
+
+	// Viewpoints of the local players, reused every update.
+	TArray<FTransform> Viewpoints;
+
+};
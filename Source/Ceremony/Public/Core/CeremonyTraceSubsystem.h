@@ -0,0 +1,96 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CeremonyTraceSubsystem.generated.h"
+
+// Called the frame after a line trace was requested, with whether it hit and the blocking hit.
+DECLARE_DELEGATE_TwoParams(FOnCeremonyLineTraceComplete, bool /* bHit */, const FHitResult& /* Hit */);
+
+// Called the frame after an overlap was requested, with the overlapping components.
+DECLARE_DELEGATE_OneParam(FOnCeremonyOverlapComplete, const TArray<FOverlapResult>& /* Overlaps */);
+
+/**
+ * Collects the gameplay scene queries made during a frame and submits them together as asynchronous traces once all actors have ticked. The physics
+ * scene runs them off the game thread and the results are delivered through the callbacks at the start of the next frame. Delegates bound to objects
+ * that have since been destroyed are skipped.
+ */
+UCLASS()
+class CEREMONY_API UCeremonyTraceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the subsystem for the world of the context object, or nullptr.
+	static UCeremonyTraceSubsystem* Get(const UObject* WorldContextObject);
+
+	// Stop a request from calling back, and from being submitted if it's still pending; safe to call with a request that has already completed.
+	void CancelRequest(uint32 RequestId);
+
+	void Deinitialize() override;
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// Queue a single hit line trace by channel. Returns the request ID.
+	uint32 RequestLineTrace(const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, FOnCeremonyLineTraceComplete Callback);
+
+	// Queue an overlap by object type. Returns the request ID.
+	uint32 RequestOverlap(const FVector& Location, const FCollisionShape& Shape, const FCollisionObjectQueryParams& ObjectQueryParams, const FCollisionQueryParams& Params, FOnCeremonyOverlapComplete Callback);
+
+protected:
+
+	/**
+	 * A line trace waiting to be submitted.
+	 */
+	struct FPendingLineTrace
+	{
+		uint32 RequestId;
+		FVector Start;
+		FVector End;
+		ECollisionChannel TraceChannel;
+		FCollisionQueryParams Params;
+	};
+
+	/**
+	 * An overlap waiting to be submitted.
+	 */
+	struct FPendingOverlap
+	{
+		uint32 RequestId;
+		FVector Location;
+		FCollisionShape Shape;
+		FCollisionObjectQueryParams ObjectQueryParams;
+		FCollisionQueryParams Params;
+	};
+
+	// Engine callbacks for completed traces; the request ID is carried in the user data.
+	void OnAsyncLineTraceComplete(const FTraceHandle& Handle, FTraceDatum& Datum);
+	void OnAsyncOverlapComplete(const FTraceHandle& Handle, FOverlapDatum& Datum);
+
+	// Submit everything queued this frame once all actors have ticked.
+	void SubmitPendingRequests(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	// Engine delegates passed to every async request.
+	FOverlapDelegate AsyncOverlapDelegate;
+	FTraceDelegate AsyncLineTraceDelegate;
+
+	// Callbacks for requests that haven't completed, by request ID.
+	TMap<uint32, FOnCeremonyLineTraceComplete> LineTraceCallbacks;
+	TMap<uint32, FOnCeremonyOverlapComplete> OverlapCallbacks;
+
+	// The last request ID handed out; 0 is never used.
+	uint32 LastRequestId = 0;
+
+	// Requests made this frame.
+	TArray<FPendingLineTrace> PendingLineTraces;
+	TArray<FPendingOverlap> PendingOverlaps;
+
+	// Handle for the post actor tick binding.
+	FDelegateHandle PostActorTickHandle;
+
+};
@@ -8,7 +8,8 @@
 #include "EquipmentActor.generated.h"
 
 /**
- * Base class for equipment - objects that can be held in hands and interacted with through press, release, and resume.
+ * Base class for equipment - objects that can be held in hands and interacted with through press, release, and resume. Equipment isn't
+ * replicated; every machine spawns its own from the owner's replicated loadout.
  */
 UCLASS()
 class CEREMONY_API AEquipmentActor : public AActor
@@ -24,9 +25,18 @@ public:
 
 	virtual void CheckForAttackTransition() { UE_LOG(LogTemp, Warning, TEXT("CheckForAttackTransition not overidden on %s, character %s."), *GetNameSafe(this), *GetNameSafe(GetOwner()));}
 
+	// Returns the attack with the given ID, or nullptr if the equipment has no such attack.
+	FORCEINLINE const FAttackDefinition* GetAttackDefinition(const uint8 AttackId) const { return AttackDefinitions.IsValidIndex(AttackId) ? &AttackDefinitions[AttackId] : nullptr; }
+	
 	EEquipmentStates GetEquipmentState() const { return EquipmentState; }
 
-	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// Add every montage the equipment can play on its owner; used to build the montage registry from class defaults.
+	virtual void GetMontages(TArray<UAnimMontage*>& OutMontages) const {}
+
+	FORCEINLINE TSubclassOf<class UCeremonyAnimInstance> GetLinkedAnimLayerClass() const { return LinkedAnimLayerClass; }
+
+	// The distance from the attach socket to the far end of the equipment's hitbox; 0 for equipment that doesn't hit.
+	virtual float GetReach() const { return 0.0f; }
 
 	virtual void Press1() { UE_LOG(LogTemp, Warning, TEXT("Press1 not overidden on %s, character %s."), *GetNameSafe(this), *GetNameSafe(GetOwner())); }
 	virtual void Press2() { UE_LOG(LogTemp, Warning, TEXT("Press2 not overidden on %s, character %s."), *GetNameSafe(this), *GetNameSafe(GetOwner())); }
@@ -46,10 +56,8 @@ public:
 
 	virtual void ShowCollision(bool bShow) { UE_LOG(LogTemp, Warning, TEXT("ShowCollision not overidden on %s, character %s."), *GetNameSafe(this), *GetNameSafe(GetOwner())); } 
 	
-	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerSetEquipmentState(const EEquipmentStates NewState);
-	void ServerSetEquipmentState_Implementation(const EEquipmentStates NewState) { EquipmentState = NewState; }
-	bool ServerSetEquipmentState_Validate(const EEquipmentStates NewState) { return true; }
+	// Set when the owner attaches the equipment to a hand; two hand equipment keeps its state.
+	void SetEquipmentState(const EEquipmentStates NewState) { EquipmentState = NewState; }
 
 	UPROPERTY(EditDefaultsOnly)
 	bool bMeleeLocomotion = true;
@@ -57,9 +65,23 @@ public:
 protected:
 
 	void BeginPlay() override;
+
+	// Add an attack to the table and return its ID.
+	uint8 AddAttackDefinition(const FDamageParams& DamageParams, bool bIsCharged = false, ESpecialAttackType SpecialAttackType = ESpecialAttackType::None);
 	
-	// The equipment state, replicated from server to clients.
-	UPROPERTY(Transient, Replicated)
+	// Fill the attack table from the attack parameters. It's built from class defaults, so the IDs match on clients and the server.
+	virtual void BuildAttackDefinitions() {}
+
+	// Anim layers linked into the owner's anim graph while equipped, holding the locomotion set for the equipment; only loaded with the equipment.
+	// Equipment without its own locomotion, such as a shield, leaves it unset.
+	UPROPERTY(EditDefaultsOnly)
+	TSubclassOf<class UCeremonyAnimInstance> LinkedAnimLayerClass;
+
+	// Attacks the equipment can inflict, indexed by attack ID.
+	TArray<FAttackDefinition> AttackDefinitions;
+	
+	// The equipment state, set locally by the owner from the hand it's held in.
+	UPROPERTY(Transient)
 	EEquipmentStates EquipmentState;
 
 	// Owner reference.
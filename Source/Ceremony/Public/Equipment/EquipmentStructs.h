@@ -32,6 +32,36 @@ enum class EEquipmentStates : uint8
 	EquippedTwoHand,
 };
 
+/**
+ * The hand holding a piece of equipment, sent to the server in place of a reference to the equipment.
+ */
+UENUM(BlueprintType)
+enum class EEquipmentHand : uint8
+{
+	None,
+	Right,
+	Left
+};
+
+/**
+ * The equipment a character holds, as equipment catalog IDs. Replicated in place of the equipment actors, which every machine spawns locally
+ * from it. ID 0 is an empty hand.
+ */
+USTRUCT()
+struct FCeremonyLoadout
+{
+	GENERATED_BODY()
+
+	FORCEINLINE bool operator==(const FCeremonyLoadout& Other) const { return RightHandEquipmentId == Other.RightHandEquipmentId && LeftHandEquipmentId == Other.LeftHandEquipmentId; }
+	FORCEINLINE bool operator!=(const FCeremonyLoadout& Other) const { return !(*this == Other); }
+
+	UPROPERTY()
+	uint8 RightHandEquipmentId = 0;
+
+	UPROPERTY()
+	uint8 LeftHandEquipmentId = 0;
+};
+
 UENUM(BlueprintType)
 enum class ESpecialAttackType : uint8
 {
@@ -165,6 +195,57 @@ struct FRangedAttackParams
 	UAnimMontage* PrepareMontage;
 };
 
+/**
+ * Structure for an attack the server resolves by ID. The table is built from the attack parameters of the equipment, so clients only send
+ * the attack ID and the charge; the server computes the damage.
+ */
+USTRUCT()
+struct FAttackDefinition
+{
+	GENERATED_BODY()
+
+	FAttackDefinition() {}
+
+	FAttackDefinition(const FDamageParams& InDamageParams, const bool bInIsCharged, const ESpecialAttackType InSpecialAttackType)
+		: DamageParams(InDamageParams), bIsCharged(bInIsCharged), SpecialAttackType(InSpecialAttackType) {}
+
+	// Charge fraction is sent as a byte.
+	static uint8 QuantizeCharge(const float ChargeFraction) { return static_cast<uint8>(FMath::RoundToInt(FMath::Clamp(ChargeFraction, 0.0f, 1.0f) * 255.0f)); }
+	static float DequantizeCharge(const uint8 QuantizedCharge) { return QuantizedCharge / 255.0f; }
+	
+	// Damage inflicted at the given charge fraction. Special attacks multiply the standard damage.
+	float GetDamage(const float ChargeFraction) const
+	{
+		switch(SpecialAttackType)
+		{
+		case ESpecialAttackType::BackStab:
+			return DamageParams.DamageStandard * DamageParams.BackStabMultiplier;
+		case ESpecialAttackType::Riposte:
+			return DamageParams.DamageStandard * DamageParams.RiposteMultiplier;
+		default:
+			return bIsCharged ? FMath::Lerp(DamageParams.DamageStandard, DamageParams.DamageFullyCharged, ChargeFraction) : DamageParams.DamageStandard;
+		}
+	}
+
+	// Endurance damage inflicted at the given charge fraction.
+	float GetEnduranceDamage(const float ChargeFraction) const
+	{
+		return bIsCharged ? FMath::Lerp(DamageParams.EnduranceDamageStandard, DamageParams.EnduranceDamageFullyCharged, ChargeFraction) : DamageParams.EnduranceDamageStandard;
+	}
+	
+	// Damage characteristics of the attack.
+	UPROPERTY()
+	FDamageParams DamageParams;
+
+	// Charged attacks scale damage between standard and fully charged.
+	UPROPERTY()
+	bool bIsCharged = false;
+
+	// Special attacks are only verified through back stab and riposte.
+	UPROPERTY()
+	ESpecialAttackType SpecialAttackType = ESpecialAttackType::None;
+};
+
 /**
  * Structure to contain the blocking characteristics of a shield.
  */
@@ -36,31 +36,32 @@ public:
 
 	// Called from animation notify to allow transitioning to secondary attacks.
 	void CheckForAttackTransition() override;
+
+	void GetMontages(TArray<UAnimMontage*>& OutMontages) const override;
+
+	// The distance from the hand to the far end of the hitbox.
+	float GetReach() const override;
 	
 	// Enables the collision on the weapon to trigger hits.
 	void SetAttackCanDamage(bool bCanDamage) override;
 
 protected:
 
+	// Standard attacks take the first IDs, in order, followed by the running, charged, jumping and special attacks.
+	void BuildAttackDefinitions() override;
+	
 	// The function to call when an attack animation finishes playing.
 	UFUNCTION()
 	void OnAttackMontageEnded(UAnimMontage* Montage, const bool bInterrupted);
 
-	// The capsule collision component for the weapon is enabled/disabled based on notifies from animations.
-	UFUNCTION()
-	void OnCapsuleComponentOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-                               UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
-                               const FHitResult& SweepResult);
-
-	// Array to keep track of actors damaged per attack, to prevent multiple damages from one attack.
-	UPROPERTY(Transient)
-	TArray<AActor*> DamagedActors;
+	// The weapon hitbox is enabled/disabled based on notifies from animations; each character is reported once per attack.
+	void OnHitboxHit(const FHitResult& Hit);
 
-	// Vector which stores the damage, endurance damage, and stun time that will be inflicted on a capsule overlap.
-	FVector_NetQuantize DamageEnduranceDamageStunTime = FVector::ZeroVector;
+	// The attack to verify on the server on capsule overlap.
+	uint8 ActiveAttackId = 0;
 
-	// Damage type to inflict on capsule overlap.
-	uint8 DamageType;
+	// The charge of the active attack, quantized; only used by charged attacks.
+	uint8 ActiveCharge = 0;
 	
 #pragma endregion
 	
@@ -72,9 +73,9 @@ protected:
 	UPROPERTY(VisibleAnywhere)
 	class UArrowComponent* ArrowComponent;
 	
-	// Capsule collision for the part of the weapon that can damage other characters.
+	// Hitbox for the part of the weapon that can damage other characters.
 	UPROPERTY(VisibleAnywhere)
-	class UCapsuleComponent* CapsuleComponent;
+	class UHitboxComponent* CapsuleComponent;
 	
 	// Mesh for the visible part of the weapon.
 	UPROPERTY(VisibleAnywhere)
@@ -108,6 +109,9 @@ protected:
 	// Keeps track of which attack is active from the press1 attack characteristics array.
 	int32 Press1CurrentAttack = 0;
 
+	// Attack ID of the running attack.
+	uint8 Press1RunningAttackId = 0;
+
 	// Keeps track if an attack is in progress.
 	bool bPress1IsAttacking = false;
 
@@ -153,6 +157,9 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "MeleeWeapon | Press2")
 	FChargedAttackCharacteristic Press2AttackParams;
 
+	// Attack ID of the charge attack.
+	uint8 Press2AttackId = 0;
+	
 	// Records the time that a charge attack starts.
 	float Press2ChargeStartTimestamp = 0.0f;
 
@@ -162,6 +169,9 @@ protected:
 	// Parameters for the jumping attack that occurs while running and pressing 2.
 	UPROPERTY(EditDefaultsOnly, Category = "MeleeWeapon | Press2")
 	FStandardAttackParams Press2JumpingAttackParams;
+
+	// Attack ID of the jumping attack.
+	uint8 Press2JumpingAttackId = 0;
 	
 #pragma endregion
 
@@ -169,12 +179,16 @@ protected:
 
 protected:
 
+	// Returns the character directly in front of the owner and the special attack that can be made on it.
 	ACeremonyCharacter* CheckForSpecialAttack(ESpecialAttackType& OutAttackType) const;
 	
 	// When attempting a back stab, the dot product of the two forward vectors is taken and compared to make sure both characters are facing in the right location. Face to back is 1.
 	UPROPERTY(EditDefaultsOnly, meta=(ClampMin = 0.0f, ClampMax = 0.99f), Category = "MeleeWeapon | SpecialAttack")
 	float BackStabDotProductMinimum = 0.8f;
 
+	// Attack ID of the back stab; damage is the first standard attack scaled by the back stab multiplier.
+	uint8 BackStabAttackId = 0;
+	
 	// The amount of endurance consumed when executing a back stab, whether successful or not.
 	UPROPERTY(EditDefaultsOnly, meta=(ClampMin = 0.0f), Category = "MeleeWeapon | SpecialAttack")
 	float BackStabEnduranceConsumption = 20.0f;
@@ -187,6 +201,9 @@ protected:
 	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=-1.0f, ClampMax=0.0f), Category = "MeleeWeapon | SpecialAttack")
 	float RiposteDotProductMaximum = -0.8f;
 
+	// Attack ID of the riposte; damage is the first standard attack scaled by the riposte multiplier.
+	uint8 RiposteAttackId = 0;
+	
 	// Endurance consumed when executing a riposte.
 	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.0f), Category = "MeleeWeapon | SpecialAttack")
 	float RiposteEnduranceConsumption = 20.0f;
@@ -6,10 +6,13 @@
 #include "GameFramework/Actor.h"
 #include "ProjectileActor.generated.h"
 
-class ACeremonyCharacter;
 class UProjectileMovementComponent;
 class USphereComponent;
 
+/**
+ * Defines a kind of projectile through its class defaults; the collision radius, speed, gravity and mesh are read from the components. The
+ * actor is never spawned, the projectile subsystem simulates and draws the projectiles instead.
+ */
 UCLASS()
 class CEREMONY_API AProjectileActor : public AActor
 {
@@ -20,25 +23,28 @@ public:
 
 	AProjectileActor();
 
-	void Tick(float DeltaSeconds) override;
-	
-protected:
+	// The radius swept through the world.
+	float GetCollisionRadius() const;
 
-	void BeginPlay() override;
+	float GetGravityScale() const;
 
-	UFUNCTION()
-	void OnSphereComponentBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	float GetInitialSpeed() const;
+	
+	FORCEINLINE float GetMaxFlightTime() const { return MaxFlightTime; }
+	
+	FORCEINLINE const UStaticMeshComponent* GetStaticMeshComponent() const { return StaticMeshComponent; }
 
-	UFUNCTION()
-	void OnSphereComponentHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+	FORCEINLINE float GetStuckLifeSpan() const { return StuckLifeSpan; }
 	
-	// Owner reference.
-	UPROPERTY(Transient)
-	ACeremonyCharacter* OwnerCharacter;
+protected:
+
+	// Time in flight after which a projectile that hit nothing is removed.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.0f))
+	float MaxFlightTime = 10.0f;
 
-	// Show debug messages/traces.
-	UPROPERTY(EditDefaultsOnly)
-	bool bShowDebug = true;
+	// Time a projectile stays stuck in what it hit.
+	UPROPERTY(EditDefaultsOnly, meta=(ClampMin=0.0f))
+	float StuckLifeSpan = 5.0f;
 	
 #pragma region Components
 
@@ -40,7 +40,11 @@ public:
 	
 	void CheckForAttackTransition() override;
 
+	void GetMontages(TArray<UAnimMontage*>& OutMontages) const override;
+	
 protected:
+
+	void BuildAttackDefinitions() override;
 	
 	UFUNCTION()
 	void OnAttackMontageEnded(UAnimMontage* Montage, bool bInterrupted);
@@ -88,16 +92,34 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "RangedWeapon | Press1")
 	FRangedAttackParams Press1AttackParams;
 
+	// Attack ID of the projectile attack.
+	uint8 Press1AttackId = 0;
+
 #pragma endregion
 
-#pragma region Server
+#pragma region Projectile
 
-	// Spawns the projectile on the server.
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SpawnProjectile(TSubclassOf<AProjectileActor> ClassToSpawn, FVector_NetQuantize Location, FRotator Rotation);
-	void Server_SpawnProjectile_Implementation(TSubclassOf<AProjectileActor> ClassToSpawn, FVector_NetQuantize Location, FRotator Rotation);
-	bool Server_SpawnProjectile_Validate(TSubclassOf<AProjectileActor> ClassToSpawn, FVector_NetQuantize Location, FRotator Rotation) { return true; }	
-	
+public:
+
+	// Launches the projectile locally; called directly when firing, and from the owner's Multicast_LaunchProjectile on other machines.
+	void LaunchProjectile(const FVector& Location, const FRotator& Rotation) const;
+
+	// On the server, checks a launch reported by the owning client before it's passed on. Returns false if the weapon fired too soon after
+	// the last launch; otherwise the location is clamped to within reach of the character.
+	bool VerifyLaunch(FVector& Location);
+
+protected:
+
+	// Launches closer together than this are dropped by the server.
+	UPROPERTY(EditDefaultsOnly, Category = "RangedWeapon | Projectile", meta=(ClampMin=0.0f))
+	float MinLaunchInterval = 0.5f;
+
+	// The farthest from the character a launch can start on the server.
+	UPROPERTY(EditDefaultsOnly, Category = "RangedWeapon | Projectile", meta=(ClampMin=0.0f))
+	float MaxLaunchDistance = 200.0f;
+
+	// World time of the last launch accepted by the server.
+	float LastLaunchTime = -MAX_flt;
 	
 #pragma endregion
 	
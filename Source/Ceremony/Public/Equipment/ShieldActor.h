@@ -22,6 +22,8 @@ public:
 	void CancelActions() override;
 
 	void GetDamageAfterAbsorption(float DamageIn, EDamageTypes DamageType, float EnduranceDamageIn, float& DamageOut, float& EnduranceDamageOut) const;
+
+	void GetMontages(TArray<UAnimMontage*>& OutMontages) const override;
 	
 #pragma region Components
 
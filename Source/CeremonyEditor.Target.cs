@@ -9,6 +9,6 @@ public class CeremonyEditorTarget : TargetRules
 	{
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
-		ExtraModuleNames.AddRange( new string[] { "Ceremony" } );
+		ExtraModuleNames.AddRange( new string[] { "Ceremony", "CeremonyEditor" } );
 	}
 }
@@ -0,0 +1,15 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class CeremonyEditor : ModuleRules
+{
+	public CeremonyEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+	
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "Ceremony" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "AssetRegistry", "UnrealEd" });
+	}
+}
@@ -0,0 +1,279 @@
+// Copyright 2020 Stephen Maloney
+
+#include "BakeCombatDataCommandlet.h"
+
+#include "Animation/AnimMontage.h"
+#include "Animation/AnimSequence.h"
+#include "AssetRegistryModule.h"
+#include "Engine/Blueprint.h"
+#include "Character/CeremonyAnimNotifyState.h"
+#include "Character/CeremonyCharacter.h"
+#include "Core/CeremonyCombatData.h"
+#include "Equipment/EquipmentActor.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "Animation/Skeleton.h"
+#include "Engine/SkeletalMesh.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMeshSocket.h"
+
+UBakeCombatDataCommandlet::UBakeCombatDataCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+void UBakeCombatDataCommandlet::AddWindow(const FAnimNotifyEvent& Event, const float StartTime, const float EndTime, FMontageCombatData& OutData)
+{
+	const UCeremonyAnimNotifyState* NotifyState = Cast<UCeremonyAnimNotifyState>(Event.NotifyStateClass);
+	if(!IsValid(NotifyState) || NotifyState->GetNotifyStateType() == ECeremonyAnimNotifyStateType::Movement)
+	{
+		return;
+	}
+
+	FCombatNotifyWindow& Window = OutData.Windows.AddDefaulted_GetRef();
+	Window.NotifyStateType = NotifyState->GetNotifyStateType();
+	Window.bAttackIsRightHanded = NotifyState->GetAttackIsRightHanded();
+	Window.StartTime = StartTime;
+	Window.EndTime = EndTime;
+}
+
+void UBakeCombatDataCommandlet::BakeMontage(const ACeremonyCharacter* CharacterDefault, const UAnimMontage* Montage, FMontageCombatData& OutData) const
+{
+	// Notifies on the montage are in montage time.
+	for(const FAnimNotifyEvent& Event : Montage->Notifies)
+	{
+		AddWindow(Event, Event.GetTriggerTime(), Event.GetEndTriggerTime(), OutData);
+	}
+
+	// Notifies on the sequences the montage plays fire too; map them into montage time through each segment of the first slot, for every loop.
+	if(Montage->SlotAnimTracks.Num() > 0)
+	{
+		for(const FAnimSegment& Segment : Montage->SlotAnimTracks[0].AnimTrack.AnimSegments)
+		{
+			if(!IsValid(Segment.AnimReference) || Segment.AnimPlayRate <= 0.0f)
+			{
+				continue;
+			}
+
+			const float SegmentLength = (Segment.AnimEndTime - Segment.AnimStartTime) / Segment.AnimPlayRate;
+			for(const FAnimNotifyEvent& Event : Segment.AnimReference->Notifies)
+			{
+				const float EventStart = FMath::Max(Event.GetTriggerTime(), Segment.AnimStartTime);
+				const float EventEnd = FMath::Min(Event.GetEndTriggerTime(), Segment.AnimEndTime);
+				if(EventStart > EventEnd)
+				{
+					continue;
+				}
+
+				for(int32 Loop = 0; Loop < Segment.LoopingCount; Loop++)
+				{
+					const float LoopStart = Segment.StartPos + Loop * SegmentLength;
+					AddWindow(Event, LoopStart + (EventStart - Segment.AnimStartTime) / Segment.AnimPlayRate,
+						LoopStart + (EventEnd - Segment.AnimStartTime) / Segment.AnimPlayRate, OutData);
+				}
+			}
+		}
+	}
+
+	OutData.Windows.Sort([](const FCombatNotifyWindow& A, const FCombatNotifyWindow& B) { return A.StartTime < B.StartTime; });
+
+	for(FCombatNotifyWindow& Window : OutData.Windows)
+	{
+		BakeSocketPath(CharacterDefault, Montage, Window);
+	}
+}
+
+void UBakeCombatDataCommandlet::BakeSocketPath(const ACeremonyCharacter* CharacterDefault, const UAnimMontage* Montage, FCombatNotifyWindow& Window) const
+{
+	// Weapons hang from the hand sockets; the kick hitbox is attached directly to the foot.
+	FName SocketName;
+	switch(Window.NotifyStateType)
+	{
+	case ECeremonyAnimNotifyStateType::Attack:
+		SocketName = Window.bAttackIsRightHanded ? CharacterDefault->GetRightHandSocketName() : CharacterDefault->GetLeftHandSocketName();
+		break;
+	case ECeremonyAnimNotifyStateType::Kick:
+		SocketName = CharacterDefault->GetKickSocketName();
+		break;
+	default:
+		return;
+	}
+
+	FRichCurve CurveX;
+	FRichCurve CurveY;
+	FRichCurve CurveZ;
+
+	const int32 SampleCount = FMath::Max(FMath::CeilToInt((Window.EndTime - Window.StartTime) * SampleRate), 1);
+	for(int32 Sample = 0; Sample <= SampleCount; Sample++)
+	{
+		const float Time = FMath::Lerp(Window.StartTime, Window.EndTime, static_cast<float>(Sample) / SampleCount);
+
+		FVector Location;
+		if(!GetSocketLocation(CharacterDefault, Montage, SocketName, Time, Location))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("UBakeCombatDataCommandlet::BakeSocketPath: Unable to sample socket %s in %s at %f; the window is baked without a path."), *SocketName.ToString(), *GetNameSafe(Montage), Time);
+			return;
+		}
+
+		CurveX.SetKeyInterpMode(CurveX.AddKey(Time, Location.X), RCIM_Linear);
+		CurveY.SetKeyInterpMode(CurveY.AddKey(Time, Location.Y), RCIM_Linear);
+		CurveZ.SetKeyInterpMode(CurveZ.AddKey(Time, Location.Z), RCIM_Linear);
+	}
+
+	CurveX.CompressCurve(Window.SocketLocationX, ErrorThreshold, SampleRate);
+	CurveY.CompressCurve(Window.SocketLocationY, ErrorThreshold, SampleRate);
+	CurveZ.CompressCurve(Window.SocketLocationZ, ErrorThreshold, SampleRate);
+	Window.bHasSocketPath = true;
+}
+
+bool UBakeCombatDataCommandlet::GetSocketLocation(const ACeremonyCharacter* CharacterDefault, const UAnimMontage* Montage, const FName SocketName,
+                                                  const float Position, FVector& OutLocation)
+{
+	const USkeletalMeshComponent* MeshComponent = CharacterDefault->GetMesh();
+	const USkeletalMesh* SkeletalMesh = IsValid(MeshComponent) ? MeshComponent->SkeletalMesh : nullptr;
+	const USkeleton* Skeleton = Montage->GetSkeleton();
+	if(!IsValid(SkeletalMesh) || !IsValid(Skeleton) || Montage->SlotAnimTracks.Num() == 0)
+	{
+		return false;
+	}
+
+	// Hitboxes are attached to either a socket on the mesh or skeleton, or directly to a bone.
+	const USkeletalMeshSocket* Socket = SkeletalMesh->FindSocket(SocketName);
+	const FReferenceSkeleton& ReferenceSkeleton = Skeleton->GetReferenceSkeleton();
+	const int32 BoneIndex = ReferenceSkeleton.FindBoneIndex(Socket != nullptr ? Socket->BoneName : SocketName);
+	if(BoneIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Find the sequence the first slot plays at the position.
+	const FAnimSegment* Segment = Montage->SlotAnimTracks[0].AnimTrack.GetSegmentAtTime(Position);
+	float SequencePosition = 0.0f;
+	const UAnimSequence* Sequence = Segment != nullptr ? Cast<UAnimSequence>(Segment->GetAnimationData(Position, SequencePosition)) : nullptr;
+	if(!IsValid(Sequence))
+	{
+		return false;
+	}
+
+	// Compose the bone transforms up to the root. Bones without a track stay in the reference pose, as does the root when root motion moves the
+	// actor instead of the mesh.
+	const TArray<FTrackToSkeletonMap>& TrackToSkeletonMap = Sequence->GetRawTrackToSkeletonMapTable();
+	FTransform ComponentTransform = Socket != nullptr ? Socket->GetSocketLocalTransform() : FTransform::Identity;
+	for(int32 Index = BoneIndex; Index != INDEX_NONE; Index = ReferenceSkeleton.GetParentIndex(Index))
+	{
+		FTransform BoneTransform = ReferenceSkeleton.GetRefBonePose()[Index];
+
+		const int32 TrackIndex = TrackToSkeletonMap.IndexOfByPredicate([Index](const FTrackToSkeletonMap& Track) { return Track.BoneTreeIndex == Index; });
+		if(TrackIndex != INDEX_NONE && !(Index == 0 && Sequence->bEnableRootMotion))
+		{
+			Sequence->GetBoneTransform(BoneTransform, TrackIndex, SequencePosition, true);
+		}
+
+		ComponentTransform = ComponentTransform * BoneTransform;
+	}
+
+	// The mesh is offset and turned inside the capsule.
+	OutLocation = MeshComponent->GetRelativeTransform().TransformPosition(ComponentTransform.GetLocation());
+	return true;
+}
+
+int32 UBakeCombatDataCommandlet::Main(const FString& Params)
+{
+	FString OutputPath = TEXT("/Game/Data/DA_CombatData");
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("SampleRate="), SampleRate);
+	FParse::Value(*Params, TEXT("ErrorThreshold="), ErrorThreshold);
+	SampleRate = FMath::Max(SampleRate, 1.0f);
+
+	// Find the class defaults of every character and equipment blueprint.
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	TArray<FAssetData> BlueprintAssets;
+	AssetRegistry.GetAssetsByClass(UBlueprint::StaticClass()->GetFName(), BlueprintAssets, true);
+
+	TArray<const ACeremonyCharacter*> CharacterDefaults;
+	TArray<const AEquipmentActor*> EquipmentDefaults;
+	for(const FAssetData& BlueprintAsset : BlueprintAssets)
+	{
+		const UBlueprint* Blueprint = Cast<UBlueprint>(BlueprintAsset.GetAsset());
+		UClass* GeneratedClass = IsValid(Blueprint) ? Blueprint->GeneratedClass : nullptr;
+		if(!IsValid(GeneratedClass) || GeneratedClass->HasAnyClassFlags(CLASS_Abstract))
+		{
+			continue;
+		}
+
+		if(GeneratedClass->IsChildOf(ACeremonyCharacter::StaticClass()))
+		{
+			CharacterDefaults.Add(GeneratedClass->GetDefaultObject<ACeremonyCharacter>());
+		}
+		else if(GeneratedClass->IsChildOf(AEquipmentActor::StaticClass()))
+		{
+			EquipmentDefaults.Add(GeneratedClass->GetDefaultObject<AEquipmentActor>());
+		}
+	}
+
+	if(CharacterDefaults.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeCombatDataCommandlet::Main: No character blueprints found."));
+		return 1;
+	}
+
+	// Any character can pick up any equipment; bake each montage against the first character that can play it. Montages without windows are kept,
+	// so hits claimed from them are rejected.
+	TMap<UAnimMontage*, FMontageCombatData> Montages;
+	for(const ACeremonyCharacter* CharacterDefault : CharacterDefaults)
+	{
+		TArray<UAnimMontage*> CharacterMontages;
+		CharacterDefault->GetMontages(CharacterMontages);
+		for(const AEquipmentActor* EquipmentDefault : EquipmentDefaults)
+		{
+			EquipmentDefault->GetMontages(CharacterMontages);
+		}
+
+		for(UAnimMontage* Montage : CharacterMontages)
+		{
+			if(!IsValid(Montage) || Montages.Contains(Montage))
+			{
+				continue;
+			}
+
+			FMontageCombatData& MontageData = Montages.Add(Montage);
+			BakeMontage(CharacterDefault, Montage, MontageData);
+
+			UE_LOG(LogTemp, Display, TEXT("UBakeCombatDataCommandlet::Main: Baked %d windows from %s using %s."), MontageData.Windows.Num(), *GetNameSafe(Montage), *GetNameSafe(CharacterDefault->GetClass()));
+		}
+	}
+
+	// Update the asset in place if it exists, so references to it stay valid.
+	UPackage* Package = FPackageName::DoesPackageExist(OutputPath) ? LoadPackage(nullptr, *OutputPath, LOAD_None) : CreatePackage(*OutputPath);
+	if(!IsValid(Package))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeCombatDataCommandlet::Main: Unable to create package %s."), *OutputPath);
+		return 1;
+	}
+
+	const FString AssetName = FPackageName::GetLongPackageAssetName(OutputPath);
+	UCeremonyCombatData* CombatData = FindObject<UCeremonyCombatData>(Package, *AssetName);
+	if(CombatData == nullptr)
+	{
+		CombatData = NewObject<UCeremonyCombatData>(Package, *AssetName, RF_Public | RF_Standalone);
+		FAssetRegistryModule::AssetCreated(CombatData);
+	}
+
+	CombatData->SetMontages(Montages, SampleRate);
+	Package->MarkPackageDirty();
+
+	const FString Filename = FPackageName::LongPackageNameToFilename(OutputPath, FPackageName::GetAssetPackageExtension());
+	if(!UPackage::SavePackage(Package, CombatData, RF_Public | RF_Standalone, *Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeCombatDataCommandlet::Main: Unable to save %s."), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("UBakeCombatDataCommandlet::Main: Saved %d montages to %s."), Montages.Num(), *OutputPath);
+	return 0;
+}
@@ -0,0 +1,5 @@
+// Copyright 2020 Stephen Maloney
+
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE( FDefaultModuleImpl, CeremonyEditor );
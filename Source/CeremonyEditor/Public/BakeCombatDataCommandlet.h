@@ -0,0 +1,52 @@
+// Copyright 2020 Stephen Maloney
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BakeCombatDataCommandlet.generated.h"
+
+class ACeremonyCharacter;
+class UAnimMontage;
+struct FAnimNotifyEvent;
+struct FCombatNotifyWindow;
+struct FMontageCombatData;
+
+/**
+ * Bakes the notify windows of every character and equipment montage into a combat data asset, with the path of the socket each attack and kick
+ * hitbox is attached to sampled over its window and stored as compressed curves. Run after changing montages or their notifies:
+ *
+ * UE4Editor-Cmd.exe Ceremony.uproject -run=BakeCombatData -Output=/Game/Data/DA_CombatData [-SampleRate=60] [-ErrorThreshold=0.5]
+ */
+UCLASS()
+class CEREMONYEDITOR_API UBakeCombatDataCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UBakeCombatDataCommandlet();
+
+	int32 Main(const FString& Params) override;
+
+protected:
+
+	// Add a window for a ceremony notify state, between the given montage times. Movement windows aren't needed for validation and are skipped.
+	static void AddWindow(const FAnimNotifyEvent& Event, float StartTime, float EndTime, FMontageCombatData& OutData);
+
+	// Bake the windows of one montage as played by the character.
+	void BakeMontage(const ACeremonyCharacter* CharacterDefault, const UAnimMontage* Montage, FMontageCombatData& OutData) const;
+
+	// Sample the socket the window's hitbox is attached to over the window and compress the curves.
+	void BakeSocketPath(const ACeremonyCharacter* CharacterDefault, const UAnimMontage* Montage, FCombatNotifyWindow& Window) const;
+
+	// Returns the socket location relative to the actor at the montage position, or false if the socket or animation can't be found.
+	static bool GetSocketLocation(const ACeremonyCharacter* CharacterDefault, const UAnimMontage* Montage, FName SocketName, float Position, FVector& OutLocation);
+
+	// Allowed error, in centimeters, when compressing socket paths.
+	float ErrorThreshold = 0.5f;
+
+	// The rate socket paths are sampled at, per second.
+	float SampleRate = 60.0f;
+
+};